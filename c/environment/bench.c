@@ -0,0 +1,403 @@
+// Benchmarks for the environment example.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// The lookup benchmark reads the four EXAMPLE_* variables count times, and
+// the reload benchmark makes count reads on each thread while the
+// configuration is replaced over and over. The reload benchmark exits with
+// an error if a reader sees a version that is half updated.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "env.h"
+
+#ifndef _WIN32
+#include "config.h"
+#endif
+
+#define BENCH_DEFAULT_COUNT 1000000
+
+// The number of extra variables added to the environment, so that getenv
+// has about as much to search as it would in a real service.
+#define BENCH_FILLER_VARS 64
+
+// The most reader threads the reload benchmark uses, unless the machine has
+// more cores.
+#define BENCH_RELOAD_THREADS 8
+
+typedef void (*bench_fn)(size_t);
+
+typedef struct bench
+{
+    const char *name;
+    bench_fn run;
+} bench;
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double now_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/**
+ * Sets an environment variable if it isn't set already.
+ *
+ * Params:
+ *   const char* - the name of the variable
+ *   const char* - the value
+ */
+static void set_default_env(const char *name, const char *value)
+{
+#ifdef _WIN32
+    size_t len;
+    if (getenv_s(&len, NULL, 0, name) == 0 && len == 0)
+        _putenv_s(name, value);
+#else
+    setenv(name, value, 0);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// lookup: load_env_var against an env_snapshot
+
+static const env_key bench_keys[] = {
+    {"EXAMPLE_USERNAME", ENV_TYPE_STRING},
+    {"EXAMPLE_PASSWORD", ENV_TYPE_STRING},
+    {"EXAMPLE_HOST", ENV_TYPE_STRING},
+    {"EXAMPLE_PORT", ENV_TYPE_INT},
+};
+
+#define BENCH_KEY_COUNT (sizeof(bench_keys) / sizeof(bench_keys[0]))
+
+static void bench_report(const char *name, const char *unit, size_t count, double seconds, unsigned long long check)
+{
+    printf("  %-32s %10.2f ns/%-8s  (check %llX)\n", name, seconds * 1e9 / (double)count, unit, check);
+}
+
+static void bench_lookup(size_t count)
+{
+    char username[ENV_BUFF_SIZE];
+    char password[ENV_BUFF_SIZE];
+    char host[ENV_BUFF_SIZE];
+    char port[ENV_BUFF_SIZE];
+    char filler[32];
+    unsigned long long check;
+    env_snapshot snap;
+    double start;
+
+    set_default_env("EXAMPLE_USERNAME", "potato");
+    set_default_env("EXAMPLE_PASSWORD", "salad");
+    set_default_env("EXAMPLE_HOST", "localhost");
+    set_default_env("EXAMPLE_PORT", "8080");
+    for (int i = 0; i < BENCH_FILLER_VARS; i++)
+    {
+        snprintf(filler, sizeof(filler), "BENCH_FILLER_%d", i);
+        set_default_env(filler, "some value that nobody reads");
+    }
+
+    printf("lookup: %zu reads of all %d EXAMPLE_* variables\n", count, (int)BENCH_KEY_COUNT);
+
+    // The way main.c reads the configuration.
+    check = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+    {
+        load_env_var("EXAMPLE_USERNAME", username);
+        load_env_var("EXAMPLE_PASSWORD", password);
+        load_env_var("EXAMPLE_HOST", host);
+        load_env_var("EXAMPLE_PORT", port);
+        check += strlen(username) + strlen(password) + strlen(host) + (unsigned long long)strtol(port, NULL, 10);
+    }
+    bench_report("load_env_var and strtol", "read", count, now_seconds() - start, check);
+
+    // Making the snapshot is done once, but is timed here for comparison.
+    check = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+    {
+        env_snapshot_init(&snap, bench_keys, BENCH_KEY_COUNT);
+        check += snap.count;
+    }
+    bench_report("env_snapshot_init", "snapshot", count, now_seconds() - start, check);
+
+    check = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+    {
+        env_str s;
+        long n = 0;
+        if (!env_snapshot_str(&snap, "EXAMPLE_USERNAME", &s))
+            check += s.len;
+        if (!env_snapshot_str(&snap, "EXAMPLE_PASSWORD", &s))
+            check += s.len;
+        if (!env_snapshot_str(&snap, "EXAMPLE_HOST", &s))
+            check += s.len;
+        if (!env_snapshot_int(&snap, "EXAMPLE_PORT", &n))
+            check += (unsigned long long)n;
+    }
+    bench_report("env_snapshot lookups", "read", count, now_seconds() - start, check);
+}
+
+//----------------------------------------------------------------------------
+// reload: readers of a config_store against readers of a config behind a
+// pthread_rwlock, while another thread keeps publishing new versions
+
+#ifndef _WIN32
+typedef struct reload_run
+{
+    config_store store;
+    pthread_rwlock_t rwlock;
+    config locked; // the config behind the rwlock
+    int use_store;
+    size_t reads;
+    atomic_int start;
+    atomic_int running; // the number of readers that haven't finished
+    atomic_int torn;    // set if a reader saw a half updated version
+    unsigned long long publishes;
+} reload_run;
+
+// Fills in a version where every field depends on n, so that a reader can
+// tell if it sees fields from two different versions.
+static void reload_values(config *cfg, long n)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->port = n % 65536;
+    snprintf(cfg->host, sizeof(cfg->host), "host-%ld", cfg->port);
+    cfg->username[0] = (char)('a' + cfg->port % 26);
+    cfg->password[0] = (char)('A' + cfg->port % 26);
+}
+
+static int reload_consistent(const config *cfg)
+{
+    return cfg->username[0] == 'a' + cfg->port % 26 && cfg->password[0] == 'A' + cfg->port % 26 &&
+           strtol(cfg->host + 5, NULL, 10) == cfg->port;
+}
+
+static void *reload_reader(void *arg)
+{
+    reload_run *run = arg;
+    int reader = run->use_store ? config_reader_register(&run->store) : 0;
+    unsigned long long sum = 0;
+
+    while (!atomic_load(&run->start))
+        sched_yield();
+
+    for (size_t i = 0; i < run->reads; i++)
+    {
+        const config *cfg;
+        int ok;
+
+        if (run->use_store)
+        {
+            cfg = config_read_begin(&run->store, reader);
+            sum += (unsigned long long)cfg->port;
+            ok = (i & 63) != 0 || reload_consistent(cfg);
+            config_read_end(&run->store, reader);
+        }
+        else
+        {
+            pthread_rwlock_rdlock(&run->rwlock);
+            cfg = &run->locked;
+            sum += (unsigned long long)cfg->port;
+            ok = (i & 63) != 0 || reload_consistent(cfg);
+            pthread_rwlock_unlock(&run->rwlock);
+        }
+
+        if (!ok)
+            atomic_store(&run->torn, 1);
+    }
+
+    if (run->use_store)
+        config_reader_unregister(&run->store, reader);
+    atomic_fetch_sub(&run->running, 1);
+    return (void *)(size_t)sum;
+}
+
+static void *reload_writer(void *arg)
+{
+    reload_run *run = arg;
+    config next;
+    long n = 0;
+
+    while (!atomic_load(&run->start))
+        sched_yield();
+
+    while (atomic_load(&run->running) > 0)
+    {
+        reload_values(&next, ++n);
+        if (run->use_store)
+        {
+            config_publish(&run->store, &next);
+        }
+        else
+        {
+            pthread_rwlock_wrlock(&run->rwlock);
+            run->locked = next;
+            pthread_rwlock_unlock(&run->rwlock);
+        }
+        run->publishes++;
+        sched_yield();
+    }
+    return NULL;
+}
+
+/**
+ * Runs reader threads and a writer thread.
+ *
+ * Params:
+ *   reload_run* - the run, with the store or the rwlock ready
+ *   unsigned int - the number of readers
+ *   double* - receives the number of publishes per second
+ *
+ * Returns:
+ *   double - reads per second, over all readers
+ */
+static double reload_threads(reload_run *run, unsigned int readers, double *publishes)
+{
+    pthread_t threads[BENCH_RELOAD_THREADS * 8];
+    pthread_t writer;
+    double start;
+    double seconds;
+
+    atomic_store(&run->start, 0);
+    atomic_store(&run->running, (int)readers);
+    run->publishes = 0;
+
+    for (unsigned int t = 0; t < readers; t++)
+        pthread_create(&threads[t], NULL, reload_reader, run);
+    pthread_create(&writer, NULL, reload_writer, run);
+
+    start = now_seconds();
+    atomic_store(&run->start, 1);
+    for (unsigned int t = 0; t < readers; t++)
+        pthread_join(threads[t], NULL);
+    seconds = now_seconds() - start;
+    pthread_join(writer, NULL);
+
+    *publishes = (double)run->publishes / seconds;
+    return (double)readers * (double)run->reads / seconds;
+}
+#endif
+
+static void bench_reload(size_t count)
+{
+#ifdef _WIN32
+    (void)count;
+    printf("reload: not supported on Windows\n");
+#else
+    static reload_run run;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int max_readers = cores > BENCH_RELOAD_THREADS ? (unsigned int)cores : BENCH_RELOAD_THREADS;
+    config first;
+
+    if (count == 0)
+        return;
+    if (max_readers > BENCH_RELOAD_THREADS * 8)
+        max_readers = BENCH_RELOAD_THREADS * 8;
+    if (max_readers > CONFIG_MAX_READERS)
+        max_readers = CONFIG_MAX_READERS;
+
+    if (config_store_init(&run.store, NULL))
+        return;
+    reload_values(&first, 0);
+    config_publish(&run.store, &first);
+    pthread_rwlock_init(&run.rwlock, NULL);
+    run.locked = first;
+    run.reads = count;
+    atomic_store(&run.torn, 0);
+
+    printf("reload: %zu reads per thread, 1 thread publishing new versions, %ld cores\n", count, cores);
+    printf("  %-8s %30s %30s\n", "readers", "config_store", "pthread_rwlock");
+
+    for (unsigned int readers = 1; readers <= max_readers; readers *= 2)
+    {
+        double store_publishes;
+        double lock_publishes;
+
+        run.use_store = 1;
+        double store_reads = reload_threads(&run, readers, &store_publishes);
+        run.use_store = 0;
+        double lock_reads = reload_threads(&run, readers, &lock_publishes);
+
+        printf("  %-8u %8.1f M reads/s %7.0f reloads/s %8.1f M reads/s %7.0f reloads/s\n", readers,
+               store_reads / 1e6, store_publishes, lock_reads / 1e6, lock_publishes);
+    }
+
+    // With no readers left, publishing once more frees every old version.
+    config_publish(&run.store, &first);
+    if (atomic_load(&run.torn) || run.store.retired != NULL)
+    {
+        fprintf(stderr, "reload: %s\n", atomic_load(&run.torn) ? "a reader saw a half updated version"
+                                                               : "old versions were not freed");
+        exit(1);
+    }
+    printf("  every read was consistent, and every old version was freed\n");
+
+    pthread_rwlock_destroy(&run.rwlock);
+    config_store_free(&run.store);
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+static const bench benches[] = {
+    {"lookup", bench_lookup},
+    {"reload", bench_reload},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    int found = 0;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (name == NULL || !strcmp(name, benches[i].name))
+        {
+            benches[i].run(count);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,558 @@
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// The longest line read from a config file, including the newline.
+#define CONFIG_LINE_SIZE 1024
+
+static const env_key config_keys[] = {
+    {"EXAMPLE_USERNAME", ENV_TYPE_STRING},
+    {"EXAMPLE_PASSWORD", ENV_TYPE_STRING},
+    {"EXAMPLE_HOST", ENV_TYPE_STRING},
+    {"EXAMPLE_PORT", ENV_TYPE_STRING},
+};
+
+#define CONFIG_KEY_COUNT (sizeof(config_keys) / sizeof(config_keys[0]))
+
+// The write end of the self-pipe of the store that handles SIGHUP, or -1.
+static volatile sig_atomic_t config_signal_fd = -1;
+
+// The SIGHUP handler from before config_watch_start.
+static struct sigaction config_old_action;
+
+/**
+ * Copies a value into one of the fields of a version.
+ *
+ * Params:
+ *   char* - the field, of ENV_BUFF_SIZE chars
+ *   const char* - the value
+ *   size_t - the length of the value
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the value is too long
+ */
+static int config_copy(char *dest, const char *value, size_t len)
+{
+    if (len >= ENV_BUFF_SIZE)
+        return 1;
+
+    memcpy(dest, value, len);
+    dest[len] = '\0';
+    return 0;
+}
+
+/**
+ * Sets the field of a version for a key. Unknown keys are ignored.
+ *
+ * Params:
+ *   config* - the version
+ *   const char* - the key, like EXAMPLE_HOST
+ *   const char* - the value
+ *   size_t - the length of the value
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the value is too long or isn't a valid port
+ */
+static int config_set(config *cfg, const char *key, const char *value, size_t len)
+{
+    if (!strcmp(key, "EXAMPLE_USERNAME"))
+        return config_copy(cfg->username, value, len);
+    if (!strcmp(key, "EXAMPLE_PASSWORD"))
+        return config_copy(cfg->password, value, len);
+    if (!strcmp(key, "EXAMPLE_HOST"))
+        return config_copy(cfg->host, value, len);
+
+    if (!strcmp(key, "EXAMPLE_PORT"))
+    {
+        char text[ENV_BUFF_SIZE];
+        char *end;
+
+        // An empty port means it isn't set.
+        if (len == 0)
+        {
+            cfg->port = 0;
+            return 0;
+        }
+
+        if (config_copy(text, value, len))
+            return 1;
+
+        errno = 0;
+        cfg->port = strtol(text, &end, 10);
+        return *end != '\0' || errno != 0 || cfg->port < 0 || cfg->port > 65535;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads KEY=VALUE lines from a file into a version. Empty lines and lines
+ * starting with '#' are skipped.
+ *
+ * Params:
+ *   const char* - the path of the file
+ *   config* - the version
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the file couldn't be read or has a bad line
+ */
+static int config_load_file(const char *path, config *cfg)
+{
+    char line[CONFIG_LINE_SIZE];
+    int result = 0;
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL)
+        return 1;
+
+    while (result == 0 && fgets(line, sizeof(line), f) != NULL)
+    {
+        size_t len = strlen(line);
+        char *eq;
+
+        if (len > 0 && line[len - 1] != '\n' && !feof(f))
+        {
+            result = 1; // the line is too long
+            break;
+        }
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        eq = strchr(line, '=');
+        if (eq == NULL)
+        {
+            result = 1;
+            break;
+        }
+
+        *eq = '\0';
+        result = config_set(cfg, line, eq + 1, len - (size_t)(eq + 1 - line));
+    }
+
+    fclose(f);
+    return result;
+}
+
+/**
+ * Builds a version from the environment and a file.
+ *
+ * Params:
+ *   const char* - the path of the file, or ""
+ *   config* - the version
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static int config_load(const char *path, config *cfg)
+{
+    env_snapshot snap;
+
+    memset(cfg, 0, sizeof(*cfg));
+    if (env_snapshot_init(&snap, config_keys, CONFIG_KEY_COUNT))
+        return 1;
+
+    for (size_t i = 0; i < CONFIG_KEY_COUNT; i++)
+    {
+        env_str value;
+        if (!env_snapshot_str(&snap, config_keys[i].name, &value) &&
+            config_set(cfg, config_keys[i].name, value.ptr, value.len))
+            return 1;
+    }
+
+    return path[0] != '\0' ? config_load_file(path, cfg) : 0;
+}
+
+/**
+ * Frees the retired versions that no reader can still be using.
+ * The store's lock must be held.
+ *
+ * Params:
+ *   config_store* - the store
+ */
+static void config_reclaim(config_store *store)
+{
+    unsigned long long oldest = 0;
+    config_retired **link = &store->retired;
+
+    // Find the oldest epoch announced by a reader. A reader that announced
+    // an epoch may be using any version that was replaced in that epoch or
+    // later.
+    for (int i = 0; i < CONFIG_MAX_READERS; i++)
+    {
+        unsigned long long epoch = atomic_load(&store->readers[i].epoch);
+        if (epoch != 0 && (oldest == 0 || epoch < oldest))
+            oldest = epoch;
+    }
+
+    while (*link != NULL)
+    {
+        config_retired *r = *link;
+        if (oldest == 0 || r->epoch < oldest)
+        {
+            *link = r->next;
+            free(r->cfg);
+            free(r);
+        }
+        else
+        {
+            link = &r->next;
+        }
+    }
+}
+
+int config_store_init(config_store *store, const char *path)
+{
+    config first;
+
+    memset(store, 0, sizeof(*store));
+    atomic_init(&store->current, NULL);
+    atomic_init(&store->epoch, 1);
+    for (int i = 0; i < CONFIG_MAX_READERS; i++)
+    {
+        atomic_init(&store->readers[i].epoch, 0);
+        atomic_init(&store->readers[i].used, 0);
+    }
+
+    store->next_version = 1;
+    store->wake[0] = -1;
+    store->wake[1] = -1;
+    if (path != NULL && config_copy(store->path, path, strlen(path)))
+        return 1;
+
+    if (pthread_mutex_init(&store->lock, NULL))
+        return 1;
+
+    if (config_load(store->path, &first) || config_publish(store, &first))
+    {
+        pthread_mutex_destroy(&store->lock);
+        return 1;
+    }
+
+    return 0;
+}
+
+void config_store_free(config_store *store)
+{
+    config_watch_stop(store);
+
+    free(atomic_load(&store->current));
+    while (store->retired != NULL)
+    {
+        config_retired *r = store->retired;
+        store->retired = r->next;
+        free(r->cfg);
+        free(r);
+    }
+
+    pthread_mutex_destroy(&store->lock);
+}
+
+int config_reader_register(config_store *store)
+{
+    for (int i = 0; i < CONFIG_MAX_READERS; i++)
+    {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&store->readers[i].used, &expected, 1))
+            return i;
+    }
+
+    return -1;
+}
+
+void config_reader_unregister(config_store *store, int reader)
+{
+    atomic_store(&store->readers[reader].epoch, 0);
+    atomic_store(&store->readers[reader].used, 0);
+}
+
+int config_publish(config_store *store, const config *values)
+{
+    config *cfg = malloc(sizeof(*cfg));
+    config_retired *r = malloc(sizeof(*r));
+    config *old;
+
+    if (cfg == NULL || r == NULL)
+    {
+        free(cfg);
+        free(r);
+        return 1;
+    }
+
+    *cfg = *values;
+
+    pthread_mutex_lock(&store->lock);
+    cfg->version = store->next_version++;
+    old = atomic_exchange(&store->current, cfg);
+
+    // Readers that announce an epoch after this increment load the new
+    // version, so only readers from this epoch or before can have the old
+    // one.
+    if (old != NULL)
+    {
+        r->cfg = old;
+        r->epoch = atomic_fetch_add(&store->epoch, 1);
+        r->next = store->retired;
+        store->retired = r;
+    }
+    else
+    {
+        free(r);
+    }
+
+    config_reclaim(store);
+    pthread_mutex_unlock(&store->lock);
+    return 0;
+}
+
+int config_reload(config_store *store)
+{
+    config next;
+
+    if (config_load(store->path, &next))
+        return 1;
+
+    return config_publish(store, &next);
+}
+
+/**
+ * Tells the watcher thread about SIGHUP. Only async-signal-safe functions
+ * are called here.
+ *
+ * Params:
+ *   int - the signal
+ */
+static void config_on_signal(int sig)
+{
+    int saved = errno;
+    int fd = config_signal_fd;
+    char c = 'h';
+
+    (void)sig;
+    if (fd >= 0 && write(fd, &c, 1) < 0)
+    {
+        // The pipe is full, so the watcher already has a reload to do.
+    }
+    errno = saved;
+}
+
+/**
+ * Checks whether a file was changed since it was last seen, by comparing
+ * its inode, size and modification time.
+ *
+ * Params:
+ *   const char* - the path of the file
+ *   struct stat* - what the file looked like last time, which is updated
+ *
+ * Returns:
+ *   int - 1 if the file changed, 0 if not
+ */
+static int config_file_changed(const char *path, struct stat *last)
+{
+    struct stat now;
+
+    if (stat(path, &now) != 0)
+        memset(&now, 0, sizeof(now));
+
+    if (now.st_ino == last->st_ino && now.st_size == last->st_size && now.st_mtime == last->st_mtime)
+        return 0;
+
+    *last = now;
+    return 1;
+}
+
+/**
+ * The watcher thread. It sleeps in poll until the signal handler or
+ * config_watch_stop writes to the self-pipe, or the file changes.
+ *
+ * Params:
+ *   void* - the config_store
+ */
+static void *config_watch(void *arg)
+{
+    config_store *store = arg;
+    struct pollfd fds[2];
+    struct stat last;
+    int nfds = 1;
+    int timeout = store->path[0] != '\0' ? CONFIG_POLL_MS : -1;
+    int stop = 0;
+
+    memset(&last, 0, sizeof(last));
+    if (store->path[0] != '\0')
+        config_file_changed(store->path, &last);
+
+    fds[0].fd = store->wake[0];
+    fds[0].events = POLLIN;
+
+#ifdef __linux__
+    // Editors often save by writing a new file and renaming it over the old
+    // one, so the directory is watched rather than the file. Only a closed
+    // or renamed file is reloaded: a file that was just created is still
+    // empty or half written.
+    char dir[ENV_BUFF_SIZE];
+    const char *base = store->path;
+    int in = -1;
+
+    if (store->path[0] != '\0')
+    {
+        const char *slash = strrchr(store->path, '/');
+        if (slash == NULL)
+        {
+            strcpy(dir, ".");
+        }
+        else
+        {
+            // A file in the root directory keeps its '/'.
+            size_t len = slash == store->path ? 1 : (size_t)(slash - store->path);
+            memcpy(dir, store->path, len);
+            dir[len] = '\0';
+            base = slash + 1;
+        }
+
+        in = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (in >= 0 && inotify_add_watch(in, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            close(in);
+            in = -1;
+        }
+    }
+
+    if (in >= 0)
+    {
+        fds[1].fd = in;
+        fds[1].events = POLLIN;
+        nfds = 2;
+        timeout = -1;
+    }
+#endif
+
+    // The file may have changed between config_store_init and the watch
+    // being set up, which nothing would report.
+    if (store->path[0] != '\0')
+        config_reload(store);
+
+    while (!stop)
+    {
+        int reload = 0;
+        int n = poll(fds, (nfds_t)nfds, timeout);
+
+        if (n < 0 && errno != EINTR)
+            break;
+
+        if (n > 0 && (fds[0].revents & POLLIN))
+        {
+            char buf[64];
+            ssize_t got = read(fds[0].fd, buf, sizeof(buf));
+            for (ssize_t i = 0; i < got; i++)
+            {
+                if (buf[i] == 'q')
+                    stop = 1;
+                else
+                    reload = 1;
+            }
+        }
+
+#ifdef __linux__
+        if (in >= 0 && n > 0 && (fds[1].revents & POLLIN))
+        {
+            char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            ssize_t got;
+            while ((got = read(in, buf, sizeof(buf))) > 0)
+            {
+                for (char *p = buf; p < buf + got;)
+                {
+                    struct inotify_event *event = (struct inotify_event *)p;
+                    if (event->len > 0 && !strcmp(event->name, base))
+                        reload = 1;
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        }
+#endif
+
+        if (nfds == 1 && store->path[0] != '\0' && config_file_changed(store->path, &last))
+            reload = 1;
+
+        if (reload && !stop)
+            config_reload(store);
+    }
+
+#ifdef __linux__
+    if (in >= 0)
+        close(in);
+#endif
+    return NULL;
+}
+
+int config_watch_start(config_store *store)
+{
+    struct sigaction action;
+
+    if (store->watching || pipe(store->wake) != 0)
+        return 1;
+
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(store->wake[i], F_SETFL, fcntl(store->wake[i], F_GETFL) | O_NONBLOCK);
+        fcntl(store->wake[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    if (pthread_create(&store->watcher, NULL, config_watch, store))
+    {
+        close(store->wake[0]);
+        close(store->wake[1]);
+        store->wake[0] = -1;
+        store->wake[1] = -1;
+        return 1;
+    }
+    store->watching = 1;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = config_on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    config_signal_fd = store->wake[1];
+    sigaction(SIGHUP, &action, &config_old_action);
+    return 0;
+}
+
+void config_watch_stop(config_store *store)
+{
+    char c = 'q';
+
+    if (!store->watching)
+        return;
+
+    if (config_signal_fd == store->wake[1])
+    {
+        sigaction(SIGHUP, &config_old_action, NULL);
+        config_signal_fd = -1;
+    }
+
+    // If the pipe is full, the watcher is about to empty it.
+    while (write(store->wake[1], &c, 1) < 0 && (errno == EINTR || errno == EAGAIN))
+        sched_yield();
+    pthread_join(store->watcher, NULL);
+
+    close(store->wake[0]);
+    close(store->wake[1]);
+    store->wake[0] = -1;
+    store->wake[1] = -1;
+    store->watching = 0;
+}
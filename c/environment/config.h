@@ -0,0 +1,201 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include <pthread.h>
+
+#include "env.h"
+
+// The most threads that can read from a config_store at once.
+#define CONFIG_MAX_READERS 64
+
+// How often the watcher thread checks the file when it can't be told about
+// changes, in milliseconds.
+#define CONFIG_POLL_MS 500
+
+// One version of the configuration. A version never changes once it has
+// been published, so readers can use it without copying it.
+typedef struct config
+{
+    char username[ENV_BUFF_SIZE];
+    char password[ENV_BUFF_SIZE];
+    char host[ENV_BUFF_SIZE];
+    long port;
+    unsigned long version; // 1 for the first version, then counting up
+} config;
+
+// A version that was replaced, and the epoch it was replaced in.
+typedef struct config_retired
+{
+    config *cfg;
+    unsigned long long epoch;
+    struct config_retired *next;
+} config_retired;
+
+// What each reading thread announces. Slots are a cache line each, so
+// readers don't slow each other down.
+typedef struct config_reader_slot
+{
+    _Alignas(64) atomic_ullong epoch; // 0 while the thread isn't reading
+    atomic_int used;
+} config_reader_slot;
+
+// The current configuration, which can be replaced while other threads are
+// reading it.
+//
+// A new version is published by swapping a pointer, so readers never wait:
+// config_read_begin announces the current epoch in the reader's slot and
+// loads the pointer, and config_read_end clears the slot. An old version is
+// freed only once every reader that might still be using it has moved on,
+// which is when no slot holds an epoch from before the version was
+// replaced. This is epoch-based reclamation.
+//
+// Versions are built from the EXAMPLE_* environment variables and, if the
+// store has a file, from KEY=VALUE lines in the file, which take priority.
+// config_reload builds a new version. config_watch_start starts a thread
+// that reloads when the process gets SIGHUP or when the file changes.
+//
+// Publishing is serialized with a mutex, which readers never touch.
+typedef struct config_store
+{
+    _Atomic(config *) current;
+    atomic_ullong epoch;
+    config_reader_slot readers[CONFIG_MAX_READERS];
+
+    pthread_mutex_t lock; // held while publishing
+    config_retired *retired;
+    unsigned long next_version;
+    char path[ENV_BUFF_SIZE]; // the file, or "" if there isn't one
+
+    pthread_t watcher;
+    int watching;
+    int wake[2]; // the watcher's self-pipe
+} config_store;
+
+/**
+ * Loads the first version of the configuration.
+ *
+ * Params:
+ *   config_store* - the store to initialize
+ *   const char* - the path of a file of KEY=VALUE lines, or NULL
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the configuration couldn't be loaded
+ */
+int config_store_init(config_store *store, const char *path);
+
+/**
+ * Stops the watcher and frees every version. No thread may be reading.
+ *
+ * Params:
+ *   config_store* - the store
+ */
+void config_store_free(config_store *store);
+
+/**
+ * Claims a reader slot for the calling thread. Each thread that reads
+ * needs its own slot.
+ *
+ * Params:
+ *   config_store* - the store
+ *
+ * Returns:
+ *   int - the slot, or -1 if all CONFIG_MAX_READERS are taken
+ */
+int config_reader_register(config_store *store);
+
+/**
+ * Gives back a reader slot.
+ *
+ * Params:
+ *   config_store* - the store
+ *   int - the slot
+ */
+void config_reader_unregister(config_store *store, int reader);
+
+/**
+ * Gets the current version. It stays valid until config_read_end, even if
+ * a new version is published in the meantime. Never blocks.
+ *
+ * Calls can't be nested on one slot: a second config_read_begin before
+ * config_read_end replaces the epoch of the first, so the version the first
+ * one returned could be freed while it is still in use.
+ *
+ * Params:
+ *   config_store* - the store
+ *   int - the reader slot of the calling thread
+ *
+ * Returns:
+ *   const config* - the current version
+ */
+static inline const config *config_read_begin(config_store *store, int reader)
+{
+    // The epoch must be announced before the pointer is loaded, which the
+    // default sequentially consistent ordering guarantees.
+    atomic_store(&store->readers[reader].epoch, atomic_load(&store->epoch));
+    return atomic_load(&store->current);
+}
+
+/**
+ * Finishes with the version from config_read_begin.
+ *
+ * Params:
+ *   config_store* - the store
+ *   int - the reader slot of the calling thread
+ */
+static inline void config_read_end(config_store *store, int reader)
+{
+    atomic_store_explicit(&store->readers[reader].epoch, 0, memory_order_release);
+}
+
+/**
+ * Publishes a new version and frees old versions that no reader can still
+ * be using. The version number is filled in by the store.
+ *
+ * Params:
+ *   config_store* - the store
+ *   const config* - the values of the new version, which are copied
+ *
+ * Returns:
+ *   int - 0 on success, 1 if there wasn't enough memory
+ */
+int config_publish(config_store *store, const config *values);
+
+/**
+ * Builds a new version from the environment and the file, and publishes
+ * it. If the file can't be read or has an invalid value, the current
+ * version is kept.
+ *
+ * Params:
+ *   config_store* - the store
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int config_reload(config_store *store);
+
+/**
+ * Starts a thread that reloads the configuration when the process gets
+ * SIGHUP, or when the file changes. On Linux, changes to the file are
+ * found with inotify; elsewhere, the file is checked every CONFIG_POLL_MS.
+ * Only one store in a process can handle SIGHUP.
+ *
+ * Params:
+ *   config_store* - the store
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int config_watch_start(config_store *store);
+
+/**
+ * Stops the thread started by config_watch_start.
+ *
+ * Params:
+ *   config_store* - the store
+ */
+void config_watch_stop(config_store *store);
+
+#endif
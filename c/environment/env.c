@@ -0,0 +1,189 @@
+#include "env.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The environment of the process, as NAME=value strings ending with NULL.
+#ifdef _WIN32
+#define ENV_ENVIRON _environ
+#else
+extern char **environ;
+#define ENV_ENVIRON environ
+#endif
+
+void load_env_var(const char *name, char *buffer)
+{
+    // According to https://en.cppreference.com/w/c/program/getenv
+    // getenv_s is only guaranteed to be available if __STDC_LIB_EXT1__ is
+    // defined by the implementation and __STDC_WANT_LIB_EXT1__ is set to 1
+    // before including stdlib.h.
+    // However, on current versions of MSVC, the _s version of most IO
+    // functions is available, in which case a deprecation warning will be
+    // present when using the older versions of those functions.
+    // Defining _CRT_SECURE_NO_WARNINGS will disable this warning, but
+    // ideally, it's safest to use the _s version for their bounds checking.
+#if (defined(__STDC_LIB_EXT1__) && __STDC_WANT_LIB_EXT1__ == 1) || \
+    (defined(_WIN32) && !defined(_CRT_SECURE_NO_WARNINGS))
+    size_t res_count;
+    if (getenv_s(&res_count, buffer, ENV_BUFF_SIZE, name))
+    {
+        buffer[0] = '\0';
+        return;
+    }
+
+    if (res_count < ENV_BUFF_SIZE)
+    {
+        buffer[res_count] = '\0';
+        return;
+    }
+
+    buffer[0] = '\0';
+#else
+    char *v = getenv(name);
+    if (v == NULL)
+    {
+        buffer[0] = '\0';
+        return;
+    }
+
+    size_t l = strlen(v);
+    if (l >= ENV_BUFF_SIZE)
+    {
+        buffer[0] = '\0';
+        return;
+    }
+
+    for (size_t i = 0; i < l; i++)
+    {
+        buffer[i] = v[i];
+    }
+    buffer[l] = '\0';
+#endif
+}
+
+/**
+ * Hashes a variable name with FNV-1a. The name ends at a NUL or an '=', so
+ * the name of an entry in the environment can be hashed in place.
+ *
+ * Params:
+ *   const char* - the name
+ *   size_t* - receives the length of the name
+ *
+ * Returns:
+ *   unsigned int - the hash
+ */
+static unsigned int env_hash(const char *name, size_t *len)
+{
+    unsigned int h = 2166136261u;
+    size_t i = 0;
+
+    for (; name[i] != '\0' && name[i] != '='; i++)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+
+    *len = i;
+    return h;
+}
+
+int env_snapshot_init(env_snapshot *snap, const env_key *keys, size_t nkeys)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    if (nkeys > ENV_SNAPSHOT_MAX_KEYS)
+        return 1;
+
+    for (size_t k = 0; k < nkeys; k++)
+    {
+        size_t len;
+        unsigned int h = env_hash(keys[k].name, &len);
+        size_t i = h & (ENV_SNAPSHOT_SLOTS - 1);
+
+        if (keys[k].type >= ENV_TYPE_MAX || env_snapshot_find(snap, keys[k].name) != NULL)
+            return 1;
+
+        while (snap->slots[i].name != NULL)
+            i = (i + 1) & (ENV_SNAPSHOT_SLOTS - 1);
+
+        snap->slots[i].name = keys[k].name;
+        snap->slots[i].hash = h;
+        snap->slots[i].type = keys[k].type;
+        snap->count++;
+    }
+
+    // One pass over the environment finds every key. Like getenv, the first
+    // entry with a name wins.
+    for (char **e = ENV_ENVIRON; e != NULL && *e != NULL; e++)
+    {
+        size_t len;
+        unsigned int h = env_hash(*e, &len);
+
+        if ((*e)[len] != '=')
+            continue;
+
+        for (size_t i = h & (ENV_SNAPSHOT_SLOTS - 1); snap->slots[i].name != NULL;
+             i = (i + 1) & (ENV_SNAPSHOT_SLOTS - 1))
+        {
+            env_value *v = &snap->slots[i];
+            if (v->hash != h || strncmp(v->name, *e, len) != 0 || v->name[len] != '\0')
+                continue;
+
+            if (!v->present)
+            {
+                v->present = 1;
+                v->str.ptr = *e + len + 1;
+                v->str.len = strlen(v->str.ptr);
+
+                if (v->type == ENV_TYPE_INT)
+                {
+                    char *end;
+                    errno = 0;
+                    v->num = strtol(v->str.ptr, &end, 10);
+                    v->parsed = end != v->str.ptr && *end == '\0' && errno == 0;
+                }
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+const env_value *env_snapshot_find(const env_snapshot *snap, const char *name)
+{
+    size_t len;
+    unsigned int h = env_hash(name, &len);
+
+    // The table is never more than half full, so there's always an empty
+    // slot to stop at.
+    for (size_t i = h & (ENV_SNAPSHOT_SLOTS - 1); snap->slots[i].name != NULL; i = (i + 1) & (ENV_SNAPSHOT_SLOTS - 1))
+    {
+        const env_value *v = &snap->slots[i];
+        if (v->hash == h && strcmp(v->name, name) == 0)
+            return v;
+    }
+
+    return NULL;
+}
+
+int env_snapshot_str(const env_snapshot *snap, const char *name, env_str *value)
+{
+    const env_value *v = env_snapshot_find(snap, name);
+    if (v == NULL || !v->present)
+        return 1;
+
+    *value = v->str;
+    return 0;
+}
+
+int env_snapshot_int(const env_snapshot *snap, const char *name, long *value)
+{
+    const env_value *v = env_snapshot_find(snap, name);
+    if (v == NULL || v->type != ENV_TYPE_INT || !v->present || !v->parsed)
+        return 1;
+
+    *value = v->num;
+    return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include <stddef.h>
+
+// The maximum size of the buffers used to hold our environment variables.
+#define ENV_BUFF_SIZE 256
+
+// The number of slots in an env_snapshot's hash table. Must be a power of 2
+// and at least twice the number of keys.
+#define ENV_SNAPSHOT_SLOTS 64
+
+// The most keys an env_snapshot can hold.
+#define ENV_SNAPSHOT_MAX_KEYS (ENV_SNAPSHOT_SLOTS / 2)
+
+// How the value of a key is parsed when the snapshot is made.
+typedef enum env_type
+{
+    ENV_TYPE_STRING = 0,
+    ENV_TYPE_INT,
+    ENV_TYPE_MAX,
+} env_type;
+
+// A key to look for, like {"EXAMPLE_PORT", ENV_TYPE_INT}.
+typedef struct env_key
+{
+    const char *name;
+    env_type type;
+} env_key;
+
+// A piece of a string that isn't NUL-terminated at its end, like a
+// std::string_view. Print it with printf("%.*s", (int)s.len, s.ptr).
+typedef struct env_str
+{
+    const char *ptr;
+    size_t len;
+} env_str;
+
+// One key in an env_snapshot, and its value if the variable is set.
+typedef struct env_value
+{
+    const char *name;   // the key's name, or NULL if the slot is empty
+    unsigned int hash;  // the hash of the name
+    env_type type;
+    int present;        // whether the variable is set
+    int parsed;         // whether an ENV_TYPE_INT value is a valid number
+    env_str str;        // the value as it is in the environment
+    long num;           // the value as a number, for ENV_TYPE_INT
+} env_value;
+
+// A set of environment variables read once and kept ready for lookups.
+//
+// Reading a variable with getenv scans the whole environment and compares
+// the name with every entry, and a number then has to be parsed again every
+// time it's read. A snapshot scans the environment once for every key it
+// was given, parses numbers at the same time, and puts the keys in a hash
+// table, so a lookup hashes the name and usually compares one string.
+//
+// The values aren't copied: each env_str points into the environment
+// itself. They stay valid until the variable is changed with setenv,
+// putenv or unsetenv, after which the snapshot should be made again.
+typedef struct env_snapshot
+{
+    env_value slots[ENV_SNAPSHOT_SLOTS];
+    size_t count; // the number of keys
+} env_snapshot;
+
+/**
+ * Reads an environment variable into a character buffer.
+ *
+ * Params:
+ *   cosnt char* - the name of the environment variable.
+ *   char* - the buffer to receive the environment variable value
+ */
+void load_env_var(const char *name, char *buffer);
+
+/**
+ * Makes a snapshot of some environment variables.
+ *
+ * Params:
+ *   env_snapshot* - the snapshot to initialize
+ *   const env_key* - the keys to read
+ *   size_t - the number of keys, up to ENV_SNAPSHOT_MAX_KEYS
+ *
+ * Returns:
+ *   int - 0 on success, 1 if there are too many keys or a key is repeated
+ *         or has an invalid type
+ */
+int env_snapshot_init(env_snapshot *snap, const env_key *keys, size_t nkeys);
+
+/**
+ * Finds a key in a snapshot.
+ *
+ * Params:
+ *   const env_snapshot* - the snapshot
+ *   const char* - the name of the key
+ *
+ * Returns:
+ *   const env_value* - the key, or NULL if it isn't in the snapshot
+ */
+const env_value *env_snapshot_find(const env_snapshot *snap, const char *name);
+
+/**
+ * Gets the value of a variable as a string, without copying it.
+ *
+ * Params:
+ *   const env_snapshot* - the snapshot
+ *   const char* - the name of the variable
+ *   env_str* - receives the value
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the key isn't in the snapshot or the variable
+ *         isn't set
+ */
+int env_snapshot_str(const env_snapshot *snap, const char *name, env_str *value);
+
+/**
+ * Gets the value of an ENV_TYPE_INT variable, which was parsed when the
+ * snapshot was made.
+ *
+ * Params:
+ *   const env_snapshot* - the snapshot
+ *   const char* - the name of the variable
+ *   long* - receives the value
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the key isn't in the snapshot, isn't an
+ *         ENV_TYPE_INT key, or the variable isn't set or isn't a number
+ */
+int env_snapshot_int(const env_snapshot *snap, const char *name, long *value);
+
+#endif
@@ -1,2 +1,10 @@
+# The reloadable configuration in config.c uses a watcher thread and C11
+# atomics, so it's built with -pthread.
+
+SRC = env.c config.c
+
 all:
-	gcc -Wall -Werror main.c -o environment.out
+	gcc -Wall -Werror -pthread main.c $(SRC) -o environment.out
+
+bench:
+	gcc -Wall -Werror -O2 -pthread bench.c $(SRC) -o bench.out
@@ -1,2 +1,10 @@
+# The reloadable configuration in config.c uses a watcher thread and C11
+# atomics, so it's built with -pthread.
+
+SRC = env.c config.c
+
 all:
-	clang -Wall -Werror main.c -o environment.out
+	clang -Wall -Werror -pthread main.c $(SRC) -o environment.out
+
+bench:
+	clang -Wall -Werror -O2 -pthread bench.c $(SRC) -o bench.out
@@ -3,65 +3,11 @@
 #include <stdio.h>
 #include <string.h>
 
-// The maximum size of the buffers used to hold our environment variables.
-#define ENV_BUFF_SIZE 256
+#include "env.h"
 
-/**
- * Reads an environment variable into a character buffer.
- *
- * Params:
- *   cosnt char* - the name of the environment variable.
- *   char* - the buffer to receive the environment variable value
- */
-void load_env_var(const char *name, char *buffer)
-{
-    // According to https://en.cppreference.com/w/c/program/getenv
-    // getenv_s is only guaranteed to be available if __STDC_LIB_EXT1__ is
-    // defined by the implementation and __STDC_WANT_LIB_EXT1__ is set to 1
-    // before including stdlib.h.
-    // However, on current versions of MSVC, the _s version of most IO
-    // functions is available, in which case a deprecation warning will be
-    // present when using the older versions of those functions.
-    // Defining _CRT_SECURE_NO_WARNINGS will disable this warning, but
-    // ideally, it's safest to use the _s version for their bounds checking.
-#if (defined(__STDC_LIB_EXT1__) && __STDC_WANT_LIB_EXT1__ == 1) || \
-    (defined(_WIN32) && !defined(_CRT_SECURE_NO_WARNINGS))
-    size_t res_count;
-    if (getenv_s(&res_count, buffer, ENV_BUFF_SIZE, name))
-    {
-        buffer[0] = '\0';
-        return;
-    }
-
-    if (res_count < ENV_BUFF_SIZE)
-    {
-        buffer[res_count] = '\0';
-        return;
-    }
-
-    buffer[0] = '\0';
-#else
-    char *v = getenv(name);
-    if (v == NULL)
-    {
-        buffer[0] = '\0';
-        return;
-    }
-
-    size_t l = strlen(v);
-    if (l >= ENV_BUFF_SIZE)
-    {
-        buffer[0] = '\0';
-        return;
-    }
-
-    for (size_t i = 0; i < l; i++)
-    {
-        buffer[i] = v[i];
-    }
-    buffer[l] = '\0';
+#ifndef _WIN32
+#include "config.h"
 #endif
-}
 
 int main()
 {
@@ -83,5 +29,59 @@ int main()
     long n_number = strtol(&e_number[0], NULL, 10);
     printf("port (as an actual number): %ld\n", n_number);
 
+    // A snapshot reads the environment once and parses the port right
+    // away. Its lookups don't copy anything, so it suits code that reads
+    // the configuration over and over.
+    env_key keys[] = {
+        {"EXAMPLE_USERNAME", ENV_TYPE_STRING},
+        {"EXAMPLE_PASSWORD", ENV_TYPE_STRING},
+        {"EXAMPLE_HOST", ENV_TYPE_STRING},
+        {"EXAMPLE_PORT", ENV_TYPE_INT},
+    };
+    env_snapshot snap;
+    if (env_snapshot_init(&snap, keys, sizeof(keys) / sizeof(keys[0])))
+        return 1;
+
+    env_str host;
+    long port;
+    if (!env_snapshot_str(&snap, "EXAMPLE_HOST", &host))
+        printf("host from the snapshot: %.*s\n", (int)host.len, host.ptr);
+    if (!env_snapshot_int(&snap, "EXAMPLE_PORT", &port))
+        printf("port from the snapshot: %ld\n", port);
+
+#ifndef _WIN32
+    // A config_store can be reloaded while the program runs, from the
+    // environment and an optional file named by EXAMPLE_CONFIG_FILE. Readers
+    // get the current version without taking a lock, and an old version is
+    // freed once no reader can be using it.
+    config_store store;
+    if (config_store_init(&store, getenv("EXAMPLE_CONFIG_FILE")))
+        return 1;
+
+    int reader = config_reader_register(&store);
+    if (reader < 0)
+    {
+        config_store_free(&store);
+        return 1;
+    }
+
+    const config *cfg = config_read_begin(&store, reader);
+    printf("config version %lu: %s:%ld\n", cfg->version, cfg->host, cfg->port);
+    config_read_end(&store, reader);
+
+    // config_watch_start would reload on SIGHUP or when the file changes.
+    // Here the port is changed and the store is reloaded by hand.
+    setenv("EXAMPLE_PORT", "9090", 1);
+    if (config_reload(&store) == 0)
+    {
+        cfg = config_read_begin(&store, reader);
+        printf("config version %lu: %s:%ld\n", cfg->version, cfg->host, cfg->port);
+        config_read_end(&store, reader);
+    }
+
+    config_reader_unregister(&store, reader);
+    config_store_free(&store);
+#endif
+
     return 0;
 }
@@ -1,2 +1,10 @@
+# The reloadable configuration in config.c needs POSIX signals and
+# pthreads, so it isn't built on Windows.
+
+SRC = env.c
+
 all:
-	gcc -Wall -Werror main.c -o environment.exe
+	gcc -Wall -Werror main.c $(SRC) -o environment.exe
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.exe
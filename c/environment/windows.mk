@@ -1,2 +1,10 @@
+# The reloadable configuration in config.c needs POSIX signals and
+# pthreads, so it isn't built on Windows.
+
+SRC = env.c
+
 all:
-	cl /W3 /WX main.c /Fe"environment.exe"
+	cl /W3 /WX main.c $(SRC) /Fe"environment.exe"
+
+bench:
+	cl /W3 /WX /O2 bench.c $(SRC) /Fe"bench.exe"
@@ -0,0 +1,563 @@
+#include "async.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// io_uring is used through its system calls directly so that liburing isn't
+// needed. The thread pool uses pthreads, and everywhere else requests are
+// simply completed as they are submitted.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_HAVE_URING
+#endif
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#define ASYNC_HAVE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef ASYNC_HAVE_URING
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// How many times a submission that the kernel can't take right now is
+// retried before its requests are failed.
+#define ASYNC_SUBMIT_RETRIES 64
+#endif
+
+const char *async_backend_names[ASYNC_BACKEND_MAX] = {
+    "auto",
+    "io_uring",
+    "threads",
+    "sync"};
+
+#ifdef ASYNC_HAVE_URING
+// The parts of the shared submission and completion rings that we use.
+typedef struct uring
+{
+    int fd;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} uring;
+#endif
+
+// A fixed-size queue of request pointers.
+typedef struct request_ring
+{
+    async_request *items[ASYNC_MAX_DEPTH];
+    unsigned head;
+    unsigned count;
+} request_ring;
+
+struct async_context
+{
+    async_backend backend;
+    unsigned depth;
+    unsigned inflight;   // submitted but not yet returned by async_wait
+    request_ring done;   // completed but not yet returned by async_wait
+
+#ifdef ASYNC_HAVE_URING
+    uring ring;
+#endif
+
+#ifdef ASYNC_HAVE_THREADS
+    pthread_t threads[ASYNC_MAX_DEPTH];
+    unsigned thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    request_ring pending; // submitted but not yet picked up by a thread
+    int stopping;
+#endif
+};
+
+static void ring_push(request_ring *r, async_request *req)
+{
+    r->items[(r->head + r->count) % ASYNC_MAX_DEPTH] = req;
+    r->count++;
+}
+
+static async_request *ring_pop(request_ring *r)
+{
+    async_request *req = r->items[r->head];
+    r->head = (r->head + 1) % ASYNC_MAX_DEPTH;
+    r->count--;
+    return req;
+}
+
+// Performs a request on the calling thread.
+static void execute(async_request *req)
+{
+#ifdef _WIN32
+    if (_lseeki64(req->fd, (long long)req->offset, SEEK_SET) < 0)
+    {
+        req->result = -1;
+        return;
+    }
+
+    if (req->op == ASYNC_READ)
+        req->result = _read(req->fd, req->buffer, (unsigned int)req->len);
+    else
+        req->result = _write(req->fd, req->buffer, (unsigned int)req->len);
+#else
+    if (req->op == ASYNC_READ)
+        req->result = pread(req->fd, req->buffer, req->len, (off_t)req->offset);
+    else
+        req->result = pwrite(req->fd, req->buffer, req->len, (off_t)req->offset);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// io_uring
+
+#ifdef ASYNC_HAVE_URING
+// Checks that the kernel supports IORING_OP_READ and IORING_OP_WRITE. Both
+// came with 5.6, like IORING_REGISTER_PROBE, so older kernels that have
+// io_uring fail the probe and the thread pool is used instead.
+static int uring_probe(int fd)
+{
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    int ok;
+
+    if (probe == NULL)
+        return 1;
+
+    ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+         probe->last_op >= IORING_OP_WRITE &&
+         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+         (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+    return !ok;
+}
+
+static int uring_init(uring *u, unsigned depth)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    u->fd = (int)syscall(__NR_io_uring_setup, depth, &p);
+    if (u->fd < 0)
+        return 1;
+
+    if (uring_probe(u->fd))
+    {
+        close(u->fd);
+        return 1;
+    }
+
+    u->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels let both rings share one mapping.
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (u->cq_len > u->sq_len)
+            u->sq_len = u->cq_len;
+        u->cq_len = u->sq_len;
+    }
+
+    u->sq_ptr = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED)
+    {
+        close(u->fd);
+        return 1;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        u->cq_ptr = u->sq_ptr;
+    }
+    else
+    {
+        u->cq_ptr = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED)
+        {
+            munmap(u->sq_ptr, u->sq_len);
+            close(u->fd);
+            return 1;
+        }
+    }
+
+    u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED)
+    {
+        if (u->cq_ptr != u->sq_ptr)
+            munmap(u->cq_ptr, u->cq_len);
+        munmap(u->sq_ptr, u->sq_len);
+        close(u->fd);
+        return 1;
+    }
+
+    u->sq_tail = (unsigned *)((char *)u->sq_ptr + p.sq_off.tail);
+    u->sq_mask = (unsigned *)((char *)u->sq_ptr + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)((char *)u->sq_ptr + p.sq_off.array);
+    u->cq_head = (unsigned *)((char *)u->cq_ptr + p.cq_off.head);
+    u->cq_tail = (unsigned *)((char *)u->cq_ptr + p.cq_off.tail);
+    u->cq_mask = (unsigned *)((char *)u->cq_ptr + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)((char *)u->cq_ptr + p.cq_off.cqes);
+
+    return 0;
+}
+
+static void uring_destroy(uring *u)
+{
+    munmap(u->sqes, u->sqes_len);
+    if (u->cq_ptr != u->sq_ptr)
+        munmap(u->cq_ptr, u->cq_len);
+    munmap(u->sq_ptr, u->sq_len);
+    close(u->fd);
+}
+
+static int uring_enter(uring *u, unsigned to_submit, unsigned min_complete)
+{
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    return (int)syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+// Puts a batch of requests in the submission ring and hands them to the
+// kernel, usually with one system call. The kernel may take fewer entries
+// than it was given, or none when it is short of resources, so the rest
+// are submitted again. Entries that still aren't taken are removed from the
+// ring, which is safe because the kernel only reads the ring during
+// io_uring_enter.
+//
+// Returns the number of requests the kernel took, which are the first ones.
+static size_t uring_submit(uring *u, async_request **reqs, size_t n)
+{
+    size_t submitted = 0;
+    int retries = 0;
+    unsigned tail = *u->sq_tail;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned index = tail & *u->sq_mask;
+        struct io_uring_sqe *sqe = &u->sqes[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = reqs[i]->op == ASYNC_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = reqs[i]->fd;
+        sqe->addr = (uintptr_t)reqs[i]->buffer;
+        sqe->len = (unsigned)reqs[i]->len;
+        sqe->off = reqs[i]->offset;
+        sqe->user_data = (uintptr_t)reqs[i];
+
+        u->sq_array[index] = index;
+        tail++;
+    }
+
+    // The kernel must see the entries before it sees the new tail.
+    __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+
+    while (submitted < n)
+    {
+        int res = uring_enter(u, (unsigned)(n - submitted), 0);
+
+        if (res > 0)
+        {
+            submitted += (size_t)res;
+            continue;
+        }
+
+        if (res < 0 && errno == EINTR)
+            continue;
+
+        if ((res == 0 || errno == EAGAIN || errno == EBUSY) && retries++ < ASYNC_SUBMIT_RETRIES)
+        {
+            sched_yield();
+            continue;
+        }
+
+        __atomic_store_n(u->sq_tail, tail - (unsigned)(n - submitted), __ATOMIC_RELEASE);
+        break;
+    }
+
+    return submitted;
+}
+
+static size_t uring_reap(uring *u, async_request **done, size_t max)
+{
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    size_t n = 0;
+
+    while (head != tail && n < max)
+    {
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        async_request *req = (async_request *)(uintptr_t)cqe->user_data;
+
+        req->result = cqe->res < 0 ? -1 : cqe->res;
+        done[n++] = req;
+        head++;
+    }
+
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// thread pool
+
+#ifdef ASYNC_HAVE_THREADS
+static void *worker_main(void *arg)
+{
+    async_context *ctx = arg;
+
+    pthread_mutex_lock(&ctx->lock);
+    for (;;)
+    {
+        async_request *req;
+
+        while (ctx->pending.count == 0 && !ctx->stopping)
+            pthread_cond_wait(&ctx->work_ready, &ctx->lock);
+
+        if (ctx->pending.count == 0)
+            break;
+
+        req = ring_pop(&ctx->pending);
+
+        pthread_mutex_unlock(&ctx->lock);
+        execute(req);
+        pthread_mutex_lock(&ctx->lock);
+
+        ring_push(&ctx->done, req);
+        pthread_cond_signal(&ctx->work_done);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    return NULL;
+}
+
+static int pool_init(async_context *ctx)
+{
+    ctx->thread_count = 0;
+    ctx->pending.head = 0;
+    ctx->pending.count = 0;
+    ctx->stopping = 0;
+
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->work_ready, NULL);
+    pthread_cond_init(&ctx->work_done, NULL);
+
+    // One thread per slot lets every request in flight block in the kernel
+    // at the same time, just like it would with io_uring.
+    for (unsigned i = 0; i < ctx->depth; i++)
+    {
+        if (pthread_create(&ctx->threads[i], NULL, worker_main, ctx))
+            break;
+        ctx->thread_count++;
+    }
+
+    return ctx->thread_count == 0;
+}
+
+static void pool_destroy(async_context *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stopping = 1;
+    pthread_cond_broadcast(&ctx->work_ready);
+    pthread_mutex_unlock(&ctx->lock);
+
+    for (unsigned i = 0; i < ctx->thread_count; i++)
+        pthread_join(ctx->threads[i], NULL);
+
+    pthread_cond_destroy(&ctx->work_done);
+    pthread_cond_destroy(&ctx->work_ready);
+    pthread_mutex_destroy(&ctx->lock);
+}
+#endif
+
+//----------------------------------------------------------------------------
+
+int async_init(async_context **ctx, unsigned depth, async_backend backend)
+{
+    async_context *c;
+
+    if (depth < 1)
+        depth = 1;
+    if (depth > ASYNC_MAX_DEPTH)
+        depth = ASYNC_MAX_DEPTH;
+
+    c = malloc(sizeof(async_context));
+    if (c == NULL)
+        return 1;
+
+    c->depth = depth;
+    c->inflight = 0;
+    c->done.head = 0;
+    c->done.count = 0;
+
+    // Each backend is tried in order of preference until one works.
+#ifdef ASYNC_HAVE_URING
+    if ((backend == ASYNC_BACKEND_AUTO || backend == ASYNC_BACKEND_URING) && !uring_init(&c->ring, depth))
+    {
+        c->backend = ASYNC_BACKEND_URING;
+        *ctx = c;
+        return 0;
+    }
+#endif
+
+#ifdef ASYNC_HAVE_THREADS
+    if ((backend == ASYNC_BACKEND_AUTO || backend == ASYNC_BACKEND_THREADS) && !pool_init(c))
+    {
+        c->backend = ASYNC_BACKEND_THREADS;
+        *ctx = c;
+        return 0;
+    }
+#endif
+
+    if (backend == ASYNC_BACKEND_AUTO || backend == ASYNC_BACKEND_SYNC)
+    {
+        c->backend = ASYNC_BACKEND_SYNC;
+        *ctx = c;
+        return 0;
+    }
+
+    free(c);
+    return 1;
+}
+
+async_backend async_get_backend(const async_context *ctx)
+{
+    return ctx->backend;
+}
+
+size_t async_submit(async_context *ctx, async_request **reqs, size_t n)
+{
+    if (n > ctx->depth - ctx->inflight)
+        n = ctx->depth - ctx->inflight;
+    if (n == 0)
+        return 0;
+
+    ctx->inflight += (unsigned)n;
+
+    switch (ctx->backend)
+    {
+#ifdef ASYNC_HAVE_URING
+    case ASYNC_BACKEND_URING:
+        // Requests the kernel never took complete with an error, so that
+        // async_wait doesn't wait for them forever.
+        for (size_t i = uring_submit(&ctx->ring, reqs, n); i < n; i++)
+        {
+            reqs[i]->result = -1;
+            ring_push(&ctx->done, reqs[i]);
+        }
+        break;
+#endif
+#ifdef ASYNC_HAVE_THREADS
+    case ASYNC_BACKEND_THREADS:
+        pthread_mutex_lock(&ctx->lock);
+        for (size_t i = 0; i < n; i++)
+            ring_push(&ctx->pending, reqs[i]);
+        pthread_cond_broadcast(&ctx->work_ready);
+        pthread_mutex_unlock(&ctx->lock);
+        break;
+#endif
+    default:
+        for (size_t i = 0; i < n; i++)
+        {
+            execute(reqs[i]);
+            ring_push(&ctx->done, reqs[i]);
+        }
+        break;
+    }
+
+    return n;
+}
+
+size_t async_wait(async_context *ctx, async_request **done, size_t min, size_t max)
+{
+    size_t n = 0;
+
+    if (max > ctx->inflight)
+        max = ctx->inflight;
+    if (min > max)
+        min = max;
+
+    switch (ctx->backend)
+    {
+#ifdef ASYNC_HAVE_URING
+    case ASYNC_BACKEND_URING:
+        // Requests that failed to submit come first, then what the kernel
+        // has completed.
+        while (ctx->done.count > 0 && n < max)
+            done[n++] = ring_pop(&ctx->done);
+        n += uring_reap(&ctx->ring, done + n, max - n);
+        while (n < min)
+        {
+            uring_enter(&ctx->ring, 0, (unsigned)(min - n));
+            n += uring_reap(&ctx->ring, done + n, max - n);
+        }
+        break;
+#endif
+#ifdef ASYNC_HAVE_THREADS
+    case ASYNC_BACKEND_THREADS:
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->done.count < min)
+            pthread_cond_wait(&ctx->work_done, &ctx->lock);
+        while (ctx->done.count > 0 && n < max)
+            done[n++] = ring_pop(&ctx->done);
+        pthread_mutex_unlock(&ctx->lock);
+        break;
+#endif
+    default:
+        while (ctx->done.count > 0 && n < max)
+            done[n++] = ring_pop(&ctx->done);
+        break;
+    }
+
+    ctx->inflight -= (unsigned)n;
+    return n;
+}
+
+void async_destroy(async_context *ctx)
+{
+    async_request *done[ASYNC_MAX_DEPTH];
+
+    while (ctx->inflight > 0)
+        async_wait(ctx, done, 1, ASYNC_MAX_DEPTH);
+
+#ifdef ASYNC_HAVE_URING
+    if (ctx->backend == ASYNC_BACKEND_URING)
+        uring_destroy(&ctx->ring);
+#endif
+#ifdef ASYNC_HAVE_THREADS
+    if (ctx->backend == ASYNC_BACKEND_THREADS)
+        pool_destroy(ctx);
+#endif
+
+    free(ctx);
+}
+
+int async_fileno(FILE *stream)
+{
+    if (fflush(stream))
+        return -1;
+
+#ifdef _WIN32
+    return _fileno(stream);
+#else
+    return fileno(stream);
+#endif
+}
@@ -0,0 +1,119 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The largest queue depth accepted by async_init.
+#define ASYNC_MAX_DEPTH 256
+
+// Backends for async_init.
+typedef enum async_backend
+{
+    ASYNC_BACKEND_AUTO = 0, // io_uring if the kernel supports it, otherwise threads
+    ASYNC_BACKEND_URING,    // Linux io_uring
+    ASYNC_BACKEND_THREADS,  // a pool of threads calling pread and pwrite
+    ASYNC_BACKEND_SYNC,     // requests complete during async_submit
+    ASYNC_BACKEND_MAX,
+} async_backend;
+
+typedef enum async_op
+{
+    ASYNC_READ = 0,
+    ASYNC_WRITE,
+} async_op;
+
+// A single read or write.
+// The request and its buffer must stay valid until the request is returned
+// by async_wait.
+typedef struct async_request
+{
+    int fd;           // the file descriptor, see async_fileno
+    async_op op;      // ASYNC_READ or ASYNC_WRITE
+    void *buffer;     // the data to write, or the destination of a read
+    size_t len;       // the number of bytes to transfer
+    uint64_t offset;  // the position in the file
+    long long result; // the number of bytes transferred, or -1 on failure
+    void *user;       // anything the caller wants to associate with the request
+} async_request;
+
+// A queue of requests handled by one of the backends.
+typedef struct async_context async_context;
+
+extern const char *async_backend_names[ASYNC_BACKEND_MAX];
+
+/**
+ * Creates a queue that can have up to depth requests in flight.
+ *
+ * Params:
+ *   async_context** - receives the new queue
+ *   unsigned - the queue depth, which is clamped to 1..ASYNC_MAX_DEPTH
+ *   async_backend - the backend to use
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the backend is not available
+ */
+int async_init(async_context **ctx, unsigned depth, async_backend backend);
+
+/**
+ * Gets the backend that a queue ended up using.
+ *
+ * Params:
+ *   const async_context* - the queue
+ *
+ * Returns:
+ *   async_backend - the backend
+ */
+async_backend async_get_backend(const async_context *ctx);
+
+/**
+ * Submits a batch of requests.
+ * Only as many requests as there are free slots in the queue are accepted.
+ *
+ * Params:
+ *   async_context* - the queue
+ *   async_request** - the requests
+ *   size_t - the number of requests
+ *
+ * Returns:
+ *   size_t - the number of requests that were accepted
+ */
+size_t async_submit(async_context *ctx, async_request **reqs, size_t n);
+
+/**
+ * Waits for requests to complete.
+ *
+ * Params:
+ *   async_context* - the queue
+ *   async_request** - receives the completed requests
+ *   size_t - the minimum number of requests to wait for
+ *   size_t - the maximum number of requests to return
+ *
+ * Returns:
+ *   size_t - the number of completed requests
+ */
+size_t async_wait(async_context *ctx, async_request **done, size_t min, size_t max);
+
+/**
+ * Waits for every request in flight and destroys a queue.
+ *
+ * Params:
+ *   async_context* - the queue
+ */
+void async_destroy(async_context *ctx);
+
+/**
+ * Gets the file descriptor of a stream opened with open_file, flushing
+ * anything the stream has buffered. Once a stream is used with async
+ * requests, it should not be read or written with stdio.
+ *
+ * Params:
+ *   FILE* - the stream
+ *
+ * Returns:
+ *   int - the descriptor, or -1 on failure
+ */
+int async_fileno(FILE *stream);
+
+#endif
@@ -0,0 +1,738 @@
+// Benchmarks for the file IO examples.
+//
+// Usage:
+//   bench.out [name] [megabytes]
+//
+// If no name is given, every benchmark is run.
+// Each benchmark generates its own input file of roughly the requested size
+// in the current directory and removes it when it's done.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "files.h"
+#include "jep.h"
+#include "text.h"
+#include "async.h"
+
+#define BENCH_DEFAULT_MB 256
+#define BENCH_BUFFER_SIZE (1 << 16)
+
+// The size of the buffer used by read_data in main.c.
+#define BIN_BUFFER_SIZE 16
+
+typedef void (*bench_fn)(size_t);
+
+typedef struct bench
+{
+    const char *name;
+    bench_fn run;
+} bench;
+
+static void report(const char *label, size_t bytes, double seconds, unsigned long long check)
+{
+    printf("  %-28s %10.1f MB/s  (%.3f s, check %llX)\n",
+           label,
+           (double)bytes / (1024.0 * 1024.0) / seconds,
+           seconds,
+           check);
+}
+
+static void report_rate(const char *label, size_t count, double seconds, unsigned long long check)
+{
+    printf("  %-28s %10.1f M/s   (%.3f s, check %llX)\n",
+           label,
+           (double)count / 1e6 / seconds,
+           seconds,
+           check);
+}
+
+//----------------------------------------------------------------------------
+// jep: fread versus the memory-mapped reader
+
+/**
+ * Writes a JEP file whose payload is 0xDEADBEEF repeated.
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static int make_jep(const char *name, size_t bytes)
+{
+    unsigned char buffer[BENCH_BUFFER_SIZE];
+
+    FILE *f = open_file(name, "wb");
+    if (f == NULL)
+        return 1;
+
+    fwrite("JEP", sizeof(unsigned char), JEP_MAGIC_SIZE, f);
+
+    for (size_t i = 0; i < BENCH_BUFFER_SIZE; i += 4)
+    {
+        buffer[i] = 0xDE;
+        buffer[i + 1] = 0xAD;
+        buffer[i + 2] = 0xBE;
+        buffer[i + 3] = 0xEF;
+    }
+
+    for (size_t written = 0; written < bytes; written += BENCH_BUFFER_SIZE)
+    {
+        if (fwrite(buffer, sizeof(unsigned char), BENCH_BUFFER_SIZE, f) != BENCH_BUFFER_SIZE)
+        {
+            fclose(f);
+            return 1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static unsigned long long sum_bytes(const unsigned char *p, size_t n)
+{
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += p[i];
+    return sum;
+}
+
+static unsigned long long fread_jep(const char *name, size_t chunk, size_t *bytes)
+{
+    unsigned char buffer[BENCH_BUFFER_SIZE];
+    unsigned long long sum = 0;
+    size_t res;
+
+    *bytes = 0;
+
+    FILE *f = open_file(name, "rb");
+    if (f == NULL)
+        return 0;
+
+    // skip the magic number
+    fread(buffer, sizeof(unsigned char), JEP_MAGIC_SIZE, f);
+
+    while ((res = fread(buffer, sizeof(unsigned char), chunk, f)) > 0)
+    {
+        sum += sum_bytes(buffer, res);
+        *bytes += res;
+    }
+
+    fclose(f);
+    return sum;
+}
+
+static unsigned long long view_jep(const char *name, int flags, size_t *bytes)
+{
+    jep_file jf;
+    const unsigned char *payload;
+    unsigned long long sum;
+
+    *bytes = 0;
+
+    if (jep_open(name, flags, &jf))
+        return 0;
+
+    payload = jep_payload(&jf, bytes);
+    sum = sum_bytes(payload, *bytes);
+
+    jep_close(&jf);
+    return sum;
+}
+
+static void bench_jep(size_t mb)
+{
+    const char *name = "bench.jep";
+    unsigned long long check;
+    size_t bytes;
+    double t;
+
+    printf("jep: reading a %zu MB JEP file\n", mb);
+
+    if (make_jep(name, mb << 20))
+    {
+        fprintf(stderr, "failed to create %s\n", name);
+        return;
+    }
+
+    // Warm the page cache so every reader sees the same conditions.
+    fread_jep(name, BENCH_BUFFER_SIZE, &bytes);
+
+    t = now_seconds();
+    check = fread_jep(name, BIN_BUFFER_SIZE, &bytes);
+    report("fread (16 byte buffer)", bytes, now_seconds() - t, check);
+
+    t = now_seconds();
+    check = fread_jep(name, BENCH_BUFFER_SIZE, &bytes);
+    report("fread (64 KiB buffer)", bytes, now_seconds() - t, check);
+
+    t = now_seconds();
+    check = view_jep(name, JEP_OPEN_STDIO, &bytes);
+    report("jep_open (stdio fallback)", bytes, now_seconds() - t, check);
+
+    t = now_seconds();
+    check = view_jep(name, JEP_OPEN_DEFAULT, &bytes);
+    report("jep_open (mapped)", bytes, now_seconds() - t, check);
+
+    remove(name);
+}
+
+//----------------------------------------------------------------------------
+// parse: fscanf versus parse_ints
+
+/**
+ * Writes newline-delimited integers of varying lengths and signs.
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static int make_ints(const char *name, size_t bytes)
+{
+    unsigned int seed = 24601;
+    size_t written = 0;
+
+    FILE *f = open_file(name, "w");
+    if (f == NULL)
+        return 1;
+
+    while (written < bytes)
+    {
+        int res;
+
+        // a small linear congruential generator keeps the input reproducible
+        seed = seed * 1103515245u + 12345u;
+        int v = (int)(seed >> 1) >> (seed % 28);
+        res = fprintf(f, "%d\n", (seed & 0x100) ? -v : v);
+        if (res < 0)
+        {
+            fclose(f);
+            return 1;
+        }
+        written += (size_t)res;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static unsigned long long sum_ints(const int_array *a)
+{
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < a->size; i++)
+        sum = sum * 31 + (unsigned int)a->data[i];
+    return sum;
+}
+
+static void fscanf_ints(FILE *f, int_array *out)
+{
+    int n;
+    while (fscanf(f, "%d", &n) == 1)
+    {
+        if (int_array_push(out, n))
+            return;
+    }
+}
+
+static void bench_parse(size_t mb)
+{
+    const char *name = "bench.txt";
+    unsigned long long expected;
+    int_array numbers;
+    size_t bytes = mb << 20;
+    double t;
+    FILE *f;
+
+    printf("parse: reading a %zu MB file of integers\n", mb);
+
+    if (make_ints(name, bytes))
+    {
+        fprintf(stderr, "failed to create %s\n", name);
+        return;
+    }
+
+    int_array_init(&numbers);
+
+    f = open_file(name, "r");
+    t = now_seconds();
+    fscanf_ints(f, &numbers);
+    report("fscanf", bytes, now_seconds() - t, numbers.size);
+    fclose(f);
+
+    expected = sum_ints(&numbers);
+
+    for (int k = TEXT_KERNEL_SCALAR; k < TEXT_KERNEL_MAX; k++)
+    {
+        char label[64];
+
+        if (text_select_kernel((text_kernel)k) != (text_kernel)k)
+        {
+            printf("  parse_ints (%s) is not supported on this CPU\n", text_kernel_names[k]);
+            continue;
+        }
+
+        numbers.size = 0;
+        f = open_file(name, "r");
+        t = now_seconds();
+        parse_ints(f, (text_kernel)k, &numbers);
+        snprintf(label, sizeof(label), "parse_ints (%s)", text_kernel_names[k]);
+        report(label, bytes, now_seconds() - t, numbers.size);
+        fclose(f);
+
+        if (sum_ints(&numbers) != expected)
+            printf("  parse_ints (%s) produced different values than fscanf\n", text_kernel_names[k]);
+    }
+
+    int_array_free(&numbers);
+    remove(name);
+}
+
+//----------------------------------------------------------------------------
+// threads: parse_file_parallel with an increasing number of threads
+
+static void bench_threads(size_t mb)
+{
+    const char *name = "bench.txt";
+    parse_stats stats[TEXT_MAX_THREADS];
+    unsigned long long expected;
+    int_array numbers;
+    size_t bytes = mb << 20;
+    int cpus = cpu_count();
+    FILE *f;
+
+    // parse_file_parallel uses at most TEXT_MAX_THREADS threads.
+    if (cpus > TEXT_MAX_THREADS)
+        cpus = TEXT_MAX_THREADS;
+
+    printf("threads: reading a %zu MB file of integers on %d processors\n", mb, cpus);
+
+    if (make_ints(name, bytes))
+    {
+        fprintf(stderr, "failed to create %s\n", name);
+        return;
+    }
+
+    int_array_init(&numbers);
+
+    f = open_file(name, "r");
+    parse_ints(f, TEXT_KERNEL_AUTO, &numbers);
+    fclose(f);
+    expected = sum_ints(&numbers);
+
+    // Double the number of threads up to the processor count, and always
+    // include the processor count itself.
+    for (int threads = 1; threads <= cpus; threads = threads * 2 > cpus && threads != cpus ? cpus : threads * 2)
+    {
+        char label[64];
+        double t;
+
+        numbers.size = 0;
+        t = now_seconds();
+        if (parse_file_parallel(name, threads, TEXT_KERNEL_AUTO, &numbers, stats))
+        {
+            fprintf(stderr, "failed to parse %s with %d thread(s)\n", name, threads);
+            break;
+        }
+        snprintf(label, sizeof(label), "%d thread(s)", threads);
+        report(label, bytes, now_seconds() - t, numbers.size);
+
+        for (int i = 0; i < threads; i++)
+        {
+            snprintf(label, sizeof(label), "  thread %d", i);
+            report(label, stats[i].bytes, stats[i].seconds, stats[i].count);
+        }
+
+        if (sum_ints(&numbers) != expected)
+            printf("  %d thread(s) produced different values than parse_ints\n", threads);
+
+        if (threads == cpus)
+            break;
+    }
+
+    int_array_free(&numbers);
+    remove(name);
+}
+
+//----------------------------------------------------------------------------
+// write: fprintf versus text_writer
+
+static int same_contents(const char *a, const char *b)
+{
+    file_view va;
+    file_view vb;
+    int same;
+
+    if (view_file(a, FILE_VIEW_DEFAULT, &va))
+        return 0;
+    if (view_file(b, FILE_VIEW_DEFAULT, &vb))
+    {
+        release_file(&va);
+        return 0;
+    }
+
+    same = va.size == vb.size && !memcmp(va.data, vb.data, va.size);
+
+    release_file(&va);
+    release_file(&vb);
+    return same;
+}
+
+static void bench_write(size_t mb)
+{
+    const char *fprintf_name = "bench_fprintf.txt";
+    const char *writer_name = "bench_writer.txt";
+    int_array numbers;
+    text_writer w;
+    size_t bytes = mb << 20;
+    double t;
+    FILE *f;
+
+    printf("write: writing a %zu MB file of integers\n", mb);
+
+    // Reuse the parse benchmark's generator to get realistic values.
+    if (make_ints(fprintf_name, bytes))
+    {
+        fprintf(stderr, "failed to create %s\n", fprintf_name);
+        return;
+    }
+
+    int_array_init(&numbers);
+    f = open_file(fprintf_name, "r");
+    parse_ints(f, TEXT_KERNEL_AUTO, &numbers);
+    fclose(f);
+
+    f = open_file(fprintf_name, "w");
+    t = now_seconds();
+    for (size_t i = 0; i < numbers.size; i++)
+        fprintf(f, "%d\n", numbers.data[i]);
+    fclose(f);
+    report("fprintf", bytes, now_seconds() - t, numbers.size);
+
+    f = open_file(writer_name, "w");
+    t = now_seconds();
+    text_writer_open(&w, f, 0);
+    text_writer_put_ints(&w, numbers.data, numbers.size);
+    text_writer_close(&w);
+    fclose(f);
+    report("text_writer", bytes, now_seconds() - t, numbers.size);
+
+    if (!same_contents(fprintf_name, writer_name))
+        printf("  text_writer produced different output than fprintf\n");
+
+    int_array_free(&numbers);
+    remove(fprintf_name);
+    remove(writer_name);
+}
+
+//----------------------------------------------------------------------------
+// records: writing, streaming and random access on a JEP container
+
+#define BENCH_RECORD_SIZE 16
+#define BENCH_RECORDS_PER_CHUNK 4096
+#define BENCH_LOOKUPS 1000000
+
+static void make_record(unsigned char *record, uint64_t id)
+{
+    for (int i = 0; i < 8; i++)
+        record[i] = (unsigned char)(id >> (8 * i));
+    record[8] = 0xDE;
+    record[9] = 0xAD;
+    record[10] = 0xBE;
+    record[11] = 0xEF;
+    for (int i = 0; i < 4; i++)
+        record[12 + i] = (unsigned char)((id * 31) >> (8 * i));
+}
+
+// Finds a record the way a reader without a mapping would, by seeking to
+// its index entry and then to the record itself.
+static int seek_record(FILE *f, const jep_reader *r, uint64_t n, unsigned char *record)
+{
+    unsigned char entry[8];
+    uint64_t offset = 0;
+    uint64_t chunk = n / r->records_per_chunk;
+
+    if (fseek(f, (long)(r->index_offset + chunk * 8), SEEK_SET) ||
+        fread(entry, sizeof(unsigned char), 8, f) != 8)
+        return 1;
+
+    for (int i = 7; i >= 0; i--)
+        offset = (offset << 8) | entry[i];
+
+    offset += JEP_CHUNK_PREFIX_SIZE + (n % r->records_per_chunk) * r->record_size;
+    if (fseek(f, (long)offset, SEEK_SET) ||
+        fread(record, sizeof(unsigned char), r->record_size, f) != r->record_size)
+        return 1;
+
+    return 0;
+}
+
+static void bench_records(size_t mb)
+{
+    const char *name = "bench_records.jep";
+    unsigned char record[BENCH_RECORD_SIZE];
+    uint64_t count = (uint64_t)(mb << 20) / BENCH_RECORD_SIZE;
+    unsigned long long check;
+    unsigned int seed;
+    unsigned char *chunk;
+    uint32_t records;
+    jep_writer w;
+    jep_reader r;
+    jep_stream s;
+    double t;
+    FILE *f;
+
+    printf("records: %llu records of %d bytes\n", (unsigned long long)count, BENCH_RECORD_SIZE);
+    if (count == 0)
+        return;
+
+    t = now_seconds();
+    if (jep_writer_open(&w, name, BENCH_RECORD_SIZE, BENCH_RECORDS_PER_CHUNK))
+    {
+        fprintf(stderr, "failed to create %s\n", name);
+        return;
+    }
+    for (uint64_t i = 0; i < count; i++)
+    {
+        make_record(record, i);
+        jep_writer_append(&w, record);
+    }
+    if (jep_writer_close(&w))
+    {
+        fprintf(stderr, "failed to write %s\n", name);
+        return;
+    }
+    report("jep_writer", (size_t)(count * BENCH_RECORD_SIZE), now_seconds() - t, count);
+
+    chunk = malloc((size_t)BENCH_RECORD_SIZE * BENCH_RECORDS_PER_CHUNK);
+    f = open_file(name, "rb");
+    check = 0;
+    t = now_seconds();
+    if (chunk != NULL && f != NULL && !jep_stream_open(&s, f))
+    {
+        while (!jep_stream_next(&s, chunk, &records))
+            check += sum_bytes(chunk, (size_t)records * BENCH_RECORD_SIZE);
+    }
+    report("jep_stream_next", (size_t)(count * BENCH_RECORD_SIZE), now_seconds() - t, check);
+    free(chunk);
+
+    if (jep_reader_open(&r, name))
+    {
+        fprintf(stderr, "failed to open %s\n", name);
+        if (f != NULL)
+            fclose(f);
+        remove(name);
+        return;
+    }
+
+    // Both lookups visit the same pseudo-random sequence of records.
+    seed = 2319;
+    check = 0;
+    t = now_seconds();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        if (f != NULL && !seek_record(f, &r, seed % count, record))
+            check += record[0];
+    }
+    report_rate("fseek + fread lookups", BENCH_LOOKUPS, now_seconds() - t, check);
+
+    seed = 2319;
+    check = 0;
+    t = now_seconds();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        check += jep_reader_record(&r, seed % count)[0];
+    }
+    report_rate("jep_reader_record lookups", BENCH_LOOKUPS, now_seconds() - t, check);
+
+    jep_reader_close(&r);
+    if (f != NULL)
+        fclose(f);
+    remove(name);
+}
+
+//----------------------------------------------------------------------------
+// async: queue depth scaling and overlapped parsing
+
+#define BENCH_ASYNC_BLOCK_SIZE (1 << 16)
+
+// Reads a whole file in blocks, keeping up to depth reads in flight.
+static unsigned long long read_async(async_context *ctx, int fd, size_t bytes, unsigned depth, unsigned char *buffers)
+{
+    async_request reqs[ASYNC_MAX_DEPTH];
+    async_request *batch[ASYNC_MAX_DEPTH];
+    async_request *done[ASYNC_MAX_DEPTH];
+    unsigned long long sum = 0;
+    size_t blocks = bytes / BENCH_ASYNC_BLOCK_SIZE;
+    size_t next = 0;
+    size_t finished = 0;
+    size_t free_count = depth;
+
+    for (unsigned i = 0; i < depth; i++)
+    {
+        reqs[i].fd = fd;
+        reqs[i].op = ASYNC_READ;
+        reqs[i].buffer = buffers + (size_t)i * BENCH_ASYNC_BLOCK_SIZE;
+        reqs[i].len = BENCH_ASYNC_BLOCK_SIZE;
+        batch[i] = &reqs[i];
+    }
+
+    while (finished < blocks)
+    {
+        size_t n = 0;
+
+        // Fill every free slot with the next blocks and submit them together.
+        while (n < free_count && next < blocks)
+        {
+            batch[n]->offset = (uint64_t)next * BENCH_ASYNC_BLOCK_SIZE;
+            n++;
+            next++;
+        }
+        async_submit(ctx, batch, n);
+        free_count -= n;
+
+        n = async_wait(ctx, done, 1, depth);
+        for (size_t i = 0; i < n; i++)
+        {
+            if (done[i]->result > 0)
+                sum += ((unsigned char *)done[i]->buffer)[0];
+            batch[free_count++] = done[i];
+        }
+        finished += n;
+    }
+
+    return sum;
+}
+
+static void bench_async(size_t mb)
+{
+    const char *name = "bench.txt";
+    size_t bytes = mb << 20;
+    unsigned char *buffers;
+    int_array numbers;
+    FILE *f;
+
+    printf("async: reading a %zu MB file\n", mb);
+
+    if (make_ints(name, bytes))
+    {
+        fprintf(stderr, "failed to create %s\n", name);
+        return;
+    }
+
+    buffers = malloc((size_t)ASYNC_MAX_DEPTH * BENCH_ASYNC_BLOCK_SIZE);
+    f = open_file(name, "rb");
+    if (buffers == NULL || f == NULL)
+    {
+        free(buffers);
+        remove(name);
+        return;
+    }
+
+    for (int b = ASYNC_BACKEND_URING; b < ASYNC_BACKEND_MAX; b++)
+    {
+        for (unsigned depth = 1; depth <= 64; depth *= 2)
+        {
+            async_context *ctx;
+            unsigned long long check;
+            char label[64];
+            double t;
+
+            if (async_init(&ctx, depth, (async_backend)b))
+            {
+                printf("  %s is not available\n", async_backend_names[b]);
+                break;
+            }
+
+            t = now_seconds();
+            check = read_async(ctx, async_fileno(f), bytes, depth, buffers);
+            snprintf(label, sizeof(label), "%s, depth %u", async_backend_names[b], depth);
+            report(label, bytes / BENCH_ASYNC_BLOCK_SIZE * BENCH_ASYNC_BLOCK_SIZE, now_seconds() - t, check);
+
+            async_destroy(ctx);
+
+            // Requests complete as they are submitted, so depth makes no
+            // difference.
+            if (b == ASYNC_BACKEND_SYNC)
+                break;
+        }
+    }
+
+    fclose(f);
+    free(buffers);
+
+    // parse_ints blocks on each fread, parse_ints_async reads the next block
+    // while the current one is parsed.
+    int_array_init(&numbers);
+
+    f = open_file(name, "r");
+    if (f != NULL)
+    {
+        double t = now_seconds();
+        parse_ints(f, TEXT_KERNEL_AUTO, &numbers);
+        report("parse_ints", bytes, now_seconds() - t, numbers.size);
+        fclose(f);
+    }
+
+    for (int b = ASYNC_BACKEND_URING; b < ASYNC_BACKEND_MAX; b++)
+    {
+        async_context *ctx;
+        char label[64];
+
+        f = open_file(name, "rb");
+        if (f == NULL)
+            break;
+
+        if (!async_init(&ctx, 2, (async_backend)b))
+        {
+            double t = now_seconds();
+            numbers.size = 0;
+            parse_ints_async(ctx, async_fileno(f), TEXT_KERNEL_AUTO, &numbers);
+            snprintf(label, sizeof(label), "parse_ints_async (%s)", async_backend_names[b]);
+            report(label, bytes, now_seconds() - t, numbers.size);
+            async_destroy(ctx);
+        }
+
+        fclose(f);
+    }
+
+    int_array_free(&numbers);
+    remove(name);
+}
+
+//----------------------------------------------------------------------------
+
+static const bench benches[] = {
+    {"jep", bench_jep},
+    {"parse", bench_parse},
+    {"threads", bench_threads},
+    {"write", bench_write},
+    {"records", bench_records},
+    {"async", bench_async},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t mb = BENCH_DEFAULT_MB;
+    int found = 0;
+
+    if (argc > 2)
+        mb = strtoul(argv[2], NULL, 10);
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (name == NULL || !strcmp(name, benches[i].name))
+        {
+            benches[i].run(mb);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "files.h"
+
+#include <stdlib.h>
+
+// Memory mapping is done with the POSIX mmap function.
+// Everywhere else, the file is read into memory with fread.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#define FILES_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// The number of bytes requested by each fread call in the stdio fallback.
+#define FILES_READ_CHUNK_SIZE (1 << 20)
+
+FILE *open_file(const char *name, const char *mode)
+{
+    FILE *f;
+
+#if (defined(__STDC_LIB_EXT1__) && __STDC_WANT_LIB_EXT1__ == 1) || \
+    (defined(_WIN32) && !defined(_CRT_SECURE_NO_WARNINGS))
+    if (fopen_s(&f, name, mode))
+    {
+        return NULL;
+    }
+#else
+    f = fopen(name, mode);
+    if (f == NULL)
+    {
+        return NULL;
+    }
+#endif
+
+    return f;
+}
+
+#ifdef FILES_HAVE_MMAP
+/**
+ * Maps an entire file into memory.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   file_view* - the view to initialize
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static int map_file(const char *name, file_view *view)
+{
+    struct stat st;
+    void *p;
+
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    // Empty files and things like pipes cannot be mapped.
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd);
+        return 1;
+    }
+
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file, so the descriptor is
+    // no longer needed.
+    close(fd);
+
+    if (p == MAP_FAILED)
+        return 1;
+
+    // Large files are usually scanned from front to back, so ask the kernel
+    // to read ahead aggressively.
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    view->data = p;
+    view->size = (size_t)st.st_size;
+    view->mapped = 1;
+
+    return 0;
+}
+#endif
+
+/**
+ * Reads an entire file into a heap buffer.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   file_view* - the view to initialize
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static int read_file(const char *name, file_view *view)
+{
+    unsigned char *buffer = NULL;
+    size_t cap = 0;
+    size_t size = 0;
+    size_t res;
+
+    FILE *f = open_file(name, "rb");
+    if (f == NULL)
+        return 1;
+
+    do
+    {
+        if (cap - size < FILES_READ_CHUNK_SIZE)
+        {
+            size_t new_cap = cap ? cap * 2 : FILES_READ_CHUNK_SIZE;
+            unsigned char *b = realloc(buffer, new_cap);
+            if (b == NULL)
+            {
+                free(buffer);
+                fclose(f);
+                return 1;
+            }
+            buffer = b;
+            cap = new_cap;
+        }
+
+        res = fread(buffer + size, sizeof(unsigned char), FILES_READ_CHUNK_SIZE, f);
+        size += res;
+    } while (res == FILES_READ_CHUNK_SIZE);
+
+    if (ferror(f))
+    {
+        free(buffer);
+        fclose(f);
+        return 1;
+    }
+
+    fclose(f);
+
+    view->data = buffer;
+    view->size = size;
+    view->mapped = 0;
+
+    return 0;
+}
+
+int view_file(const char *name, int flags, file_view *view)
+{
+    view->data = NULL;
+    view->size = 0;
+    view->mapped = 0;
+
+#ifdef FILES_HAVE_MMAP
+    if (!(flags & FILE_VIEW_STDIO) && !map_file(name, view))
+        return 0;
+#endif
+
+    return read_file(name, view);
+}
+
+void release_file(file_view *view)
+{
+    if (view->data == NULL)
+        return;
+
+#ifdef FILES_HAVE_MMAP
+    if (view->mapped)
+        munmap((void *)view->data, view->size);
+    else
+        free((void *)view->data);
+#else
+    free((void *)view->data);
+#endif
+
+    view->data = NULL;
+    view->size = 0;
+    view->mapped = 0;
+}
+
+int cpu_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+double now_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
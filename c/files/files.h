@@ -0,0 +1,70 @@
+#ifndef FILES_H
+#define FILES_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Flags for view_file.
+#define FILE_VIEW_DEFAULT 0x00 // map the file if possible, otherwise use stdio
+#define FILE_VIEW_STDIO   0x01 // always read the file with fread
+
+// A read-only view of the entire contents of a file.
+// The contents are either memory-mapped or read into a heap buffer, so
+// pointers into the view remain valid until release_file is called.
+typedef struct file_view
+{
+    const unsigned char *data; // the entire contents of the file
+    size_t size;               // the size of the file in bytes
+    int mapped;                // 1 if data points to a memory mapping
+} file_view;
+
+/**
+ * Opens a file using fopen_s where it's available, or fopen otherwise.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   const char* - the mode string, such as "rb" or "w"
+ *
+ * Returns:
+ *   FILE* - the opened stream, or NULL on failure
+ */
+FILE *open_file(const char *name, const char *mode);
+
+/**
+ * Maps a file into memory, or reads it with stdio if it can't be mapped.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   int - FILE_VIEW_DEFAULT or FILE_VIEW_STDIO
+ *   file_view* - the view to initialize
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int view_file(const char *name, int flags, file_view *view);
+
+/**
+ * Releases the mapping or buffer held by a view.
+ *
+ * Params:
+ *   file_view* - the view to release
+ */
+void release_file(file_view *view);
+
+/**
+ * Gets the number of processors available to this process.
+ *
+ * Returns:
+ *   int - the number of processors, which is at least 1
+ */
+int cpu_count();
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+double now_seconds();
+
+#endif
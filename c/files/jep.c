@@ -0,0 +1,348 @@
+#include "jep.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char jep_magic[JEP_MAGIC_SIZE] = {'J', 'E', 'P'};
+
+int jep_open(const char *name, int flags, jep_file *jf)
+{
+    if (view_file(name, flags, jf))
+        return 1;
+
+    // The magic number is validated once here so that callers can trust the
+    // rest of the view without checking it again.
+    if (jf->size < JEP_MAGIC_SIZE || memcmp(jf->data, jep_magic, JEP_MAGIC_SIZE))
+    {
+        jep_close(jf);
+        return 1;
+    }
+
+    return 0;
+}
+
+const unsigned char *jep_payload(const jep_file *jf, size_t *size)
+{
+    *size = jf->size - JEP_MAGIC_SIZE;
+    return jf->data + JEP_MAGIC_SIZE;
+}
+
+const unsigned char *jep_at(const jep_file *jf, size_t offset, size_t len)
+{
+    size_t payload_size = jf->size - JEP_MAGIC_SIZE;
+
+    if (offset > payload_size || len > payload_size - offset)
+        return NULL;
+
+    return jf->data + JEP_MAGIC_SIZE + offset;
+}
+
+void jep_close(jep_file *jf)
+{
+    release_file(jf);
+}
+
+//----------------------------------------------------------------------------
+// version 1 containers
+
+static const unsigned char jep_index_magic[4] = {'J', 'E', 'P', 'I'};
+
+// The fields are encoded one byte at a time so that the format doesn't
+// depend on the byte order of the machine.
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static void jep_writer_put(jep_writer *w, const void *p, size_t n)
+{
+    if (w->error)
+        return;
+
+    if (fwrite(p, sizeof(unsigned char), n, w->stream) != n)
+        w->error = 1;
+
+    w->position += n;
+}
+
+static void jep_writer_flush_chunk(jep_writer *w)
+{
+    unsigned char prefix[JEP_CHUNK_PREFIX_SIZE];
+
+    if (w->chunk_records == 0)
+        return;
+
+    if (w->chunk_count == w->offsets_cap)
+    {
+        uint32_t cap = w->offsets_cap ? w->offsets_cap * 2 : 64;
+        uint64_t *offsets = realloc(w->offsets, cap * sizeof(uint64_t));
+        if (offsets == NULL)
+        {
+            // The chunk is dropped, since the file can't be completed anyway.
+            w->error = 1;
+            w->chunk_records = 0;
+            return;
+        }
+        w->offsets = offsets;
+        w->offsets_cap = cap;
+    }
+
+    w->offsets[w->chunk_count++] = w->position;
+
+    put_u32(prefix, w->chunk_records * w->record_size);
+    jep_writer_put(w, prefix, JEP_CHUNK_PREFIX_SIZE);
+    jep_writer_put(w, w->chunk, (size_t)w->chunk_records * w->record_size);
+
+    w->chunk_records = 0;
+}
+
+int jep_writer_open(jep_writer *w, const char *name, uint32_t record_size, uint32_t records_per_chunk)
+{
+    unsigned char header[JEP_HEADER_SIZE];
+
+    // The length prefix of a full chunk has to fit in 32 bits.
+    if (record_size == 0 || records_per_chunk == 0 ||
+        (uint64_t)record_size * records_per_chunk > UINT32_MAX)
+        return 1;
+
+    w->stream = open_file(name, "wb");
+    if (w->stream == NULL)
+        return 1;
+
+    w->chunk = malloc((size_t)record_size * records_per_chunk);
+    if (w->chunk == NULL)
+    {
+        fclose(w->stream);
+        return 1;
+    }
+
+    w->record_size = record_size;
+    w->records_per_chunk = records_per_chunk;
+    w->chunk_records = 0;
+    w->offsets = NULL;
+    w->chunk_count = 0;
+    w->offsets_cap = 0;
+    w->record_count = 0;
+    w->position = 0;
+    w->error = 0;
+
+    memcpy(header, jep_magic, JEP_MAGIC_SIZE);
+    header[3] = JEP_VERSION;
+    put_u32(header + 4, record_size);
+    put_u32(header + 8, records_per_chunk);
+    put_u32(header + 12, 0);
+    jep_writer_put(w, header, JEP_HEADER_SIZE);
+
+    if (w->error)
+    {
+        fclose(w->stream);
+        free(w->chunk);
+        w->stream = NULL;
+        w->chunk = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+int jep_writer_append(jep_writer *w, const void *record)
+{
+    if (w->error)
+        return 1;
+
+    memcpy(w->chunk + (size_t)w->chunk_records * w->record_size, record, w->record_size);
+    w->chunk_records++;
+    w->record_count++;
+
+    if (w->chunk_records == w->records_per_chunk)
+        jep_writer_flush_chunk(w);
+
+    return w->error;
+}
+
+int jep_writer_close(jep_writer *w)
+{
+    unsigned char buffer[JEP_TRAILER_SIZE];
+    uint64_t index_offset;
+    int res;
+
+    jep_writer_flush_chunk(w);
+
+    // end of the chunks
+    put_u32(buffer, 0);
+    jep_writer_put(w, buffer, JEP_CHUNK_PREFIX_SIZE);
+
+    index_offset = w->position;
+    for (uint32_t i = 0; i < w->chunk_count; i++)
+    {
+        put_u64(buffer, w->offsets[i]);
+        jep_writer_put(w, buffer, 8);
+    }
+
+    put_u64(buffer, index_offset);
+    put_u64(buffer + 8, w->record_count);
+    put_u32(buffer + 16, w->chunk_count);
+    memcpy(buffer + 20, jep_index_magic, 4);
+    jep_writer_put(w, buffer, JEP_TRAILER_SIZE);
+
+    res = w->error;
+    if (fclose(w->stream))
+        res = 1;
+
+    free(w->chunk);
+    free(w->offsets);
+    w->chunk = NULL;
+    w->offsets = NULL;
+
+    return res;
+}
+
+int jep_reader_open(jep_reader *r, const char *name)
+{
+    const unsigned char *data;
+    const unsigned char *trailer;
+    uint64_t expected_chunks;
+    size_t size;
+
+    if (view_file(name, FILE_VIEW_DEFAULT, &r->view))
+        return 1;
+
+    data = r->view.data;
+    size = r->view.size;
+
+    if (size < JEP_HEADER_SIZE + JEP_CHUNK_PREFIX_SIZE + JEP_TRAILER_SIZE ||
+        memcmp(data, jep_magic, JEP_MAGIC_SIZE) || data[3] != JEP_VERSION)
+    {
+        jep_reader_close(r);
+        return 1;
+    }
+
+    trailer = data + size - JEP_TRAILER_SIZE;
+
+    r->record_size = get_u32(data + 4);
+    r->records_per_chunk = get_u32(data + 8);
+    r->index_offset = get_u64(trailer);
+    r->record_count = get_u64(trailer + 8);
+    r->chunk_count = get_u32(trailer + 16);
+
+    // Everything that jep_reader_record relies on is checked once here. The
+    // number of chunks is rounded up without adding first, so a record count
+    // near UINT64_MAX can't wrap around to 0 chunks.
+    expected_chunks = r->records_per_chunk
+                          ? r->record_count / r->records_per_chunk + (r->record_count % r->records_per_chunk != 0)
+                          : 0;
+
+    if (memcmp(trailer + 20, jep_index_magic, 4) ||
+        r->record_size == 0 || r->records_per_chunk == 0 ||
+        (uint64_t)r->record_size * r->records_per_chunk > UINT32_MAX ||
+        expected_chunks != r->chunk_count ||
+        r->record_count > (uint64_t)r->chunk_count * r->records_per_chunk ||
+        r->index_offset < JEP_HEADER_SIZE + JEP_CHUNK_PREFIX_SIZE ||
+        r->index_offset > size - JEP_TRAILER_SIZE ||
+        size - JEP_TRAILER_SIZE - r->index_offset != (uint64_t)r->chunk_count * 8)
+    {
+        jep_reader_close(r);
+        return 1;
+    }
+
+    // Only the index is checked, so that opening a large file doesn't touch
+    // the page of every chunk.
+    for (uint32_t i = 0; i < r->chunk_count; i++)
+    {
+        uint64_t offset = get_u64(data + r->index_offset + (uint64_t)i * 8);
+        uint64_t records = i + 1 < r->chunk_count
+                               ? r->records_per_chunk
+                               : r->record_count - (uint64_t)i * r->records_per_chunk;
+        uint64_t length = records * r->record_size;
+
+        if (offset < JEP_HEADER_SIZE ||
+            offset > r->index_offset ||
+            r->index_offset - offset < JEP_CHUNK_PREFIX_SIZE + length)
+        {
+            jep_reader_close(r);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+const unsigned char *jep_reader_record(const jep_reader *r, uint64_t n)
+{
+    uint64_t chunk;
+    uint64_t offset;
+
+    if (n >= r->record_count)
+        return NULL;
+
+    chunk = n / r->records_per_chunk;
+    offset = get_u64(r->view.data + r->index_offset + chunk * 8);
+
+    return r->view.data + offset + JEP_CHUNK_PREFIX_SIZE +
+           (n % r->records_per_chunk) * r->record_size;
+}
+
+void jep_reader_close(jep_reader *r)
+{
+    release_file(&r->view);
+}
+
+int jep_stream_open(jep_stream *s, FILE *stream)
+{
+    unsigned char header[JEP_HEADER_SIZE];
+
+    if (fread(header, sizeof(unsigned char), JEP_HEADER_SIZE, stream) != JEP_HEADER_SIZE ||
+        memcmp(header, jep_magic, JEP_MAGIC_SIZE) || header[3] != JEP_VERSION)
+        return 1;
+
+    s->stream = stream;
+    s->record_size = get_u32(header + 4);
+    s->records_per_chunk = get_u32(header + 8);
+
+    return s->record_size == 0 || s->records_per_chunk == 0;
+}
+
+int jep_stream_next(jep_stream *s, unsigned char *buffer, uint32_t *records)
+{
+    unsigned char prefix[JEP_CHUNK_PREFIX_SIZE];
+    uint32_t length;
+
+    *records = 0;
+
+    if (fread(prefix, sizeof(unsigned char), JEP_CHUNK_PREFIX_SIZE, s->stream) != JEP_CHUNK_PREFIX_SIZE)
+        return 1;
+
+    length = get_u32(prefix);
+    if (length == 0 || length % s->record_size ||
+        length / s->record_size > s->records_per_chunk)
+        return 1;
+
+    if (fread(buffer, sizeof(unsigned char), length, s->stream) != length)
+        return 1;
+
+    *records = length / s->record_size;
+    return 0;
+}
@@ -0,0 +1,226 @@
+#ifndef JEP_H
+#define JEP_H
+
+#include "files.h"
+
+#include <stdint.h>
+
+// Every JEP file starts with the bytes 'J', 'E', 'P'.
+#define JEP_MAGIC_SIZE 3
+
+// Version 1 of the format is a container of fixed-size records:
+//
+//   header   'J' 'E' 'P' version(1) record_size(u32) records_per_chunk(u32) 0(u32)
+//   chunks   length(u32) followed by length bytes of records
+//   end      a length of 0 (u32)
+//   index    the file offset of each chunk (u64)
+//   trailer  index_offset(u64) record_count(u64) chunk_count(u32) 'J' 'E' 'P' 'I'
+//
+// Every number is little-endian. Every chunk except the last one holds
+// exactly records_per_chunk records, which is what lets a reader find the
+// chunk holding any record with one division. The zero length after the
+// last chunk lets a stream be read without seeking to the trailer.
+//
+// Files written before the container existed have the magic number followed
+// directly by their payload. The first payload byte of those files was never
+// 1, so they can still be read with jep_open.
+#define JEP_VERSION 1
+#define JEP_HEADER_SIZE 16
+#define JEP_CHUNK_PREFIX_SIZE 4
+#define JEP_TRAILER_SIZE 24
+
+// Flags for jep_open.
+#define JEP_OPEN_DEFAULT FILE_VIEW_DEFAULT
+#define JEP_OPEN_STDIO   FILE_VIEW_STDIO
+
+// A read-only view of a JEP file.
+// The pointers handed out by jep_payload and jep_at remain valid until
+// jep_close is called.
+typedef file_view jep_file;
+
+/**
+ * Opens a JEP file and validates its magic number.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   int - JEP_OPEN_DEFAULT or JEP_OPEN_STDIO
+ *   jep_file* - the view to initialize
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int jep_open(const char *name, int flags, jep_file *jf);
+
+/**
+ * Gets the bytes that follow the magic number.
+ *
+ * Params:
+ *   const jep_file* - an open JEP file
+ *   size_t* - receives the number of payload bytes
+ *
+ * Returns:
+ *   const unsigned char* - a pointer to the first payload byte
+ */
+const unsigned char *jep_payload(const jep_file *jf, size_t *size);
+
+/**
+ * Gets a pointer to a range of payload bytes without copying them.
+ *
+ * Params:
+ *   const jep_file* - an open JEP file
+ *   size_t - the offset of the range, relative to the start of the payload
+ *   size_t - the length of the range
+ *
+ * Returns:
+ *   const unsigned char* - a pointer into the file, or NULL if the range is
+ *                          out of bounds
+ */
+const unsigned char *jep_at(const jep_file *jf, size_t offset, size_t len);
+
+/**
+ * Releases the mapping or buffer held by a JEP file.
+ *
+ * Params:
+ *   jep_file* - the file to close
+ */
+void jep_close(jep_file *jf);
+
+//----------------------------------------------------------------------------
+// version 1 containers
+
+// Writes records to a container one at a time.
+// Records are collected into a chunk in memory, and each full chunk is
+// written with its length prefix as soon as it fills up.
+typedef struct jep_writer
+{
+    FILE *stream;
+    uint32_t record_size;
+    uint32_t records_per_chunk;
+    unsigned char *chunk;      // records waiting to be written
+    uint32_t chunk_records;    // the number of records in chunk
+    uint64_t *offsets;         // the offset of each chunk written so far
+    uint32_t chunk_count;
+    uint32_t offsets_cap;
+    uint64_t record_count;
+    uint64_t position;         // the number of bytes written to the stream
+    int error;
+} jep_writer;
+
+// Random access to the records of a mapped container.
+typedef struct jep_reader
+{
+    file_view view;
+    uint32_t record_size;
+    uint32_t records_per_chunk;
+    uint32_t chunk_count;
+    uint64_t record_count;
+    uint64_t index_offset;
+} jep_reader;
+
+// Reads the chunks of a container in order without loading the whole file.
+typedef struct jep_stream
+{
+    FILE *stream;
+    uint32_t record_size;
+    uint32_t records_per_chunk;
+} jep_stream;
+
+/**
+ * Creates a container and writes its header.
+ *
+ * Params:
+ *   jep_writer* - the writer to initialize
+ *   const char* - the name of the file
+ *   uint32_t - the size of every record in bytes
+ *   uint32_t - the number of records in each chunk
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int jep_writer_open(jep_writer *w, const char *name, uint32_t record_size, uint32_t records_per_chunk);
+
+/**
+ * Appends a record to a container. Once a write has failed, nothing more
+ * is appended.
+ *
+ * Params:
+ *   jep_writer* - the writer
+ *   const void* - record_size bytes to append
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int jep_writer_append(jep_writer *w, const void *record);
+
+/**
+ * Writes the last chunk, the index and the trailer, then closes the file.
+ *
+ * Params:
+ *   jep_writer* - the writer
+ *
+ * Returns:
+ *   int - 0 on success, 1 if anything failed to be written
+ */
+int jep_writer_close(jep_writer *w);
+
+/**
+ * Opens a container for random access and validates its header, trailer
+ * and index.
+ *
+ * Params:
+ *   jep_reader* - the reader to initialize
+ *   const char* - the name of the file
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int jep_reader_open(jep_reader *r, const char *name);
+
+/**
+ * Gets a record by its position in the container in constant time.
+ *
+ * Params:
+ *   const jep_reader* - the reader
+ *   uint64_t - the index of the record
+ *
+ * Returns:
+ *   const unsigned char* - a pointer to record_size bytes inside the
+ *                          mapping, or NULL if there is no such record
+ */
+const unsigned char *jep_reader_record(const jep_reader *r, uint64_t n);
+
+/**
+ * Closes a container opened with jep_reader_open.
+ *
+ * Params:
+ *   jep_reader* - the reader
+ */
+void jep_reader_close(jep_reader *r);
+
+/**
+ * Reads the header of a container from a stream.
+ *
+ * Params:
+ *   jep_stream* - the stream reader to initialize
+ *   FILE* - a stream opened in binary mode at the start of the container
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int jep_stream_open(jep_stream *s, FILE *stream);
+
+/**
+ * Reads the next chunk from a stream.
+ * The buffer must hold at least record_size * records_per_chunk bytes.
+ *
+ * Params:
+ *   jep_stream* - the stream reader
+ *   unsigned char* - the buffer that receives the records of the chunk
+ *   uint32_t* - receives the number of records in the chunk
+ *
+ * Returns:
+ *   int - 0 if a chunk was read, 1 at the end of the chunks or on failure
+ */
+int jep_stream_next(jep_stream *s, unsigned char *buffer, uint32_t *records);
+
+#endif
@@ -1,2 +1,7 @@
+SRC = files.c jep.c text.c async.c
+
 all:
-	gcc -Wall -Werror main.c -o files.out
+	gcc -Wall -Werror -pthread main.c $(SRC) -o files.out
+
+bench:
+	gcc -Wall -Werror -pthread -O2 bench.c $(SRC) -o bench.out
@@ -1,2 +1,7 @@
+SRC = files.c jep.c text.c async.c
+
 all:
-	clang -Wall -Werror main.c -o files.out
+	clang -Wall -Werror -pthread main.c $(SRC) -o files.out
+
+bench:
+	clang -Wall -Werror -pthread -O2 bench.c $(SRC) -o bench.out
@@ -1,30 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 
+#include "files.h"
+#include "jep.h"
+#include "text.h"
+#include "async.h"
+
 #define BIN_BUFFER_SIZE 16
 #define TXT_BUFFER_SIZE 10
 
-FILE *open_file(const char *name, const char *mode)
-{
-    FILE *f;
-
-#if (defined(__STDC_LIB_EXT1__) && __STDC_WANT_LIB_EXT1__ == 1) || \
-    (defined(_WIN32) && !defined(_CRT_SECURE_NO_WARNINGS))
-    if (fopen_s(&f, name, mode))
-    {
-        return NULL;
-    }
-#else
-    f = fopen(name, mode);
-    if (f == NULL)
-    {
-        return NULL;
-    }
-#endif
-
-    return f;
-}
-
 void write_data(FILE *stream)
 {
     unsigned char buffer[BIN_BUFFER_SIZE];
@@ -66,6 +51,112 @@ void read_data(FILE *stream)
     printf("\n");
 }
 
+void read_data_mapped(const char *name)
+{
+    jep_file jf;
+    const unsigned char *payload;
+    size_t size;
+
+    // Unlike read_data, no bytes are copied here. The payload pointer refers
+    // directly to the mapped file (or to the stdio fallback buffer).
+    if (jep_open(name, JEP_OPEN_DEFAULT, &jf))
+    {
+        printf("%s is not a valid JEP file\n", name);
+        return;
+    }
+
+    payload = jep_payload(&jf, &size);
+
+    printf("mapped: %d, payload size: %zu\n", jf.mapped, size);
+    for (size_t i = 0; i < size; i++)
+    {
+        printf("%X ", payload[i]);
+    }
+    printf("\n");
+
+    jep_close(&jf);
+}
+
+void write_records(const char *name, unsigned int count)
+{
+    jep_writer w;
+    unsigned char record[8];
+
+    // Each record is its index followed by 0xDEADBEEF.
+    if (jep_writer_open(&w, name, sizeof(record), 256))
+    {
+        printf("failed to create %s\n", name);
+        return;
+    }
+
+    record[4] = 0xDE;
+    record[5] = 0xAD;
+    record[6] = 0xBE;
+    record[7] = 0xEF;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        record[0] = (unsigned char)i;
+        record[1] = (unsigned char)(i >> 8);
+        record[2] = (unsigned char)(i >> 16);
+        record[3] = (unsigned char)(i >> 24);
+        jep_writer_append(&w, record);
+    }
+
+    if (jep_writer_close(&w))
+    {
+        printf("an error occurred while writing %s\n", name);
+    }
+}
+
+void read_records(const char *name)
+{
+    jep_reader r;
+    jep_stream s;
+    unsigned char *chunk;
+    uint32_t records;
+    const unsigned char *record;
+    FILE *f;
+
+    // Random access goes straight to the chunk that holds a record by
+    // looking up its offset in the index at the end of the file.
+    if (jep_reader_open(&r, name))
+    {
+        printf("%s is not a valid JEP container\n", name);
+        return;
+    }
+
+    printf("%s has %llu records in %u chunks\n", name, (unsigned long long)r.record_count, r.chunk_count);
+
+    record = jep_reader_record(&r, r.record_count / 2);
+    if (record != NULL)
+    {
+        printf("record %llu: ", (unsigned long long)r.record_count / 2);
+        for (uint32_t i = 0; i < r.record_size; i++)
+        {
+            printf("%X ", record[i]);
+        }
+        printf("\n");
+    }
+
+    // Streaming reads one chunk at a time, so only one chunk needs to be
+    // in memory.
+    chunk = malloc((size_t)r.record_size * r.records_per_chunk);
+    f = open_file(name, "rb");
+    if (chunk != NULL && f != NULL && !jep_stream_open(&s, f))
+    {
+        for (int i = 0; !jep_stream_next(&s, chunk, &records); i++)
+        {
+            printf("chunk %d: %u records\n", i, records);
+        }
+    }
+
+    if (f != NULL)
+        fclose(f);
+    free(chunk);
+    jep_reader_close(&r);
+}
+
 void write_text(FILE *stream)
 {
     int numbers[TXT_BUFFER_SIZE] = {
@@ -86,6 +177,38 @@ void write_text(FILE *stream)
     }
 }
 
+void write_text_batched(FILE *stream)
+{
+    int numbers[TXT_BUFFER_SIZE] = {
+        24601,
+        1776,
+        2319,
+        42,
+        69,
+        420,
+        8080,
+        8443,
+        0xBEEF,
+        1000000};
+
+    text_writer w;
+
+    // The values are formatted into one buffer without going through
+    // fprintf, and the whole buffer is written with a single call.
+    if (text_writer_open(&w, stream, 0))
+    {
+        printf("failed to create a text writer\n");
+        return;
+    }
+
+    text_writer_put_ints(&w, numbers, TXT_BUFFER_SIZE);
+
+    if (text_writer_close(&w))
+    {
+        printf("an error occurred while writing the output file\n");
+    }
+}
+
 void read_text(FILE *stream)
 {
     int numbers[TXT_BUFFER_SIZE];
@@ -148,6 +271,104 @@ void read_text(FILE *stream)
     }
 }
 
+void read_text_bulk(FILE *stream)
+{
+    int_array numbers;
+
+    // Instead of calling fscanf once per value, parse_ints reads the file in
+    // large blocks and converts the digits with SIMD instructions when the
+    // CPU supports them. The array grows as needed, so there's no limit on
+    // how many values the file can have.
+    int_array_init(&numbers);
+
+    // The state of the stream is reported the same way as in read_text. The
+    // whole stream may have been read even if parsing stopped at bad input,
+    // so the end is only reported when parse_ints says it got there.
+    if (!parse_ints(stream, TEXT_KERNEL_AUTO, &numbers))
+    {
+        printf("reached end of input file\n");
+    }
+    if (ferror(stream))
+    {
+        printf("an error occurred while reading the input file\n");
+    }
+
+    printf("data from file (%s kernel):\n", text_kernel_names[text_select_kernel(TEXT_KERNEL_AUTO)]);
+    for (size_t i = 0; i < numbers.size; i++)
+    {
+        printf("txt[%zu] %d\n", i, numbers.data[i]);
+    }
+
+    int_array_free(&numbers);
+}
+
+void read_text_async(FILE *stream)
+{
+    async_context *ctx;
+    int_array numbers;
+
+    // The async queue uses io_uring when the kernel supports it and a pool
+    // of threads when it doesn't. Either way, the next block of the file is
+    // read while the current one is parsed.
+    if (async_init(&ctx, 2, ASYNC_BACKEND_AUTO))
+    {
+        printf("failed to create an async queue\n");
+        return;
+    }
+
+    int_array_init(&numbers);
+    if (parse_ints_async(ctx, async_fileno(stream), TEXT_KERNEL_AUTO, &numbers))
+    {
+        printf("an error occurred while reading the input file\n");
+    }
+
+    printf("data from file (%s backend):\n", async_backend_names[async_get_backend(ctx)]);
+    for (size_t i = 0; i < numbers.size; i++)
+    {
+        printf("txt[%zu] %d\n", i, numbers.data[i]);
+    }
+
+    int_array_free(&numbers);
+    async_destroy(ctx);
+}
+
+void read_text_parallel(const char *name)
+{
+    parse_stats stats[TEXT_MAX_THREADS];
+    int_array numbers;
+    int threads = cpu_count();
+
+    // parse_file_parallel uses at most TEXT_MAX_THREADS threads, and only
+    // fills in stats for the ones it used.
+    if (threads > TEXT_MAX_THREADS)
+    {
+        threads = TEXT_MAX_THREADS;
+    }
+
+    // Each thread parses its own part of the file, and the results are
+    // merged in file order.
+    int_array_init(&numbers);
+    if (parse_file_parallel(name, threads, TEXT_KERNEL_AUTO, &numbers, stats))
+    {
+        printf("failed to parse %s\n", name);
+        int_array_free(&numbers);
+        return;
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        printf("thread %d parsed %zu values from %zu bytes\n", i, stats[i].count, stats[i].bytes);
+    }
+
+    printf("data from file (%d threads):\n", threads);
+    for (size_t i = 0; i < numbers.size; i++)
+    {
+        printf("txt[%zu] %d\n", i, numbers.data[i]);
+    }
+
+    int_array_free(&numbers);
+}
+
 int main()
 {
     FILE *f;
@@ -175,6 +396,13 @@ int main()
     // read_data(f);
     // fclose(f);
 
+    // Read binary data without copying it through a stdio buffer.
+    read_data_mapped("bin.jep");
+
+    // Write and read a container of many records.
+    // write_records("records.jep", 1000);
+    // read_records("records.jep");
+
     //------------------------------------------------------------------------
     // Text File IO
 
@@ -188,6 +416,16 @@ int main()
     // write_text(f);
     // fclose(f);
 
+    // Write text data in batches.
+    // f = open_file("data.txt", "w");
+    // if (f == NULL)
+    // {
+    //     fprintf(stderr, "failed to open file for writing\n");
+    //     return 1;
+    // }
+    // write_text_batched(f);
+    // fclose(f);
+
     // Read text data.
     f = open_file("data.txt", "r");
     if (f == NULL)
@@ -198,5 +436,28 @@ int main()
     read_text(f);
     fclose(f);
 
+    // Read text data in bulk.
+    f = open_file("data.txt", "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "failed to open file for reading\n");
+        return 1;
+    }
+    read_text_bulk(f);
+    fclose(f);
+
+    // Read text data while the next block is read in the background.
+    f = open_file("data.txt", "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "failed to open file for reading\n");
+        return 1;
+    }
+    read_text_async(f);
+    fclose(f);
+
+    // Read text data on several threads.
+    read_text_parallel("data.txt");
+
     return 0;
 }
\ No newline at end of file
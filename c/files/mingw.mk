@@ -1,2 +1,7 @@
+SRC = files.c jep.c text.c async.c
+
 all:
-	gcc -Wall -Werror main.c -o files.exe
+	gcc -Wall -Werror main.c $(SRC) -o files.exe
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.exe
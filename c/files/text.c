@@ -0,0 +1,788 @@
+#include "text.h"
+#include "files.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// The vectorized kernels use GCC/Clang target attributes so that they can be
+// compiled without -msse4.2 or -mavx2 and selected at runtime.
+// Other compilers and architectures only get the scalar kernel.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEXT_HAVE_X86_SIMD
+#include <immintrin.h>
+#define TEXT_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TEXT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// The smallest capacity allocated by int_array_reserve.
+#define INT_ARRAY_MIN_CAP 16
+
+const char *text_kernel_names[TEXT_KERNEL_MAX] = {
+    "auto",
+    "scalar",
+    "sse4.2",
+    "avx2"};
+
+void int_array_init(int_array *a)
+{
+    a->data = NULL;
+    a->size = 0;
+    a->cap = 0;
+}
+
+int int_array_reserve(int_array *a, size_t n)
+{
+    size_t cap = a->cap;
+    int *data;
+
+    if (n <= cap)
+        return 0;
+
+    if (cap < INT_ARRAY_MIN_CAP)
+        cap = INT_ARRAY_MIN_CAP;
+    while (cap < n)
+        cap *= 2;
+
+    data = realloc(a->data, cap * sizeof(int));
+    if (data == NULL)
+        return 1;
+
+    a->data = data;
+    a->cap = cap;
+
+    return 0;
+}
+
+void int_array_free(int_array *a)
+{
+    free(a->data);
+    int_array_init(a);
+}
+
+//----------------------------------------------------------------------------
+// scalar helpers
+
+// The same characters that isspace accepts in the "C" locale.
+static inline int is_space(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int is_digit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+static inline const char *skip_space(const char *p, const char *end)
+{
+    while (p < end && is_space(*p))
+        p++;
+    return p;
+}
+
+static inline const char *parse_sign(const char *p, const char *end, int *neg)
+{
+    *neg = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        *neg = *p == '-';
+        p++;
+    }
+    return p;
+}
+
+// Converts the value to an int the same way a cast from unsigned would,
+// which makes out of range values wrap around.
+static inline int to_int(unsigned long long v, int neg)
+{
+    unsigned int u = (unsigned int)v;
+    return (int)(neg ? 0u - u : u);
+}
+
+static inline const char *parse_digits_scalar(const char *p, const char *end, unsigned long long *v)
+{
+    unsigned long long n = 0;
+
+    while (p < end && is_digit(*p))
+    {
+        n = n * 10 + (unsigned long long)(*p - '0');
+        p++;
+    }
+
+    *v = n;
+    return p;
+}
+
+// Defines a kernel that parses one value at a time with the given digit
+// parser. Each kernel needs its own copy of the loop so that the digit parser
+// can be inlined into a function with the matching target attribute.
+#define DEFINE_PARSE_RANGE(name, parse_digits)                              \
+    static int name(const char *p, const char *end, int_array *out)         \
+    {                                                                       \
+        for (;;)                                                            \
+        {                                                                   \
+            unsigned long long v;                                           \
+            const char *d;                                                  \
+            int neg;                                                        \
+                                                                            \
+            p = skip_space(p, end);                                         \
+            if (p == end)                                                   \
+                return 0;                                                   \
+                                                                            \
+            p = parse_sign(p, end, &neg);                                   \
+            d = parse_digits(p, end, &v);                                   \
+            if (d == p || int_array_push(out, to_int(v, neg)))              \
+                return 1;                                                   \
+            p = d;                                                          \
+        }                                                                   \
+    }
+
+DEFINE_PARSE_RANGE(parse_range_scalar, parse_digits_scalar)
+
+//----------------------------------------------------------------------------
+// vectorized kernels
+//
+// The digits of a value are loaded 16 at a time and converted with a few
+// multiply-add instructions:
+//
+//   1. subtract '0' from every byte and find the length of the digit run
+//   2. shuffle the digits so that the last one lands in byte 15
+//   3. maddubs: pairs of digits  -> 8 values in 0..99
+//   4. madd:    pairs of those   -> 4 values in 0..9999
+//   5. packus + madd             -> 2 values in 0..99999999
+//   6. combine the two halves in a 64-bit scalar
+//
+// Values with 16 or more digits, and values within 16 bytes of the end of the
+// range, fall back to the scalar loop so that no load crosses the range.
+
+#ifdef TEXT_HAVE_X86_SIMD
+
+// Gets the number of leading bytes of v that are digits, where '0' has
+// already been subtracted from each byte.
+TEXT_TARGET_SSE42 static inline unsigned digit_run(__m128i v)
+{
+    __m128i nine = _mm_set1_epi8(9);
+    __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(v, nine), v);
+    unsigned mask = (unsigned)_mm_movemask_epi8(digits);
+    return (unsigned)__builtin_ctz(~mask);
+}
+
+// Builds a shuffle control that moves the first len bytes to the end of the
+// vector. Lanes that would come from before the start of the vector end up
+// with the high bit set, which makes pshufb write a zero.
+TEXT_TARGET_SSE42 static inline __m128i align_control(unsigned len)
+{
+    __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_add_epi8(iota, _mm_set1_epi8((char)(len - 16)));
+}
+
+TEXT_TARGET_SSE42 static inline unsigned long long convert_digits(__m128i v, unsigned len)
+{
+    __m128i x = _mm_shuffle_epi8(v, align_control(len));
+    x = _mm_maddubs_epi16(x, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    x = _mm_madd_epi16(x, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    x = _mm_packus_epi32(x, x);
+    x = _mm_madd_epi16(x, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+    return (unsigned long long)(unsigned)_mm_cvtsi128_si32(x) * 100000000ull +
+           (unsigned)_mm_extract_epi32(x, 1);
+}
+
+TEXT_TARGET_SSE42 static inline const char *parse_digits_sse42(const char *p, const char *end, unsigned long long *v)
+{
+    __m128i d;
+    unsigned len;
+
+    if (end - p < 16)
+        return parse_digits_scalar(p, end, v);
+
+    d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8('0'));
+    len = digit_run(d);
+    if (len == 16)
+        return parse_digits_scalar(p, end, v);
+
+    *v = convert_digits(d, len);
+    return p + len;
+}
+
+TEXT_TARGET_SSE42 DEFINE_PARSE_RANGE(parse_range_sse42, parse_digits_sse42)
+
+// The AVX2 kernel converts two values per iteration, one in each 128-bit
+// lane. Every instruction used by convert_digits operates within a lane, so
+// the same sequence works on both values at once.
+TEXT_TARGET_AVX2 static int parse_range_avx2(const char *p, const char *end, int_array *out)
+{
+    const __m128i zero = _mm_set1_epi8('0');
+
+    for (;;)
+    {
+        const char *a;
+        const char *b;
+        __m128i da;
+        __m128i db;
+        __m256i x;
+        unsigned len_a;
+        unsigned len_b;
+        int neg_a;
+        int neg_b;
+
+        p = skip_space(p, end);
+        if (p == end)
+            return 0;
+
+        a = parse_sign(p, end, &neg_a);
+        if (end - a < 16)
+            return parse_range_sse42(p, end, out);
+
+        da = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)a), zero);
+        len_a = digit_run(da);
+        if (len_a == 0)
+            return 1;
+        if (len_a == 16)
+        {
+            unsigned long long v;
+            p = parse_digits_scalar(a, end, &v);
+            if (int_array_push(out, to_int(v, neg_a)))
+                return 1;
+            continue;
+        }
+
+        b = parse_sign(skip_space(a + len_a, end), end, &neg_b);
+        len_b = 0;
+        if (end - b >= 16)
+        {
+            db = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)b), zero);
+            len_b = digit_run(db);
+        }
+
+        // If there is no second value that fits the fast path, convert the
+        // first one by itself and let the next iteration deal with the rest.
+        if (len_b == 0 || len_b == 16)
+        {
+            if (int_array_push(out, to_int(convert_digits(da, len_a), neg_a)))
+                return 1;
+            p = a + len_a;
+            continue;
+        }
+
+        x = _mm256_shuffle_epi8(_mm256_set_m128i(db, da),
+                                _mm256_set_m128i(align_control(len_b), align_control(len_a)));
+        x = _mm256_maddubs_epi16(x, _mm256_set1_epi16(0x010A));
+        x = _mm256_madd_epi16(x, _mm256_set1_epi32(0x00010064));
+        x = _mm256_packus_epi32(x, x);
+        x = _mm256_madd_epi16(x, _mm256_set1_epi32(0x00012710));
+
+        if (out->cap - out->size < 2 && int_array_reserve(out, out->size + 2))
+            return 1;
+
+        out->data[out->size++] = to_int((unsigned long long)(unsigned)_mm256_extract_epi32(x, 0) * 100000000ull +
+                                            (unsigned)_mm256_extract_epi32(x, 1),
+                                        neg_a);
+        out->data[out->size++] = to_int((unsigned long long)(unsigned)_mm256_extract_epi32(x, 4) * 100000000ull +
+                                            (unsigned)_mm256_extract_epi32(x, 5),
+                                        neg_b);
+
+        p = b + len_b;
+    }
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+text_kernel text_select_kernel(text_kernel kernel)
+{
+    if (kernel == TEXT_KERNEL_AUTO || kernel >= TEXT_KERNEL_MAX)
+        kernel = TEXT_KERNEL_AVX2;
+
+#ifdef TEXT_HAVE_X86_SIMD
+    if (kernel == TEXT_KERNEL_AVX2 && __builtin_cpu_supports("avx2"))
+        return TEXT_KERNEL_AVX2;
+    if (kernel >= TEXT_KERNEL_SSE42 && __builtin_cpu_supports("sse4.2"))
+        return TEXT_KERNEL_SSE42;
+#endif
+
+    return TEXT_KERNEL_SCALAR;
+}
+
+int parse_int_range(const char *begin, const char *end, text_kernel kernel, int_array *out)
+{
+    switch (text_select_kernel(kernel))
+    {
+#ifdef TEXT_HAVE_X86_SIMD
+    case TEXT_KERNEL_AVX2:  return parse_range_avx2(begin, end, out);
+    case TEXT_KERNEL_SSE42: return parse_range_sse42(begin, end, out);
+#endif
+    default:                return parse_range_scalar(begin, end, out);
+    }
+}
+
+int parse_ints(FILE *stream, text_kernel kernel, int_array *out)
+{
+    size_t carry = 0;
+    int res = 1;
+
+    char *buffer = malloc(TEXT_BLOCK_SIZE);
+    if (buffer == NULL)
+        return 1;
+
+    kernel = text_select_kernel(kernel);
+
+    for (;;)
+    {
+        size_t n = fread(buffer + carry, sizeof(char), TEXT_BLOCK_SIZE - carry, stream);
+        size_t len = carry + n;
+        size_t limit = len;
+        int last = n < TEXT_BLOCK_SIZE - carry;
+
+        // A value may be cut off at the end of the block, so only parse up
+        // to the last whitespace and carry the rest over to the next block.
+        if (!last)
+        {
+            while (limit > 0 && !is_space(buffer[limit - 1]))
+                limit--;
+
+            // A single token that fills the whole block can't be an int.
+            if (limit == 0)
+                break;
+        }
+
+        if (parse_int_range(buffer, buffer + limit, kernel, out))
+            break;
+
+        if (last)
+        {
+            res = ferror(stream) ? 1 : 0;
+            break;
+        }
+
+        carry = len - limit;
+        memmove(buffer, buffer + limit, carry);
+    }
+
+    free(buffer);
+    return res;
+}
+
+//----------------------------------------------------------------------------
+// overlapped parsing
+
+int parse_ints_async(async_context *ctx, int fd, text_kernel kernel, int_array *out)
+{
+    char *buffers[2];
+    async_request req;
+    async_request *submit = &req;
+    async_request *done;
+    uint64_t offset = 0;
+    size_t filled = 0;
+    size_t carry = 0;
+    int pending = 0;
+    int res = 1;
+    int k = 0;
+
+    // Each block is read into the second half of a buffer. The first half
+    // receives whatever was left over at the end of the previous block,
+    // which can be copied in while the next read is still in flight.
+    buffers[0] = malloc(2 * (size_t)TEXT_BLOCK_SIZE);
+    buffers[1] = malloc(2 * (size_t)TEXT_BLOCK_SIZE);
+    if (buffers[0] == NULL || buffers[1] == NULL)
+    {
+        free(buffers[0]);
+        free(buffers[1]);
+        return 1;
+    }
+
+    kernel = text_select_kernel(kernel);
+
+    req.fd = fd;
+    req.op = ASYNC_READ;
+    req.buffer = buffers[0] + TEXT_BLOCK_SIZE;
+    req.len = TEXT_BLOCK_SIZE;
+    req.offset = 0;
+    pending = async_submit(ctx, &submit, 1) == 1;
+
+    while (pending)
+    {
+        char *start;
+        size_t len;
+        size_t limit;
+        long long n;
+        int last;
+
+        async_wait(ctx, &done, 1, 1);
+        pending = 0;
+
+        n = req.result;
+        if (n < 0)
+            break;
+
+        // Only an empty read means the end of the file. A short read just
+        // asks for the rest of the block again.
+        filled += (size_t)n;
+        if (n > 0 && filled < TEXT_BLOCK_SIZE)
+        {
+            req.buffer = buffers[k] + TEXT_BLOCK_SIZE + filled;
+            req.len = TEXT_BLOCK_SIZE - filled;
+            req.offset = offset + filled;
+            pending = async_submit(ctx, &submit, 1) == 1;
+            continue;
+        }
+
+        last = filled < TEXT_BLOCK_SIZE;
+        start = buffers[k] + TEXT_BLOCK_SIZE - carry;
+        len = carry + filled;
+        limit = len;
+        filled = 0;
+
+        // Start reading the next block before parsing this one.
+        if (!last)
+        {
+            offset += TEXT_BLOCK_SIZE;
+            req.buffer = buffers[k ^ 1] + TEXT_BLOCK_SIZE;
+            req.len = TEXT_BLOCK_SIZE;
+            req.offset = offset;
+            pending = async_submit(ctx, &submit, 1) == 1;
+            if (!pending)
+                break;
+
+            while (limit > 0 && !is_space(start[limit - 1]))
+                limit--;
+
+            // A value that doesn't fit in the carry space can't be an int.
+            if (limit == 0 || len - limit > TEXT_BLOCK_SIZE)
+                break;
+        }
+
+        if (parse_int_range(start, start + limit, kernel, out))
+            break;
+
+        if (last)
+        {
+            res = 0;
+            break;
+        }
+
+        carry = len - limit;
+        memcpy(buffers[k ^ 1] + TEXT_BLOCK_SIZE - carry, start + limit, carry);
+        k ^= 1;
+    }
+
+    // Never free a buffer that the kernel or a worker thread is writing to.
+    if (pending)
+        async_wait(ctx, &done, 1, 1);
+
+    free(buffers[0]);
+    free(buffers[1]);
+    return res;
+}
+
+//----------------------------------------------------------------------------
+// parallel parsing
+
+// A range of a file parsed by one thread.
+typedef struct parse_task
+{
+    const char *begin;
+    const char *end;
+    text_kernel kernel;
+    int_array values;
+    int res;
+    parse_stats stats;
+} parse_task;
+
+static void run_parse_task(parse_task *task)
+{
+    double t = now_seconds();
+
+    task->res = parse_int_range(task->begin, task->end, task->kernel, &task->values);
+
+    task->stats.bytes = (size_t)(task->end - task->begin);
+    task->stats.count = task->values.size;
+    task->stats.seconds = now_seconds() - t;
+}
+
+#ifdef _WIN32
+typedef HANDLE text_thread;
+
+static unsigned __stdcall parse_task_main(void *arg)
+{
+    run_parse_task(arg);
+    return 0;
+}
+
+static int start_thread(text_thread *thread, parse_task *task)
+{
+    *thread = (HANDLE)_beginthreadex(NULL, 0, parse_task_main, task, 0, NULL);
+    return *thread == 0;
+}
+
+static void join_thread(text_thread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t text_thread;
+
+static void *parse_task_main(void *arg)
+{
+    run_parse_task(arg);
+    return NULL;
+}
+
+static int start_thread(text_thread *thread, parse_task *task)
+{
+    return pthread_create(thread, NULL, parse_task_main, task) != 0;
+}
+
+static void join_thread(text_thread thread)
+{
+    pthread_join(thread, NULL);
+}
+#endif
+
+int parse_file_parallel(const char *name, int threads, text_kernel kernel, int_array *out, parse_stats *stats)
+{
+    parse_task tasks[TEXT_MAX_THREADS];
+    text_thread handles[TEXT_MAX_THREADS];
+    int started[TEXT_MAX_THREADS];
+    file_view view;
+    const char *data;
+    const char *prev;
+    size_t total = 0;
+    int res = 0;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > TEXT_MAX_THREADS)
+        threads = TEXT_MAX_THREADS;
+
+    if (view_file(name, FILE_VIEW_DEFAULT, &view))
+        return 1;
+
+    data = (const char *)view.data;
+    kernel = text_select_kernel(kernel);
+
+    // Split the file into ranges of roughly equal size. Each boundary is
+    // moved forward to just after the next newline so that no value is
+    // split between two threads.
+    prev = data;
+    for (int i = 0; i < threads; i++)
+    {
+        const char *end = data + view.size;
+
+        if (i < threads - 1)
+        {
+            const char *nl;
+            const char *b = data + view.size / (size_t)threads * (size_t)(i + 1);
+            if (b < prev)
+                b = prev;
+
+            nl = memchr(b, '\n', (size_t)(end - b));
+            if (nl != NULL)
+                end = nl + 1;
+        }
+
+        tasks[i].begin = prev;
+        tasks[i].end = end;
+        tasks[i].kernel = kernel;
+        tasks[i].res = 0;
+        int_array_init(&tasks[i].values);
+        prev = end;
+    }
+
+    // The calling thread takes the first range itself. If a thread can't be
+    // started, its range is parsed on the calling thread afterwards.
+    for (int i = 1; i < threads; i++)
+        started[i] = !start_thread(&handles[i], &tasks[i]);
+
+    run_parse_task(&tasks[0]);
+
+    for (int i = 1; i < threads; i++)
+    {
+        if (started[i])
+            join_thread(handles[i]);
+        else
+            run_parse_task(&tasks[i]);
+    }
+
+    // Merge in file order, stopping after the first range that failed so
+    // that the output matches what a sequential parse would produce.
+    for (int i = 0; i < threads; i++)
+    {
+        total += tasks[i].values.size;
+        if (tasks[i].res)
+            break;
+    }
+
+    if (int_array_reserve(out, out->size + total))
+        res = 1;
+
+    for (int i = 0; i < threads; i++)
+    {
+        if (stats != NULL)
+            stats[i] = tasks[i].stats;
+
+        if (res == 0)
+        {
+            memcpy(out->data + out->size, tasks[i].values.data, tasks[i].values.size * sizeof(int));
+            out->size += tasks[i].values.size;
+            res = tasks[i].res;
+        }
+
+        int_array_free(&tasks[i].values);
+    }
+
+    release_file(&view);
+    return res;
+}
+
+//----------------------------------------------------------------------------
+// batched writing
+
+// The longest line written for an int, which is "-2147483648\n".
+#define TEXT_MAX_INT_LINE 12
+
+// Every two digit number from 00 to 99, so that digits can be produced in
+// pairs with one division by 100 instead of two divisions by 10.
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline unsigned count_digits(unsigned int v)
+{
+    unsigned n = 1;
+    while (v >= 10000)
+    {
+        v /= 10000;
+        n += 4;
+    }
+    return n + (v >= 10) + (v >= 100) + (v >= 1000);
+}
+
+// Formats a value followed by a newline and returns the number of bytes
+// written. The digits are written from the end, two at a time.
+static inline size_t format_int_line(char *p, int value)
+{
+    unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    size_t sign = value < 0;
+    size_t len = sign + count_digits(v);
+    char *d = p + len;
+
+    p[0] = '-';
+    *d = '\n';
+
+    while (v >= 100)
+    {
+        unsigned int r = (v % 100) * 2;
+        v /= 100;
+        d -= 2;
+        d[0] = digit_pairs[r];
+        d[1] = digit_pairs[r + 1];
+    }
+
+    if (v >= 10)
+    {
+        d -= 2;
+        d[0] = digit_pairs[v * 2];
+        d[1] = digit_pairs[v * 2 + 1];
+    }
+    else
+    {
+        d[-1] = (char)('0' + v);
+    }
+
+    return len + 1;
+}
+
+static int write_all(int fd, const char *p, size_t n)
+{
+    while (n > 0)
+    {
+#ifdef _WIN32
+        int res = _write(fd, p, n > INT_MAX ? INT_MAX : (unsigned int)n);
+#else
+        ssize_t res = write(fd, p, n);
+#endif
+        if (res <= 0)
+            return 1;
+        p += res;
+        n -= (size_t)res;
+    }
+    return 0;
+}
+
+int text_writer_open(text_writer *w, FILE *stream, size_t cap)
+{
+    if (cap < TEXT_MAX_INT_LINE)
+        cap = TEXT_WRITER_BUFFER_SIZE;
+
+    if (fflush(stream))
+        return 1;
+
+    w->buffer = malloc(cap);
+    if (w->buffer == NULL)
+        return 1;
+
+#ifdef _WIN32
+    w->fd = _fileno(stream);
+#else
+    w->fd = fileno(stream);
+#endif
+    w->size = 0;
+    w->cap = cap;
+    w->error = 0;
+
+    return 0;
+}
+
+int text_writer_put_ints(text_writer *w, const int *values, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (w->cap - w->size < TEXT_MAX_INT_LINE && text_writer_flush(w))
+            return 1;
+
+        w->size += format_int_line(w->buffer + w->size, values[i]);
+    }
+
+    return 0;
+}
+
+int text_writer_flush(text_writer *w)
+{
+    if (w->size > 0 && !w->error)
+        w->error = write_all(w->fd, w->buffer, w->size);
+
+    w->size = 0;
+    return w->error;
+}
+
+int text_writer_close(text_writer *w)
+{
+    int res = text_writer_flush(w);
+
+    free(w->buffer);
+    w->buffer = NULL;
+    w->cap = 0;
+
+    return res;
+}
@@ -0,0 +1,244 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "async.h"
+
+// The number of bytes read from the stream by each fread call in parse_ints.
+#define TEXT_BLOCK_SIZE (1 << 20)
+
+// The default size of the buffer used by text_writer.
+#define TEXT_WRITER_BUFFER_SIZE (1 << 20)
+
+// The largest number of threads used by parse_file_parallel.
+#define TEXT_MAX_THREADS 256
+
+// A growable array of int.
+typedef struct int_array
+{
+    int *data;
+    size_t size;
+    size_t cap;
+} int_array;
+
+// The digit conversion kernels available to parse_ints.
+// TEXT_KERNEL_AUTO picks the fastest one supported by the CPU.
+typedef enum text_kernel
+{
+    TEXT_KERNEL_AUTO = 0,
+    TEXT_KERNEL_SCALAR,
+    TEXT_KERNEL_SSE42,
+    TEXT_KERNEL_AVX2,
+    TEXT_KERNEL_MAX,
+} text_kernel;
+
+// What one thread of parse_file_parallel did.
+typedef struct parse_stats
+{
+    size_t bytes;   // the size of the thread's range of the file
+    size_t count;   // the number of values parsed from the range
+    double seconds; // the time spent parsing the range
+} parse_stats;
+
+// Formats integers into a large buffer and writes the buffer to a file
+// descriptor with a single write call whenever it fills up.
+typedef struct text_writer
+{
+    int fd;       // the descriptor that receives the output
+    char *buffer; // formatted text that has not been written yet
+    size_t size;  // the number of bytes in the buffer
+    size_t cap;   // the capacity of the buffer
+    int error;    // 1 if a write has failed
+} text_writer;
+
+extern const char *text_kernel_names[TEXT_KERNEL_MAX];
+
+/**
+ * Initializes an empty array.
+ *
+ * Params:
+ *   int_array* - the array to initialize
+ */
+void int_array_init(int_array *a);
+
+/**
+ * Ensures an array can hold at least n elements without reallocating.
+ * The capacity grows geometrically so that repeated appends are amortized
+ * constant time.
+ *
+ * Params:
+ *   int_array* - the array
+ *   size_t - the required capacity
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int int_array_reserve(int_array *a, size_t n);
+
+/**
+ * Releases the memory held by an array.
+ *
+ * Params:
+ *   int_array* - the array
+ */
+void int_array_free(int_array *a);
+
+/**
+ * Appends a value to the end of an array.
+ *
+ * Params:
+ *   int_array* - the array
+ *   int - the value to append
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+static inline int int_array_push(int_array *a, int v)
+{
+    if (a->size == a->cap && int_array_reserve(a, a->size + 1))
+        return 1;
+
+    a->data[a->size++] = v;
+    return 0;
+}
+
+/**
+ * Gets the kernel that parse_ints would actually use for a request.
+ * Kernels that the CPU does not support are replaced with the next best one.
+ *
+ * Params:
+ *   text_kernel - the requested kernel
+ *
+ * Returns:
+ *   text_kernel - the kernel that will be used
+ */
+text_kernel text_select_kernel(text_kernel kernel);
+
+/**
+ * Parses whitespace-separated decimal integers in a range of memory.
+ * The rules are the same as repeatedly calling fscanf with "%d": leading
+ * whitespace is skipped and each value may have a leading '+' or '-'.
+ * Values that don't fit in an int wrap around.
+ *
+ * Params:
+ *   const char* - the first character of the range
+ *   const char* - one past the last character of the range
+ *   text_kernel - the digit conversion kernel to use
+ *   int_array* - the array that receives the values
+ *
+ * Returns:
+ *   int - 0 if the whole range was parsed, 1 if something other than an
+ *         integer was encountered or the array could not grow
+ */
+int parse_int_range(const char *begin, const char *end, text_kernel kernel, int_array *out);
+
+/**
+ * Reads every integer from a stream in large blocks.
+ * This replaces a loop of fscanf calls. Because whole blocks are read,
+ * feof may be set even when parsing stopped at bad input, so use the
+ * return value to tell whether the end was reached. ferror still reports
+ * read errors.
+ *
+ * Params:
+ *   FILE* - the input stream
+ *   text_kernel - the digit conversion kernel to use
+ *   int_array* - the array that receives the values
+ *
+ * Returns:
+ *   int - 0 if the end of the stream was reached, 1 if parsing stopped
+ *         early because of bad input, a read error, or a failed allocation
+ */
+int parse_ints(FILE *stream, text_kernel kernel, int_array *out);
+
+/**
+ * Reads every integer from a file descriptor while the next block is being
+ * read in the background. Two buffers take turns: while one of them is being
+ * parsed, an async request fills the other one.
+ *
+ * Params:
+ *   async_context* - a queue with at least one free slot
+ *   int - the descriptor of a regular file, see async_fileno
+ *   text_kernel - the digit conversion kernel to use
+ *   int_array* - the array that receives the values
+ *
+ * Returns:
+ *   int - 0 if the end of the file was reached, 1 if parsing stopped early
+ *         because of bad input, a read error, or a failed allocation
+ */
+int parse_ints_async(async_context *ctx, int fd, text_kernel kernel, int_array *out);
+
+/**
+ * Reads every integer from a file using several threads.
+ * The file is mapped into memory and split into one byte range per thread,
+ * with each boundary moved forward to just after a newline. The values from
+ * each range are then appended to the output array in file order, so the
+ * result is the same as calling parse_ints on the whole file.
+ *
+ * Params:
+ *   const char* - the name of the file
+ *   int - the number of threads, which is clamped to 1..TEXT_MAX_THREADS
+ *   text_kernel - the digit conversion kernel to use
+ *   int_array* - the array that receives the values
+ *   parse_stats* - an array with one element per thread that receives the
+ *                  throughput of each thread, or NULL
+ *
+ * Returns:
+ *   int - 0 if the whole file was parsed, 1 if the file could not be read,
+ *         something other than an integer was encountered, or an array
+ *         could not grow
+ */
+int parse_file_parallel(const char *name, int threads, text_kernel kernel, int_array *out, parse_stats *stats);
+
+/**
+ * Prepares a writer that appends to a stream.
+ * Anything already buffered by the stream is flushed first. After that, the
+ * stream should not be written to with stdio until the writer is closed.
+ *
+ * Params:
+ *   text_writer* - the writer to initialize
+ *   FILE* - the output stream
+ *   size_t - the size of the buffer, or 0 for TEXT_WRITER_BUFFER_SIZE
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int text_writer_open(text_writer *w, FILE *stream, size_t cap);
+
+/**
+ * Writes integers, one per line, the same way as fprintf with "%d\n".
+ *
+ * Params:
+ *   text_writer* - the writer
+ *   const int* - the values to write
+ *   size_t - the number of values
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int text_writer_put_ints(text_writer *w, const int *values, size_t n);
+
+/**
+ * Writes everything in the buffer to the file descriptor.
+ *
+ * Params:
+ *   text_writer* - the writer
+ *
+ * Returns:
+ *   int - 0 on success, 1 if this or any earlier write failed
+ */
+int text_writer_flush(text_writer *w);
+
+/**
+ * Flushes a writer and releases its buffer.
+ *
+ * Params:
+ *   text_writer* - the writer
+ *
+ * Returns:
+ *   int - 0 on success, 1 if any write failed
+ */
+int text_writer_close(text_writer *w);
+
+#endif
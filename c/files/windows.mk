@@ -1,2 +1,7 @@
+SRC = files.c jep.c text.c async.c
+
 all:
-	cl /W3 /WX main.c /Fe"files.exe"
+	cl /W3 /WX main.c $(SRC) /Fe"files.exe"
+
+bench:
+	cl /W3 /WX /O2 bench.c $(SRC) /Fe"bench.exe"
@@ -0,0 +1,291 @@
+// Benchmarks for the fundamentals examples.
+//
+// Usage:
+//   bench.out [name] [megabytes]
+//
+// If no name is given, every benchmark is run.
+// Each benchmark works on roughly the requested amount of random bytes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <time.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include "bitset.h"
+#include "hexdump.h"
+
+#define BENCH_DEFAULT_MB 64
+
+// The number of bytes formatted before each write to the output stream.
+#define BENCH_CHUNK_SIZE (64 * 1024)
+
+typedef void (*bench_fn)(size_t);
+
+typedef struct bench
+{
+    const char *name;
+    bench_fn run;
+} bench;
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double now_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+static void report(const char *label, size_t bytes, double seconds)
+{
+    printf("  %-28s %10.3f GB/s  (%.3f s)\n", label, (double)bytes / 1e9 / seconds, seconds);
+}
+
+//----------------------------------------------------------------------------
+// hex: printf per byte versus hex_bytes and hex_dump with each kernel
+
+static void bench_hex(size_t mb)
+{
+    size_t bytes = mb * 1024 * 1024;
+    unsigned char *data = malloc(bytes);
+    char *text = malloc(HEX_DUMP_SIZE(BENCH_CHUNK_SIZE));
+    FILE *null_stream = fopen(NULL_DEVICE, "wb");
+    unsigned long long seed = 24601;
+    double start;
+
+    if (data == NULL || text == NULL || null_stream == NULL)
+    {
+        fprintf(stderr, "failed to set up %zu MB of input\n", mb);
+        free(data);
+        free(text);
+        if (null_stream != NULL)
+            fclose(null_stream);
+        return;
+    }
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (unsigned char)(seed >> 56);
+    }
+
+    printf("hex: %zu MB to %s, in GB/s of input\n", mb, NULL_DEVICE);
+
+    // What print_array used to do.
+    start = now_seconds();
+    for (size_t i = 0; i < bytes; i++)
+        fprintf(null_stream, "%X ", data[i]);
+    report("fprintf per byte", bytes, now_seconds() - start);
+
+    for (int k = HEX_KERNEL_SCALAR; k < HEX_KERNEL_MAX; k++)
+    {
+        char label[64];
+
+        if (hex_select_kernel((hex_kernel)k) != (hex_kernel)k)
+            continue;
+
+        start = now_seconds();
+        for (size_t i = 0; i < bytes; i += BENCH_CHUNK_SIZE)
+        {
+            size_t n = bytes - i < BENCH_CHUNK_SIZE ? bytes - i : BENCH_CHUNK_SIZE;
+            fwrite(text, 1, hex_bytes(data + i, n, HEX_UPPERCASE, (hex_kernel)k, text), null_stream);
+        }
+        snprintf(label, sizeof(label), "hex_bytes %s", hex_kernel_names[k]);
+        report(label, bytes, now_seconds() - start);
+    }
+
+    for (int k = HEX_KERNEL_SCALAR; k < HEX_KERNEL_MAX; k++)
+    {
+        char label[64];
+
+        if (hex_select_kernel((hex_kernel)k) != (hex_kernel)k)
+            continue;
+
+        start = now_seconds();
+        for (size_t i = 0; i < bytes; i += BENCH_CHUNK_SIZE)
+        {
+            size_t n = bytes - i < BENCH_CHUNK_SIZE ? bytes - i : BENCH_CHUNK_SIZE;
+            fwrite(text, 1, hex_dump(data + i, n, i, HEX_LOWERCASE, (hex_kernel)k, text), null_stream);
+        }
+        snprintf(label, sizeof(label), "hex_dump %s", hex_kernel_names[k]);
+        report(label, bytes, now_seconds() - start);
+    }
+
+    fclose(null_stream);
+    free(data);
+    free(text);
+}
+
+//----------------------------------------------------------------------------
+// bits: a loop over every bit versus the bitset operations with each kernel
+
+// Runs one bitset operation with every kernel the CPU supports.
+#define BENCH_BIT_KERNELS(what, bytes, check, expr)                          \
+    for (int k = BIT_KERNEL_SCALAR; k < BIT_KERNEL_MAX; k++)                 \
+    {                                                                        \
+        char label[64];                                                      \
+        bit_kernel kernel = (bit_kernel)k;                                   \
+        double start;                                                        \
+                                                                             \
+        if (bit_select_kernel(kernel) != kernel)                             \
+            continue;                                                        \
+                                                                             \
+        start = now_seconds();                                               \
+        check += (expr);                                                     \
+        snprintf(label, sizeof(label), "%s %s", what, bit_kernel_names[k]);  \
+        report(label, bytes, now_seconds() - start);                         \
+    }
+
+// Writes the bytes as text in chunks, the way print_bits would with a
+// buffer.
+static size_t render_chunks(const bitset *bs, size_t bytes, bit_kernel kernel, char *text, FILE *out)
+{
+    for (size_t i = 0; i < bytes; i += BENCH_CHUNK_SIZE)
+    {
+        size_t n = bytes - i < BENCH_CHUNK_SIZE ? bytes - i : BENCH_CHUNK_SIZE;
+        fwrite(text, 1, bits_render(bs->bytes + i, n, kernel, text), out);
+    }
+    return bytes;
+}
+
+static size_t toggle_twice(bitset *bs, bit_kernel kernel)
+{
+    bitset_toggle_range(bs, 1, bs->nbits - 2, kernel);
+    bitset_toggle_range(bs, 1, bs->nbits - 2, kernel);
+    return bs->bytes[0];
+}
+
+static void bench_bits(size_t mb)
+{
+    size_t bytes = mb * 1024 * 1024;
+    size_t nbits = bytes * 8;
+    char *text = malloc(BITS_RENDER_SIZE(BENCH_CHUNK_SIZE));
+    FILE *null_stream = fopen(NULL_DEVICE, "wb");
+    unsigned long long seed = 24601;
+    unsigned long long check = 0;
+    bitset bits;
+    bitset sparse;
+    double start;
+
+    if (bitset_init(&bits, nbits) || bitset_init(&sparse, nbits) || text == NULL || null_stream == NULL)
+    {
+        fprintf(stderr, "failed to set up %zu MB of bits\n", mb);
+        bitset_free(&bits);
+        bitset_free(&sparse);
+        free(text);
+        if (null_stream != NULL)
+            fclose(null_stream);
+        return;
+    }
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        bits.bytes[i] = (unsigned char)(seed >> 56);
+    }
+
+    // Only the last bit is set, so finding it has to look at everything.
+    bitset_set_range(&sparse, nbits - 1, 1);
+
+    printf("bits: %zu MB, in GB/s of bits\n", mb);
+
+    // What print_bits used to do for every byte.
+    start = now_seconds();
+    for (size_t i = 0; i < bytes; i++)
+    {
+        for (int b = 0; b < 8; b++)
+            putc((bits.bytes[i] & (1 << (8 - b - 1))) ? '1' : '0', null_stream);
+    }
+    report("render putc per bit", bytes, now_seconds() - start);
+    BENCH_BIT_KERNELS("render", bytes, check, render_chunks(&bits, bytes, kernel, text, null_stream));
+
+    start = now_seconds();
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < nbits; i++)
+            count += bitset_test(&bits, i);
+        check += count;
+    }
+    report("popcount per bit", bytes, now_seconds() - start);
+    BENCH_BIT_KERNELS("popcount", bytes, check, bitset_popcount(&bits, kernel));
+
+    start = now_seconds();
+    {
+        size_t i = 0;
+        while (i < nbits && !bitset_test(&sparse, i))
+            i++;
+        check += i;
+    }
+    report("find first set per bit", bytes, now_seconds() - start);
+    BENCH_BIT_KERNELS("find first set", bytes, check, bitset_find_first_set(&sparse, 0, kernel));
+
+    // Each toggle benchmark flips the bits twice, so the data is unchanged.
+    start = now_seconds();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 1; i < nbits - 1; i++)
+            bits.bytes[i / 8] ^= (unsigned char)(1 << (i % 8));
+    }
+    report("toggle per bit", bytes * 2, now_seconds() - start);
+    BENCH_BIT_KERNELS("toggle", bytes * 2, check, toggle_twice(&bits, kernel));
+
+    printf("  (check %llX)\n", check);
+
+    fclose(null_stream);
+    bitset_free(&bits);
+    bitset_free(&sparse);
+    free(text);
+}
+
+//----------------------------------------------------------------------------
+
+static const bench benches[] = {
+    {"hex", bench_hex},
+    {"bits", bench_bits},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t mb = BENCH_DEFAULT_MB;
+    int found = 0;
+
+    if (argc > 2)
+        mb = strtoul(argv[2], NULL, 10);
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (name == NULL || !strcmp(name, benches[i].name))
+        {
+            benches[i].run(mb);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include "bitset.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The POPCNT and AVX2 kernels use GCC/Clang target attributes so that they
+// can be compiled without -mpopcnt or -mavx2 and selected at runtime. They
+// work on 64-bit words, so they are only built for x86-64.
+// Other compilers and architectures only get the scalar kernel.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BIT_HAVE_X86_SIMD
+#include <immintrin.h>
+#define BIT_TARGET_POPCNT __attribute__((target("popcnt,bmi,bmi2")))
+#define BIT_TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi,bmi2")))
+#endif
+
+// The operations on whole bytes in the middle of a range.
+typedef enum bit_op
+{
+    BIT_OP_SET,
+    BIT_OP_CLEAR,
+    BIT_OP_TOGGLE,
+} bit_op;
+
+const char *bit_kernel_names[BIT_KERNEL_MAX] = {
+    "auto",
+    "scalar",
+    "popcnt",
+    "avx2"};
+
+// The text of every nibble, most significant bit first.
+static const char nibble_bits[16][4] = {
+    {'0', '0', '0', '0'}, {'0', '0', '0', '1'}, {'0', '0', '1', '0'}, {'0', '0', '1', '1'},
+    {'0', '1', '0', '0'}, {'0', '1', '0', '1'}, {'0', '1', '1', '0'}, {'0', '1', '1', '1'},
+    {'1', '0', '0', '0'}, {'1', '0', '0', '1'}, {'1', '0', '1', '0'}, {'1', '0', '1', '1'},
+    {'1', '1', '0', '0'}, {'1', '1', '0', '1'}, {'1', '1', '1', '0'}, {'1', '1', '1', '1'}};
+
+//----------------------------------------------------------------------------
+// scalar
+//
+// Whole 64-bit words are loaded with memcpy, which compiles to a single load
+// and doesn't care about alignment. Counting and testing bits of a word
+// doesn't depend on the byte order, but finding which bit is first does, so
+// that is done a byte at a time once a word with a set bit is found.
+
+static inline uint64_t load_word(const unsigned char *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline void store_word(unsigned char *p, uint64_t w)
+{
+    memcpy(p, &w, sizeof(w));
+}
+
+static inline size_t popcount64(uint64_t w)
+{
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (size_t)((w * 0x0101010101010101ULL) >> 56);
+}
+
+// The index of the lowest set bit of a byte that isn't 0.
+static inline size_t lowest_bit8(unsigned int b)
+{
+    size_t i = 0;
+    while (!(b & 1))
+    {
+        b >>= 1;
+        i++;
+    }
+    return i;
+}
+
+static size_t popcount_scalar(const unsigned char *bytes, size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        count += popcount64(load_word(bytes + i));
+    for (; i < n; i++)
+        count += popcount64(bytes[i]);
+
+    return count;
+}
+
+// Finds the first set bit in bytes i to n.
+static size_t find_set_scalar(const unsigned char *bytes, size_t i, size_t n)
+{
+    for (; i + 8 <= n; i += 8)
+    {
+        if (load_word(bytes + i) != 0)
+            break;
+    }
+    for (; i < n; i++)
+    {
+        if (bytes[i] != 0)
+            return i * 8 + lowest_bit8(bytes[i]);
+    }
+    return BITSET_NPOS;
+}
+
+static void toggle_scalar(unsigned char *bytes, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        store_word(bytes + i, ~load_word(bytes + i));
+    for (; i < n; i++)
+        bytes[i] = (unsigned char)~bytes[i];
+}
+
+static size_t render_scalar(const unsigned char *bytes, size_t n, char *dest)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        memcpy(dest + i * 8, nibble_bits[bytes[i] >> 4], 4);
+        memcpy(dest + i * 8 + 4, nibble_bits[bytes[i] & 0xF], 4);
+    }
+    return n * 8;
+}
+
+//----------------------------------------------------------------------------
+// POPCNT and AVX2
+//
+// x86 is little endian, so bit i of a word loaded from byte p is bit i % 8
+// of byte p + i / 8, and TZCNT gives the index of the first set bit
+// directly.
+//
+// To render a byte, PDEP moves each of its bits into the low bit of a
+// separate byte of a word. That puts the least significant bit first, so the
+// word is byte swapped before '0' is added to every byte.
+//
+// The AVX2 popcount looks up the count of every nibble with vpshufb and adds
+// them up with vpsadbw. AVX2 rendering broadcasts 4 bytes, shuffles each one
+// into 8 lanes and compares every lane with a mask of the bit it shows.
+
+#ifdef BIT_HAVE_X86_SIMD
+
+BIT_TARGET_POPCNT static size_t popcount_popcnt(const unsigned char *bytes, size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        count += (size_t)_mm_popcnt_u64(load_word(bytes + i));
+    for (; i < n; i++)
+        count += (size_t)_mm_popcnt_u32(bytes[i]);
+
+    return count;
+}
+
+BIT_TARGET_POPCNT static size_t find_set_popcnt(const unsigned char *bytes, size_t i, size_t n)
+{
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t w = load_word(bytes + i);
+        if (w != 0)
+            return i * 8 + (size_t)_tzcnt_u64(w);
+    }
+    for (; i < n; i++)
+    {
+        if (bytes[i] != 0)
+            return i * 8 + (size_t)_tzcnt_u32(bytes[i]);
+    }
+    return BITSET_NPOS;
+}
+
+BIT_TARGET_POPCNT static size_t render_popcnt(const unsigned char *bytes, size_t n, char *dest)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t w = __builtin_bswap64(_pdep_u64(bytes[i], 0x0101010101010101ULL)) | 0x3030303030303030ULL;
+        store_word((unsigned char *)dest + i * 8, w);
+    }
+    return n * 8;
+}
+
+BIT_TARGET_AVX2 static size_t popcount_avx2(const unsigned char *bytes, size_t n)
+{
+    __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+
+    return (size_t)(_mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+                    _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3)) +
+           popcount_popcnt(bytes + i, n - i);
+}
+
+BIT_TARGET_AVX2 static size_t find_set_avx2(const unsigned char *bytes, size_t i, size_t n)
+{
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        if (!_mm256_testz_si256(v, v))
+            break;
+    }
+    return find_set_popcnt(bytes, i, n);
+}
+
+BIT_TARGET_AVX2 static void toggle_avx2(unsigned char *bytes, size_t n)
+{
+    __m256i ones = _mm256_set1_epi8(-1);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        _mm256_storeu_si256((__m256i *)(bytes + i), _mm256_xor_si256(v, ones));
+    }
+    toggle_scalar(bytes + i, n - i);
+}
+
+BIT_TARGET_AVX2 static size_t render_avx2(const unsigned char *bytes, size_t n, char *dest)
+{
+    __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                      2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    __m256i masks = _mm256_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                     (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                     (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                     (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m256i zero = _mm256_set1_epi8('0');
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t w;
+        memcpy(&w, bytes + i, sizeof(w));
+
+        // Every 128-bit half has all 4 bytes, so vpshufb can reach them.
+        __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)w), spread);
+        __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, masks), masks);
+
+        // set is -1 in the lanes to show as '1'.
+        _mm256_storeu_si256((__m256i *)(dest + i * 8), _mm256_sub_epi8(zero, set));
+    }
+
+    return i * 8 + render_popcnt(bytes + i, n - i, dest + i * 8);
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+// Applies an operation to the whole bytes in the middle of a range.
+static void apply_bytes(unsigned char *bytes, size_t n, bit_op op, bit_kernel kernel)
+{
+    switch (op)
+    {
+    case BIT_OP_SET:   memset(bytes, 0xFF, n); return;
+    case BIT_OP_CLEAR: memset(bytes, 0, n); return;
+    default:           break;
+    }
+
+    switch (bit_select_kernel(kernel))
+    {
+#ifdef BIT_HAVE_X86_SIMD
+    case BIT_KERNEL_AVX2: toggle_avx2(bytes, n); return;
+#endif
+    default:              toggle_scalar(bytes, n); return;
+    }
+}
+
+static inline void apply_mask(unsigned char *byte, unsigned int mask, bit_op op)
+{
+    switch (op)
+    {
+    case BIT_OP_SET:   *byte = (unsigned char)(*byte | mask); break;
+    case BIT_OP_CLEAR: *byte = (unsigned char)(*byte & ~mask); break;
+    default:           *byte = (unsigned char)(*byte ^ mask); break;
+    }
+}
+
+// Applies an operation to a range of bits. The partial bytes at each end are
+// masked, and the whole bytes between them are done in bulk.
+static void apply_range(bitset *bs, size_t first, size_t count, bit_op op, bit_kernel kernel)
+{
+    size_t end;
+    size_t head;
+    size_t tail;
+
+    if (first >= bs->nbits || count == 0)
+        return;
+    if (count > bs->nbits - first)
+        count = bs->nbits - first;
+
+    end = first + count;
+    head = first / 8;
+    tail = end / 8;
+
+    if (head == tail)
+    {
+        apply_mask(bs->bytes + head, (0xFFu << (first % 8)) & ((1u << (end % 8)) - 1), op);
+        return;
+    }
+
+    apply_mask(bs->bytes + head, (0xFFu << (first % 8)) & 0xFF, op);
+    apply_bytes(bs->bytes + head + 1, tail - head - 1, op, kernel);
+    if (end % 8 != 0)
+        apply_mask(bs->bytes + tail, (1u << (end % 8)) - 1, op);
+}
+
+bit_kernel bit_select_kernel(bit_kernel kernel)
+{
+    if (kernel == BIT_KERNEL_AUTO || kernel >= BIT_KERNEL_MAX)
+        kernel = BIT_KERNEL_AVX2;
+
+#ifdef BIT_HAVE_X86_SIMD
+    if (__builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"))
+    {
+        if (kernel == BIT_KERNEL_AVX2 && __builtin_cpu_supports("avx2"))
+            return BIT_KERNEL_AVX2;
+        if (kernel >= BIT_KERNEL_POPCNT)
+            return BIT_KERNEL_POPCNT;
+    }
+#endif
+
+    return BIT_KERNEL_SCALAR;
+}
+
+int bitset_init(bitset *bs, size_t nbits)
+{
+    size_t nbytes = (nbits / 8 + BITSET_ALIGN) / BITSET_ALIGN * BITSET_ALIGN;
+
+    bs->bytes = (unsigned char *)calloc(nbytes, 1);
+    if (bs->bytes == NULL)
+    {
+        bs->nbits = 0;
+        bs->nbytes = 0;
+        return 1;
+    }
+
+    bs->nbits = nbits;
+    bs->nbytes = nbytes;
+    return 0;
+}
+
+void bitset_free(bitset *bs)
+{
+    free(bs->bytes);
+    bs->bytes = NULL;
+    bs->nbits = 0;
+    bs->nbytes = 0;
+}
+
+void bitset_set_range(bitset *bs, size_t first, size_t count)
+{
+    apply_range(bs, first, count, BIT_OP_SET, BIT_KERNEL_SCALAR);
+}
+
+void bitset_clear_range(bitset *bs, size_t first, size_t count)
+{
+    apply_range(bs, first, count, BIT_OP_CLEAR, BIT_KERNEL_SCALAR);
+}
+
+void bitset_toggle_range(bitset *bs, size_t first, size_t count, bit_kernel kernel)
+{
+    apply_range(bs, first, count, BIT_OP_TOGGLE, kernel);
+}
+
+size_t bitset_popcount(const bitset *bs, bit_kernel kernel)
+{
+    switch (bit_select_kernel(kernel))
+    {
+#ifdef BIT_HAVE_X86_SIMD
+    case BIT_KERNEL_AVX2:   return popcount_avx2(bs->bytes, bs->nbytes);
+    case BIT_KERNEL_POPCNT: return popcount_popcnt(bs->bytes, bs->nbytes);
+#endif
+    default:                return popcount_scalar(bs->bytes, bs->nbytes);
+    }
+}
+
+size_t bitset_find_first_set(const bitset *bs, size_t from, bit_kernel kernel)
+{
+    size_t byte;
+    unsigned int first;
+
+    if (from >= bs->nbits)
+        return BITSET_NPOS;
+
+    // The first byte is masked so that bits before from are skipped. The
+    // padding is always zero, so any bit found after it is inside the set.
+    byte = from / 8;
+    first = bs->bytes[byte] & (0xFFu << (from % 8));
+    if (first != 0)
+        return byte * 8 + lowest_bit8(first);
+
+    switch (bit_select_kernel(kernel))
+    {
+#ifdef BIT_HAVE_X86_SIMD
+    case BIT_KERNEL_AVX2:   return find_set_avx2(bs->bytes, byte + 1, bs->nbytes);
+    case BIT_KERNEL_POPCNT: return find_set_popcnt(bs->bytes, byte + 1, bs->nbytes);
+#endif
+    default:                return find_set_scalar(bs->bytes, byte + 1, bs->nbytes);
+    }
+}
+
+size_t bits_render(const unsigned char *bytes, size_t n, bit_kernel kernel, char *dest)
+{
+    switch (bit_select_kernel(kernel))
+    {
+#ifdef BIT_HAVE_X86_SIMD
+    case BIT_KERNEL_AVX2:   return render_avx2(bytes, n, dest);
+    case BIT_KERNEL_POPCNT: return render_popcnt(bytes, n, dest);
+#endif
+    default:                return render_scalar(bytes, n, dest);
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A fixed-size array of bits stored in bytes.
+//
+// Bit i is bit (i % CHAR_BIT) of byte (i / CHAR_BIT), counting from the
+// least significant bit the same way as the bitwise examples, so bit 0 of
+// byte 0 is the first bit of the set.
+//
+// The storage is padded with zero bytes to a multiple of BITSET_ALIGN so
+// that the kernels can work on whole 64-bit words and 32 byte vectors
+// without special cases at the end. The padding always stays zero.
+
+// The number of bytes the storage is padded to.
+#define BITSET_ALIGN 32
+
+// Returned by bitset_find_first_set when no bit is set.
+#define BITSET_NPOS ((size_t)-1)
+
+// The size of the buffer bits_render needs for n bytes.
+#define BITS_RENDER_SIZE(n) ((n) * 8)
+
+// The kernels available to the bulk operations.
+// BIT_KERNEL_AUTO picks the fastest one supported by the CPU.
+typedef enum bit_kernel
+{
+    BIT_KERNEL_AUTO = 0,
+    BIT_KERNEL_SCALAR, // portable 64-bit word operations
+    BIT_KERNEL_POPCNT, // the POPCNT, TZCNT and PDEP instructions
+    BIT_KERNEL_AVX2,   // 32 bytes at a time
+    BIT_KERNEL_MAX,
+} bit_kernel;
+
+typedef struct bitset
+{
+    unsigned char *bytes; // the bits, padded to a multiple of BITSET_ALIGN
+    size_t nbits;         // the number of bits in the set
+    size_t nbytes;        // the number of bytes of storage, including padding
+} bitset;
+
+extern const char *bit_kernel_names[BIT_KERNEL_MAX];
+
+/**
+ * Gets the kernel that would actually be used for a request.
+ * Kernels that the CPU does not support are replaced with the next best one.
+ *
+ * Params:
+ *   bit_kernel - the requested kernel
+ *
+ * Returns:
+ *   bit_kernel - the kernel that will be used
+ */
+bit_kernel bit_select_kernel(bit_kernel kernel);
+
+/**
+ * Creates a set of bits that are all clear.
+ *
+ * Params:
+ *   bitset* - the set to initialize
+ *   size_t - the number of bits
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int bitset_init(bitset *bs, size_t nbits);
+
+/**
+ * Releases the memory held by a set.
+ *
+ * Params:
+ *   bitset* - the set
+ */
+void bitset_free(bitset *bs);
+
+/**
+ * Gets a single bit.
+ *
+ * Params:
+ *   const bitset* - the set
+ *   size_t - the index of the bit, which must be less than nbits
+ *
+ * Returns:
+ *   int - 1 if the bit is set, 0 if it's clear
+ */
+static inline int bitset_test(const bitset *bs, size_t i)
+{
+    return (bs->bytes[i / 8] >> (i % 8)) & 1;
+}
+
+/**
+ * Sets every bit in a range. The parts of the range past the end of the set
+ * are ignored.
+ *
+ * Params:
+ *   bitset* - the set
+ *   size_t - the index of the first bit
+ *   size_t - the number of bits
+ */
+void bitset_set_range(bitset *bs, size_t first, size_t count);
+
+/**
+ * Clears every bit in a range. The parts of the range past the end of the
+ * set are ignored.
+ *
+ * Params:
+ *   bitset* - the set
+ *   size_t - the index of the first bit
+ *   size_t - the number of bits
+ */
+void bitset_clear_range(bitset *bs, size_t first, size_t count);
+
+/**
+ * Flips every bit in a range. The parts of the range past the end of the set
+ * are ignored.
+ *
+ * Params:
+ *   bitset* - the set
+ *   size_t - the index of the first bit
+ *   size_t - the number of bits
+ *   bit_kernel - the kernel to use
+ */
+void bitset_toggle_range(bitset *bs, size_t first, size_t count, bit_kernel kernel);
+
+/**
+ * Counts the bits that are set.
+ *
+ * Params:
+ *   const bitset* - the set
+ *   bit_kernel - the kernel to use
+ *
+ * Returns:
+ *   size_t - the number of set bits
+ */
+size_t bitset_popcount(const bitset *bs, bit_kernel kernel);
+
+/**
+ * Finds the first set bit at or after an index.
+ *
+ * Params:
+ *   const bitset* - the set
+ *   size_t - the index to start from
+ *   bit_kernel - the kernel to use
+ *
+ * Returns:
+ *   size_t - the index of the bit, or BITSET_NPOS if there isn't one
+ */
+size_t bitset_find_first_set(const bitset *bs, size_t from, bit_kernel kernel);
+
+/**
+ * Writes bytes as strings of '0' and '1', with the most significant bit of
+ * each byte first, the same way as print_bits. No NUL terminator is written.
+ *
+ * Params:
+ *   const unsigned char* - the bytes, like the bytes of a bitset
+ *   size_t - the number of bytes
+ *   bit_kernel - the kernel to use
+ *   char* - a buffer of at least BITS_RENDER_SIZE(n) chars
+ *
+ * Returns:
+ *   size_t - the number of chars written
+ */
+size_t bits_render(const unsigned char *bytes, size_t n, bit_kernel kernel, char *dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
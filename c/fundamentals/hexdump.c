@@ -0,0 +1,451 @@
+#include "hexdump.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The vectorized kernels use GCC/Clang target attributes so that they can be
+// compiled without -mssse3 or -mavx2 and selected at runtime.
+// Other compilers and architectures only get the scalar kernel.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEX_HAVE_X86_SIMD
+#include <immintrin.h>
+#define HEX_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define HEX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// The number of bytes read at a time by hex_dump_stream.
+#define HEX_STREAM_BLOCK_SIZE (64 * 1024)
+
+// Where each part of an xxd style line starts, after an offset of w digits.
+#define HEX_LINE_HEX(w) ((w) + 2)
+#define HEX_LINE_ASCII(w) ((w) + 43)
+#define HEX_LINE_SIZE(w) ((w) + 60)
+
+const char *hex_kernel_names[HEX_KERNEL_MAX] = {
+    "auto",
+    "scalar",
+    "ssse3",
+    "avx2"};
+
+// The digits for HEX_LOWERCASE and HEX_UPPERCASE, as 16 bytes that can be
+// loaded into a vector register.
+static const char hex_digits[2][16] = {
+    {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'},
+    {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'}};
+
+// Describes where the 32 hex digits of 16 bytes go in 48 chars of output.
+// The digits are split across two vectors, the first 16 and the last 16.
+// Each output vector k is built by shuffling both of them with lo[k] and
+// hi[k], where 0x80 picks nothing, then adding fill[k] for the spaces.
+typedef struct hex_layout
+{
+    unsigned char lo[3][16];
+    unsigned char hi[3][16];
+    unsigned char fill[3][16];
+} hex_layout;
+
+// "0F " for every byte.
+static const hex_layout bytes_layout = {
+    {{0x00, 0x01, 0x80, 0x02, 0x03, 0x80, 0x04, 0x05, 0x80, 0x06, 0x07, 0x80, 0x08, 0x09, 0x80, 0x0A},
+     {0x0B, 0x80, 0x0C, 0x0D, 0x80, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}},
+    {{0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0x01, 0x80, 0x02, 0x03, 0x80, 0x04, 0x05},
+     {0x80, 0x06, 0x07, 0x80, 0x08, 0x09, 0x80, 0x0A, 0x0B, 0x80, 0x0C, 0x0D, 0x80, 0x0E, 0x0F, 0x80}},
+    {{0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0},
+     {0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0},
+     {' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' '}}};
+
+// "0f0e " for every pair of bytes, then spaces up to the ASCII column.
+// The last 7 chars are overwritten by the ASCII column.
+static const hex_layout xxd_layout = {
+    {{0x00, 0x01, 0x02, 0x03, 0x80, 0x04, 0x05, 0x06, 0x07, 0x80, 0x08, 0x09, 0x0A, 0x0B, 0x80, 0x0C},
+     {0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}},
+    {{0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x00, 0x01, 0x02, 0x03, 0x80, 0x04, 0x05, 0x06, 0x07, 0x80, 0x08, 0x09},
+     {0x0A, 0x0B, 0x80, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}},
+    {{0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0},
+     {0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0},
+     {0, 0, ' ', 0, 0, 0, 0, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '}}};
+
+//----------------------------------------------------------------------------
+// scalar
+
+static inline char ascii_char(unsigned char c)
+{
+    return c >= 0x20 && c < 0x7F ? (char)c : '.';
+}
+
+// Gets the number of digits xxd shows for an offset: at least 8, and more
+// only when the offset needs them.
+static int offset_width(unsigned long long offset)
+{
+    int width = 8;
+    while (width < 16 && (offset >> (4 * width)) != 0)
+        width++;
+    return width;
+}
+
+// Writes the offset and separator at the start of a line.
+static inline void write_offset(char *dest, unsigned long long offset, int width, const char *digits)
+{
+    for (int i = width - 1; i >= 0; i--)
+    {
+        dest[i] = digits[offset & 0xF];
+        offset >>= 4;
+    }
+    dest[width] = ':';
+    dest[width + 1] = ' ';
+}
+
+static size_t hex_bytes_scalar(const unsigned char *src, size_t n, const char *digits, char *dest)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dest[i * 3] = digits[src[i] >> 4];
+        dest[i * 3 + 1] = digits[src[i] & 0xF];
+        dest[i * 3 + 2] = ' ';
+    }
+    return n * 3;
+}
+
+// Writes one line of up to 16 bytes.
+static size_t dump_line_scalar(const unsigned char *src, size_t len, unsigned long long offset, int width,
+                               const char *digits, char *dest)
+{
+    char *hex = dest + HEX_LINE_HEX(width);
+    char *ascii = dest + HEX_LINE_ASCII(width);
+
+    write_offset(dest, offset, width, digits);
+
+    // Missing bytes are filled with spaces so that the ASCII column lines up.
+    memset(hex, ' ', HEX_LINE_ASCII(width) - HEX_LINE_HEX(width));
+    for (size_t i = 0; i < len; i++)
+    {
+        char *p = hex + (i / 2) * 5 + (i % 2) * 2;
+        p[0] = digits[src[i] >> 4];
+        p[1] = digits[src[i] & 0xF];
+        ascii[i] = ascii_char(src[i]);
+    }
+
+    ascii[len] = '\n';
+    return (size_t)(ascii + len + 1 - dest);
+}
+
+//----------------------------------------------------------------------------
+// SSSE3 and AVX2
+//
+// Each byte is split into its two nibbles, and each nibble is turned into a
+// digit by using it as an index into the 16 digits with pshufb. Interleaving
+// the high and low digits gives the 32 digits of 16 bytes in order, which
+// the layout tables then spread out and fill in with spaces.
+//
+// AVX2 shuffles only within each 128-bit half, so it works on two groups of
+// 16 bytes side by side, which are two lines of an xxd style dump.
+
+#ifdef HEX_HAVE_X86_SIMD
+
+HEX_TARGET_SSSE3 static inline void hex_digits_ssse3(__m128i v, __m128i lut, __m128i *first, __m128i *last)
+{
+    __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, nibble));
+    *first = _mm_unpacklo_epi8(hi, lo);
+    *last = _mm_unpackhi_epi8(hi, lo);
+}
+
+HEX_TARGET_SSSE3 static inline __m128i spread_ssse3(__m128i first, __m128i last, const hex_layout *layout, int k)
+{
+    __m128i a = _mm_shuffle_epi8(first, _mm_loadu_si128((const __m128i *)layout->lo[k]));
+    __m128i b = _mm_shuffle_epi8(last, _mm_loadu_si128((const __m128i *)layout->hi[k]));
+    return _mm_or_si128(_mm_or_si128(a, b), _mm_loadu_si128((const __m128i *)layout->fill[k]));
+}
+
+HEX_TARGET_SSSE3 static inline __m128i ascii_ssse3(__m128i v)
+{
+    // Bytes of 0x80 and up are negative as signed chars, so they fail the
+    // first comparison.
+    __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+                                      _mm_cmplt_epi8(v, _mm_set1_epi8(0x7F)));
+    return _mm_or_si128(_mm_and_si128(printable, v), _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+}
+
+HEX_TARGET_SSSE3 static size_t hex_bytes_ssse3(const unsigned char *src, size_t n, const char *digits, char *dest)
+{
+    __m128i lut = _mm_loadu_si128((const __m128i *)digits);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i first;
+        __m128i last;
+        char *p = dest + i * 3;
+
+        hex_digits_ssse3(_mm_loadu_si128((const __m128i *)(src + i)), lut, &first, &last);
+        _mm_storeu_si128((__m128i *)p, spread_ssse3(first, last, &bytes_layout, 0));
+        _mm_storeu_si128((__m128i *)(p + 16), spread_ssse3(first, last, &bytes_layout, 1));
+        _mm_storeu_si128((__m128i *)(p + 32), spread_ssse3(first, last, &bytes_layout, 2));
+    }
+
+    return i * 3 + hex_bytes_scalar(src + i, n - i, digits, dest + i * 3);
+}
+
+// Writes one full line of 16 bytes.
+HEX_TARGET_SSSE3 static inline size_t dump_line_ssse3(const unsigned char *src, unsigned long long offset, int width,
+                                                      const char *digits, char *dest)
+{
+    __m128i lut = _mm_loadu_si128((const __m128i *)digits);
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+    __m128i first;
+    __m128i last;
+    char *hex = dest + HEX_LINE_HEX(width);
+
+    write_offset(dest, offset, width, digits);
+
+    hex_digits_ssse3(v, lut, &first, &last);
+    _mm_storeu_si128((__m128i *)hex, spread_ssse3(first, last, &xxd_layout, 0));
+    _mm_storeu_si128((__m128i *)(hex + 16), spread_ssse3(first, last, &xxd_layout, 1));
+    _mm_storeu_si128((__m128i *)(hex + 32), spread_ssse3(first, last, &xxd_layout, 2));
+
+    _mm_storeu_si128((__m128i *)(dest + HEX_LINE_ASCII(width)), ascii_ssse3(v));
+    dest[HEX_LINE_SIZE(width) - 1] = '\n';
+    return HEX_LINE_SIZE(width);
+}
+
+HEX_TARGET_SSSE3 static size_t hex_dump_ssse3(const unsigned char *src, size_t n, unsigned long long offset, int width,
+                                              const char *digits, char *dest)
+{
+    size_t pos = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+        pos += dump_line_ssse3(src + i, offset + i, width, digits, dest + pos);
+
+    if (i < n)
+        pos += dump_line_scalar(src + i, n - i, offset + i, width, digits, dest + pos);
+
+    return pos;
+}
+
+HEX_TARGET_AVX2 static inline void hex_digits_avx2(__m256i v, __m256i lut, __m256i *first, __m256i *last)
+{
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble));
+    *first = _mm256_unpacklo_epi8(hi, lo);
+    *last = _mm256_unpackhi_epi8(hi, lo);
+}
+
+HEX_TARGET_AVX2 static inline __m256i spread_avx2(__m256i first, __m256i last, const hex_layout *layout, int k)
+{
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)layout->lo[k]));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)layout->hi[k]));
+    __m256i fill = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)layout->fill[k]));
+    __m256i a = _mm256_shuffle_epi8(first, lo);
+    __m256i b = _mm256_shuffle_epi8(last, hi);
+    return _mm256_or_si256(_mm256_or_si256(a, b), fill);
+}
+
+HEX_TARGET_AVX2 static inline __m256i ascii_avx2(__m256i v)
+{
+    __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(0x1F)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7F), v));
+    return _mm256_blendv_epi8(_mm256_set1_epi8('.'), v, printable);
+}
+
+HEX_TARGET_AVX2 static size_t hex_bytes_avx2(const unsigned char *src, size_t n, const char *digits, char *dest)
+{
+    __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)digits));
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i first;
+        __m256i last;
+        __m256i out0;
+        __m256i out1;
+        __m256i out2;
+        char *p = dest + i * 3;
+
+        hex_digits_avx2(_mm256_loadu_si256((const __m256i *)(src + i)), lut, &first, &last);
+        out0 = spread_avx2(first, last, &bytes_layout, 0);
+        out1 = spread_avx2(first, last, &bytes_layout, 1);
+        out2 = spread_avx2(first, last, &bytes_layout, 2);
+
+        // The low halves hold the text of the first 16 bytes and the high
+        // halves the text of the next 16, so they're regrouped into three
+        // contiguous 32 byte stores.
+        _mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(out0, out1, 0x20));
+        _mm256_storeu_si256((__m256i *)(p + 32), _mm256_permute2x128_si256(out2, out0, 0x30));
+        _mm256_storeu_si256((__m256i *)(p + 64), _mm256_permute2x128_si256(out1, out2, 0x31));
+    }
+
+    return i * 3 + hex_bytes_ssse3(src + i, n - i, digits, dest + i * 3);
+}
+
+HEX_TARGET_AVX2 static size_t hex_dump_avx2(const unsigned char *src, size_t n, unsigned long long offset, int width,
+                                            const char *digits, char *dest)
+{
+    __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)digits));
+    size_t line = HEX_LINE_SIZE(width);
+    size_t pos = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i first;
+        __m256i last;
+        __m256i out;
+        __m256i ascii;
+        char *p0 = dest + pos;
+        char *p1 = p0 + line;
+
+        write_offset(p0, offset + i, width, digits);
+        write_offset(p1, offset + i + 16, width, digits);
+
+        hex_digits_avx2(v, lut, &first, &last);
+        for (int k = 0; k < 3; k++)
+        {
+            out = spread_avx2(first, last, &xxd_layout, k);
+            _mm_storeu_si128((__m128i *)(p0 + HEX_LINE_HEX(width) + k * 16), _mm256_castsi256_si128(out));
+            _mm_storeu_si128((__m128i *)(p1 + HEX_LINE_HEX(width) + k * 16), _mm256_extracti128_si256(out, 1));
+        }
+
+        ascii = ascii_avx2(v);
+        _mm_storeu_si128((__m128i *)(p0 + HEX_LINE_ASCII(width)), _mm256_castsi256_si128(ascii));
+        _mm_storeu_si128((__m128i *)(p1 + HEX_LINE_ASCII(width)), _mm256_extracti128_si256(ascii, 1));
+        p0[line - 1] = '\n';
+        p1[line - 1] = '\n';
+
+        pos += line * 2;
+    }
+
+    return pos + hex_dump_ssse3(src + i, n - i, offset + i, width, digits, dest + pos);
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+hex_kernel hex_select_kernel(hex_kernel kernel)
+{
+    if (kernel == HEX_KERNEL_AUTO || kernel >= HEX_KERNEL_MAX)
+        kernel = HEX_KERNEL_AVX2;
+
+#ifdef HEX_HAVE_X86_SIMD
+    if (kernel == HEX_KERNEL_AVX2 && __builtin_cpu_supports("avx2"))
+        return HEX_KERNEL_AVX2;
+    if (kernel >= HEX_KERNEL_SSSE3 && __builtin_cpu_supports("ssse3"))
+        return HEX_KERNEL_SSSE3;
+#endif
+
+    return HEX_KERNEL_SCALAR;
+}
+
+size_t hex_bytes(const unsigned char *src, size_t n, int flags, hex_kernel kernel, char *dest)
+{
+    const char *digits = hex_digits[flags & HEX_UPPERCASE];
+
+    switch (hex_select_kernel(kernel))
+    {
+#ifdef HEX_HAVE_X86_SIMD
+    case HEX_KERNEL_AVX2:  return hex_bytes_avx2(src, n, digits, dest);
+    case HEX_KERNEL_SSSE3: return hex_bytes_ssse3(src, n, digits, dest);
+#endif
+    default:               return hex_bytes_scalar(src, n, digits, dest);
+    }
+}
+
+size_t hex_dump(const unsigned char *src, size_t n, unsigned long long offset, int flags, hex_kernel kernel,
+                char *dest)
+{
+    const char *digits = hex_digits[flags & HEX_UPPERCASE];
+    hex_kernel selected = hex_select_kernel(kernel);
+    size_t pos = 0;
+
+    // Like xxd's "%08lx", each offset has at least 8 digits and grows one
+    // digit at a time. The kernels take one width for all their lines, so
+    // the lines are split into runs whose offsets all have the same width.
+    while (n > 0)
+    {
+        int width = offset_width(offset);
+        size_t len = n;
+
+        if (width < 16)
+        {
+            // Only the lines that start before the offset needs another
+            // digit have this width.
+            unsigned long long room = (1ULL << (4 * width)) - offset;
+            unsigned long long lines = (room + HEX_DUMP_BYTES_PER_LINE - 1) / HEX_DUMP_BYTES_PER_LINE;
+            if (lines * HEX_DUMP_BYTES_PER_LINE < n)
+                len = (size_t)(lines * HEX_DUMP_BYTES_PER_LINE);
+        }
+
+        switch (selected)
+        {
+#ifdef HEX_HAVE_X86_SIMD
+        case HEX_KERNEL_AVX2:  pos += hex_dump_avx2(src, len, offset, width, digits, dest + pos); break;
+        case HEX_KERNEL_SSSE3: pos += hex_dump_ssse3(src, len, offset, width, digits, dest + pos); break;
+#endif
+        default:
+            for (size_t i = 0; i < len; i += HEX_DUMP_BYTES_PER_LINE)
+            {
+                size_t line = len - i < HEX_DUMP_BYTES_PER_LINE ? len - i : HEX_DUMP_BYTES_PER_LINE;
+                pos += dump_line_scalar(src + i, line, offset + i, width, digits, dest + pos);
+            }
+            break;
+        }
+
+        src += len;
+        offset += len;
+        n -= len;
+    }
+
+    return pos;
+}
+
+int hex_dump_stream(FILE *in, FILE *out, int flags, hex_kernel kernel)
+{
+    unsigned char *block = (unsigned char *)malloc(HEX_STREAM_BLOCK_SIZE);
+    char *text = (char *)malloc(HEX_DUMP_SIZE(HEX_STREAM_BLOCK_SIZE));
+    unsigned long long offset = 0;
+    int res = 0;
+
+    if (block == NULL || text == NULL)
+    {
+        free(block);
+        free(text);
+        return 1;
+    }
+
+    // Every block but the last is a whole number of lines, so the lines
+    // don't depend on where the blocks split.
+    for (;;)
+    {
+        size_t n = fread(block, 1, HEX_STREAM_BLOCK_SIZE, in);
+        size_t len;
+
+        if (n == 0)
+            break;
+
+        len = hex_dump(block, n, offset, flags, kernel, text);
+        if (fwrite(text, 1, len, out) != len)
+        {
+            res = 1;
+            break;
+        }
+
+        offset += n;
+        if (n < HEX_STREAM_BLOCK_SIZE)
+            break;
+    }
+
+    if (ferror(in))
+        res = 1;
+
+    free(block);
+    free(text);
+    return res;
+}
@@ -0,0 +1,119 @@
+#ifndef HEXDUMP_H
+#define HEXDUMP_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Formats bytes as text in large batches instead of calling printf once per
+// byte.
+//
+// This header can also be included from C++, and hexdump.c can be compiled
+// as C++, which is how the C++ fundamentals example uses it.
+//
+// hex_bytes writes each byte as two hex digits and a space, like "0F ".
+// hex_dump writes lines in the style of xxd:
+//   00000000: 0001 0203 0405 0607 0809 0a0b 0c0d 0e0f  ................
+
+// The number of bytes shown on each line of hex_dump.
+#define HEX_DUMP_BYTES_PER_LINE 16
+
+// The longest line written by hex_dump. Offsets have 8 digits, or as many
+// as they need past 4 GB, like xxd, so the longest line has 16.
+#define HEX_DUMP_MAX_LINE_SIZE 76
+
+// The size of the buffer hex_bytes needs for n bytes.
+#define HEX_BYTES_SIZE(n) ((n) * 3)
+
+// The size of the buffer hex_dump needs for n bytes.
+#define HEX_DUMP_SIZE(n) (((n) + HEX_DUMP_BYTES_PER_LINE - 1) / HEX_DUMP_BYTES_PER_LINE * HEX_DUMP_MAX_LINE_SIZE)
+
+// Flags for hex_bytes and hex_dump.
+#define HEX_LOWERCASE 0 // write a-f, like xxd
+#define HEX_UPPERCASE 1 // write A-F, like printf with "%X"
+
+// The conversion kernels available to hex_bytes and hex_dump.
+// HEX_KERNEL_AUTO picks the fastest one supported by the CPU.
+typedef enum hex_kernel
+{
+    HEX_KERNEL_AUTO = 0,
+    HEX_KERNEL_SCALAR,
+    HEX_KERNEL_SSSE3, // 16 bytes at a time
+    HEX_KERNEL_AVX2,  // 32 bytes at a time
+    HEX_KERNEL_MAX,
+} hex_kernel;
+
+extern const char *hex_kernel_names[HEX_KERNEL_MAX];
+
+/**
+ * Gets the kernel that would actually be used for a request.
+ * Kernels that the CPU does not support are replaced with the next best one.
+ *
+ * Params:
+ *   hex_kernel - the requested kernel
+ *
+ * Returns:
+ *   hex_kernel - the kernel that will be used
+ */
+hex_kernel hex_select_kernel(hex_kernel kernel);
+
+/**
+ * Writes each byte as two hex digits followed by a space.
+ * No NUL terminator is written.
+ *
+ * Params:
+ *   const unsigned char* - the bytes
+ *   size_t - the number of bytes
+ *   int - HEX_LOWERCASE or HEX_UPPERCASE
+ *   hex_kernel - the conversion kernel to use
+ *   char* - a buffer of at least HEX_BYTES_SIZE(n) chars
+ *
+ * Returns:
+ *   size_t - the number of chars written
+ */
+size_t hex_bytes(const unsigned char *src, size_t n, int flags, hex_kernel kernel, char *dest);
+
+/**
+ * Writes lines in the style of xxd, each with the offset of its first byte,
+ * up to 16 bytes in pairs, and the bytes as ASCII with anything that isn't
+ * printable shown as '.'. Every line ends with a newline, and no NUL
+ * terminator is written.
+ *
+ * Params:
+ *   const unsigned char* - the bytes
+ *   size_t - the number of bytes
+ *   unsigned long long - the offset shown for the first byte
+ *   int - HEX_LOWERCASE or HEX_UPPERCASE
+ *   hex_kernel - the conversion kernel to use
+ *   char* - a buffer of at least HEX_DUMP_SIZE(n) chars
+ *
+ * Returns:
+ *   size_t - the number of chars written
+ */
+size_t hex_dump(const unsigned char *src, size_t n, unsigned long long offset, int flags, hex_kernel kernel,
+                char *dest);
+
+/**
+ * Writes an xxd style dump of everything left in a stream.
+ * The input is read and formatted in large blocks, and each block is
+ * written with a single fwrite.
+ *
+ * Params:
+ *   FILE* - the stream to dump
+ *   FILE* - the stream that receives the text
+ *   int - HEX_LOWERCASE or HEX_UPPERCASE
+ *   hex_kernel - the conversion kernel to use
+ *
+ * Returns:
+ *   int - 0 on success, 1 on a read or write error or a failed allocation
+ */
+int hex_dump_stream(FILE *in, FILE *out, int flags, hex_kernel kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,2 +1,7 @@
+SRC = bitset.c hexdump.c
+
 all:
-	gcc -Wall -Werror main.c -o fundamentals.out
+	gcc -Wall -Werror main.c $(SRC) -o fundamentals.out
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.out
@@ -1,2 +1,7 @@
+SRC = bitset.c hexdump.c
+
 all:
-	clang -Wall -Werror main.c -o fundamentals.out
+	clang -Wall -Werror main.c $(SRC) -o fundamentals.out
+
+bench:
+	clang -Wall -Werror -O2 bench.c $(SRC) -o bench.out
@@ -12,6 +12,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
+
+#include "bitset.h"
+#include "hexdump.h"
 
 #define EXAMPLE_BUFFER_SIZE 16
 
@@ -29,11 +33,20 @@ typedef struct my_object
     my_callback callback; // function with typedef
 } my_object;
 
+// The number of bytes print_array converts before each write.
+#define PRINT_ARRAY_CHUNK 256
+
 void print_array(const my_byte *a, size_t s)
 {
-    for (size_t i = 0; i < s; i++)
+    // Calling printf("%X ", a[i]) for every byte is slow for large arrays,
+    // so the bytes are converted to text in chunks by hex_bytes and each
+    // chunk is written at once. hex_bytes always writes two digits, so a
+    // byte that "%X" printed as "F" is printed as "0F".
+    char text[HEX_BYTES_SIZE(PRINT_ARRAY_CHUNK)];
+    for (size_t i = 0; i < s; i += PRINT_ARRAY_CHUNK)
     {
-        printf("%X ", a[i]);
+        size_t n = s - i < PRINT_ARRAY_CHUNK ? s - i : PRINT_ARRAY_CHUNK;
+        fwrite(text, 1, hex_bytes(a + i, n, HEX_UPPERCASE, HEX_KERNEL_AUTO, text), stdout);
     }
     printf("\n");
 }
@@ -60,11 +73,11 @@ void greet()
 
 void print_bits(my_byte b)
 {
-    for (int i = 0; i < CHAR_BIT; i++)
-    {
-        putc((b & (1 << (CHAR_BIT - i - 1))) ? '1' : '0', stdout);
-    }
-    putc('\n', stdout);
+    // bits_render writes all the bits at once instead of calling putc for
+    // each one.
+    char text[BITS_RENDER_SIZE(1) + 1];
+    text[bits_render(&b, 1, BIT_KERNEL_AUTO, text)] = '\n';
+    fwrite(text, 1, sizeof(text), stdout);
 }
 
 int main()
@@ -174,6 +187,15 @@ int main()
     obj.hello();
     printf("callback result from within a struct: %d\n", obj.callback(2, 3));
 
+    //------------------------------------------------------------------------
+    // hex dumps
+
+    // Any memory can be viewed as bytes, which is what tools like xxd show.
+    const char *message = "Bytes are bytes, whether they're text or not.";
+    char dump[HEX_DUMP_SIZE(64)];
+    size_t dump_len = hex_dump((const my_byte *)message, strlen(message) + 1, 0, HEX_LOWERCASE, HEX_KERNEL_AUTO, dump);
+    fwrite(dump, 1, dump_len, stdout);
+
     //------------------------------------------------------------------------
     // bitwise operations
 
@@ -213,5 +235,29 @@ int main()
     bit_demo ^= ~(bit_demo);
     print_bits(bit_demo);
 
+    // The same operations work on arrays of any number of bits by working on
+    // whole words and vectors of bytes at a time. Bit i is bit (i % 8) of
+    // byte (i / 8).
+    bitset bits;
+    if (bitset_init(&bits, 100))
+    {
+        fprintf(stderr, "failed to allocate bits\n");
+        return 1;
+    }
+
+    // set bits [20:3], then toggle bits [40:12]
+    bitset_set_range(&bits, 3, 18);
+    bitset_toggle_range(&bits, 12, 29, BIT_KERNEL_AUTO);
+
+    // clear bit 5
+    bitset_clear_range(&bits, 5, 1);
+
+    char bit_text[BITS_RENDER_SIZE(13)];
+    fwrite(bit_text, 1, bits_render(bits.bytes, 13, BIT_KERNEL_AUTO, bit_text), stdout);
+    printf("\n%zu bits set, first set bit after bit 11 is %zu\n", bitset_popcount(&bits, BIT_KERNEL_AUTO),
+           bitset_find_first_set(&bits, 12, BIT_KERNEL_AUTO));
+
+    bitset_free(&bits);
+
     return 0;
 }
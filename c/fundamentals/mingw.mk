@@ -1,2 +1,7 @@
+SRC = bitset.c hexdump.c
+
 all:
-	gcc -Wall -Werror main.c -o fundamentals.exe
+	gcc -Wall -Werror main.c $(SRC) -o fundamentals.exe
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.exe
@@ -1,2 +1,7 @@
+SRC = bitset.c hexdump.c
+
 all:
-	cl /W3 /WX main.c /Fe"fundamentals.exe"
+	cl /W3 /WX main.c $(SRC) /Fe"fundamentals.exe"
+
+bench:
+	cl /W3 /WX /O2 bench.c $(SRC) /Fe"bench.exe"
@@ -0,0 +1,423 @@
+// Benchmarks for the string conversion examples.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// Each benchmark converts count values of each type, or count rows for the
+// columns benchmark.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "column.h"
+#include "convert.h"
+#include "format.h"
+
+#define BENCH_DEFAULT_COUNT 1000000
+
+// The longest string generated for a value, including the terminator.
+#define BENCH_STR_SIZE 32
+
+typedef void (*bench_fn)(size_t);
+
+typedef struct bench
+{
+    const char *name;
+    bench_fn run;
+} bench;
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double now_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+/**
+ * Fills a pool with one string per value that fits in the given type.
+ *
+ * Params:
+ *   my_type - the type that every value must fit in
+ *   char* - a pool with room for count strings of BENCH_STR_SIZE
+ *   const char** - receives a pointer to each string
+ *   size_t - the number of strings
+ */
+static void make_strings(my_type type, char *pool, const char **strs, size_t count)
+{
+    // The largest magnitude generated for each type, which keeps every value
+    // in range on every platform.
+    static const long long limits[MY_TYPE_MAX] = {
+        127, 255, 32767, 65535,
+        1000000000, 1000000000, 1000000000, 1000000000,
+        1000000000000000000LL, 1000000000000000000LL,
+        100000, 100000, 100000};
+
+    int is_signed = type == MY_TYPE_CHAR || type == MY_TYPE_SHORT || type == MY_TYPE_INT ||
+                    type == MY_TYPE_LONG || type == MY_TYPE_LONG_LONG || type >= MY_TYPE_FLOAT;
+    unsigned long long seed = 24601;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        char *str = pool + i * BENCH_STR_SIZE;
+        long long v;
+
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        v = (long long)((seed >> 11) % (unsigned long long)limits[type]);
+        if (is_signed && (seed & 0x400))
+            v = -v;
+
+        if (type >= MY_TYPE_FLOAT)
+            snprintf(str, BENCH_STR_SIZE, "%lld.%03d", v, (int)(seed >> 40) % 1000);
+        else
+            snprintf(str, BENCH_STR_SIZE, "%lld", v);
+
+        strs[i] = str;
+    }
+}
+
+//----------------------------------------------------------------------------
+// convert: str_to_primitive per value versus str_to_primitive_batch
+
+static void bench_convert(size_t count)
+{
+    char *pool = malloc(count * BENCH_STR_SIZE);
+    const char **strs = malloc(count * sizeof(char *));
+    unsigned char *single = malloc(count * sizeof(long double));
+    unsigned char *batch = malloc(count * sizeof(long double));
+
+    if (pool == NULL || strs == NULL || single == NULL || batch == NULL)
+    {
+        fprintf(stderr, "failed to allocate %zu values\n", count);
+        free(pool);
+        free(strs);
+        free(single);
+        free(batch);
+        return;
+    }
+
+    printf("convert: %zu strings per type\n", count);
+    printf("  %-20s %16s %16s %8s\n", "type", "single (ns/val)", "batch (ns/val)", "speedup");
+
+    for (int t = 0; t < MY_TYPE_MAX; t++)
+    {
+        size_t size = my_type_sizes[t];
+        double single_time;
+        double batch_time;
+        double start;
+
+        make_strings((my_type)t, pool, strs, count);
+        memset(single, 0, count * size);
+        memset(batch, 0, count * size);
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            str_to_primitive(strs[i], (my_type)t, single + i * size);
+        single_time = now_seconds() - start;
+
+        start = now_seconds();
+        str_to_primitive_batch(strs, count, (my_type)t, batch);
+        batch_time = now_seconds() - start;
+
+        printf("  %-20s %16.2f %16.2f %7.1fx%s\n",
+               my_type_names[t],
+               single_time * 1e9 / (double)count,
+               batch_time * 1e9 / (double)count,
+               single_time / batch_time,
+               memcmp(single, batch, count * size) ? "  (results differ)" : "");
+    }
+
+    free(pool);
+    free(strs);
+    free(single);
+    free(batch);
+}
+
+//----------------------------------------------------------------------------
+// format: snprintf versus format_primitive and format_primitive_batch
+
+// The way primitive_to_str converted values before format_primitive existed.
+static int snprintf_primitive(const void *value, my_type type, const char *float_fmt, char *buffer, size_t s)
+{
+    switch (type)
+    {
+    case MY_TYPE_CHAR:               return snprintf(buffer, s, "%c",   *(const char *)value);
+    case MY_TYPE_UNSIGNED_CHAR:      return snprintf(buffer, s, "%c",   *(const unsigned char *)value);
+    case MY_TYPE_SHORT:              return snprintf(buffer, s, "%hd",  *(const short *)value);
+    case MY_TYPE_UNSIGNED_SHORT:     return snprintf(buffer, s, "%hu",  *(const unsigned short *)value);
+    case MY_TYPE_INT:                return snprintf(buffer, s, "%d",   *(const int *)value);
+    case MY_TYPE_UNSIGNED_INT:       return snprintf(buffer, s, "%u",   *(const unsigned int *)value);
+    case MY_TYPE_LONG:               return snprintf(buffer, s, "%ld",  *(const long *)value);
+    case MY_TYPE_UNSIGNED_LONG:      return snprintf(buffer, s, "%lu",  *(const unsigned long *)value);
+    case MY_TYPE_LONG_LONG:          return snprintf(buffer, s, "%lld", *(const long long *)value);
+    case MY_TYPE_UNSIGNED_LONG_LONG: return snprintf(buffer, s, "%llu", *(const unsigned long long *)value);
+    case MY_TYPE_FLOAT:              return snprintf(buffer, s, float_fmt, *(const float *)value);
+    case MY_TYPE_DOUBLE:             return snprintf(buffer, s, float_fmt, *(const double *)value);
+    case MY_TYPE_LONG_DOUBLE:        return snprintf(buffer, s, "%.21Lg",  *(const long double *)value);
+    default:                         return -1;
+    }
+}
+
+static void bench_format(size_t count)
+{
+    char *pool = malloc(count * BENCH_STR_SIZE);
+    const char **strs = malloc(count * sizeof(char *));
+    unsigned char *values = malloc(count * sizeof(long double));
+    char *out = malloc(count * BENCH_STR_SIZE);
+    char buffer[BENCH_STR_SIZE];
+
+    if (pool == NULL || strs == NULL || values == NULL || out == NULL)
+    {
+        fprintf(stderr, "failed to allocate %zu values\n", count);
+        free(pool);
+        free(strs);
+        free(values);
+        free(out);
+        return;
+    }
+
+    printf("format: %zu values per type (floating point compares \"%%.17g\" with shortest output)\n", count);
+    printf("  %-20s %16s %16s %16s\n", "type", "snprintf", "format_primitive", "batch (ns/val)");
+
+    for (int t = 0; t < MY_TYPE_MAX; t++)
+    {
+        size_t size = my_type_sizes[t];
+        unsigned long long check = 0;
+        double snprintf_time;
+        double single_time;
+        double batch_time;
+        double start;
+        size_t written;
+
+        make_strings((my_type)t, pool, strs, count);
+        str_to_primitive_batch(strs, count, (my_type)t, values);
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            check += (unsigned long long)snprintf_primitive(values + i * size, (my_type)t, t == MY_TYPE_FLOAT ? "%.9g" : "%.17g",
+                                                            buffer, BENCH_STR_SIZE);
+        snprintf_time = now_seconds() - start;
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            check += format_primitive(values + i * size, (my_type)t, FLOAT_FORMAT_SHORTEST, buffer, BENCH_STR_SIZE);
+        single_time = now_seconds() - start;
+
+        start = now_seconds();
+        format_primitive_batch(values, count, (my_type)t, FLOAT_FORMAT_SHORTEST, '\n', out, count * BENCH_STR_SIZE, &written);
+        batch_time = now_seconds() - start;
+
+        printf("  %-20s %16.2f %16.2f %16.2f  (check %llX)\n",
+               my_type_names[t],
+               snprintf_time * 1e9 / (double)count,
+               single_time * 1e9 / (double)count,
+               batch_time * 1e9 / (double)count,
+               check + written);
+    }
+
+    // The "%f" mode is a thin wrapper around snprintf, so it's only shown for
+    // comparison.
+    {
+        double start;
+        size_t written;
+
+        make_strings(MY_TYPE_DOUBLE, pool, strs, count);
+        str_to_primitive_batch(strs, count, MY_TYPE_DOUBLE, values);
+
+        start = now_seconds();
+        format_primitive_batch(values, count, MY_TYPE_DOUBLE, FLOAT_FORMAT_FIXED, '\n', out, count * BENCH_STR_SIZE, &written);
+        printf("  %-20s %16s %16s %16.2f\n", "double (%f)", "", "",
+               (now_seconds() - start) * 1e9 / (double)count);
+    }
+
+    free(pool);
+    free(strs);
+    free(values);
+    free(out);
+}
+
+//----------------------------------------------------------------------------
+// columns: rows of structs filled by str_to_primitive versus column_buffer
+
+// The row layout used by the columns benchmark.
+typedef struct bench_row
+{
+    int id;
+    double price;
+    long long stamp;
+    float weight;
+} bench_row;
+
+static const my_type bench_row_types[] = {MY_TYPE_INT, MY_TYPE_DOUBLE, MY_TYPE_LONG_LONG, MY_TYPE_FLOAT};
+
+static const size_t bench_row_offsets[] = {
+    offsetof(bench_row, id),
+    offsetof(bench_row, price),
+    offsetof(bench_row, stamp),
+    offsetof(bench_row, weight)};
+
+#define BENCH_ROW_COLUMNS (sizeof(bench_row_types) / sizeof(bench_row_types[0]))
+
+static void bench_columns(size_t count)
+{
+    char *pool = malloc(count * BENCH_STR_SIZE);
+    const char **strs = malloc(count * sizeof(char *));
+    char *text = malloc(count * BENCH_ROW_COLUMNS * BENCH_STR_SIZE + 1);
+    char *work = malloc(count * BENCH_ROW_COLUMNS * BENCH_STR_SIZE + 1);
+    bench_row *rows = malloc(count * sizeof(bench_row));
+    column_buffer buf;
+    size_t len = 0;
+    size_t written;
+    double aos_sum = 0;
+    double soa_sum = 0;
+    double aos_time;
+    double soa_time;
+    double start;
+    int res;
+
+    if (pool == NULL || strs == NULL || text == NULL || work == NULL || rows == NULL)
+    {
+        fprintf(stderr, "failed to allocate %zu rows\n", count);
+        free(pool);
+        free(strs);
+        free(text);
+        free(work);
+        free(rows);
+        return;
+    }
+
+    // Build the text one column at a time, then interleave the columns into
+    // lines.
+    for (size_t c = 0; c < BENCH_ROW_COLUMNS; c++)
+    {
+        make_strings(bench_row_types[c], pool, strs, count);
+        for (size_t i = 0; i < count; i++)
+            strcpy(work + (i * BENCH_ROW_COLUMNS + c) * BENCH_STR_SIZE, strs[i]);
+    }
+    for (size_t i = 0; i < count * BENCH_ROW_COLUMNS; i++)
+    {
+        size_t n = strlen(work + i * BENCH_STR_SIZE);
+        memcpy(text + len, work + i * BENCH_STR_SIZE, n);
+        len += n;
+        text[len++] = (i + 1) % BENCH_ROW_COLUMNS ? ',' : '\n';
+    }
+    text[len] = '\0';
+
+    printf("columns: %zu rows of %zu columns, %.1f MB of text\n", count, BENCH_ROW_COLUMNS, (double)len / 1e6);
+
+    // The row at a time way: split each line and write each value through a
+    // void pointer into an array of structs.
+    memcpy(work, text, len + 1);
+    start = now_seconds();
+    {
+        char *p = work;
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t c = 0; c < BENCH_ROW_COLUMNS; c++)
+            {
+                char *field = p;
+                while (*p != ',' && *p != '\n')
+                    p++;
+                *p++ = '\0';
+                str_to_primitive(field, bench_row_types[c], (char *)&rows[i] + bench_row_offsets[c]);
+            }
+        }
+    }
+    aos_time = now_seconds() - start;
+    printf("  %-24s %10.2f ns/row\n", "str_to_primitive rows", aos_time * 1e9 / (double)count);
+
+    memcpy(work, text, len + 1);
+    column_buffer_init(&buf, bench_row_types, BENCH_ROW_COLUMNS);
+    start = now_seconds();
+    res = column_buffer_append_text(&buf, work, ',');
+    soa_time = now_seconds() - start;
+    printf("  %-24s %10.2f ns/row%s\n", "column_buffer", soa_time * 1e9 / (double)count,
+           res || buf.rows != count ? "  (failed)" : "");
+
+    // Summing one field only has to read that field's column.
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+        aos_sum += rows[i].price;
+    aos_time = now_seconds() - start;
+
+    start = now_seconds();
+    {
+        const double *price = buf.cols[1].data;
+        for (size_t i = 0; i < buf.rows; i++)
+            soa_sum += price[i];
+    }
+    soa_time = now_seconds() - start;
+
+    printf("  %-24s %10.2f ns/row\n", "sum rows", aos_time * 1e9 / (double)count);
+    printf("  %-24s %10.2f ns/row%s\n", "sum column", soa_time * 1e9 / (double)count,
+           aos_sum != soa_sum ? "  (results differ)" : "");
+
+    start = now_seconds();
+    column_buffer_write(&buf, 0, buf.rows, FLOAT_FORMAT_SHORTEST, ',', work, count * BENCH_ROW_COLUMNS * BENCH_STR_SIZE, &written);
+    printf("  %-24s %10.2f ns/row (%.1f MB)\n", "column_buffer_write",
+           (now_seconds() - start) * 1e9 / (double)count, (double)written / 1e6);
+
+    column_buffer_free(&buf);
+    free(pool);
+    free(strs);
+    free(text);
+    free(work);
+    free(rows);
+}
+
+//----------------------------------------------------------------------------
+
+static const bench benches[] = {
+    {"convert", bench_convert},
+    {"format", bench_format},
+    {"columns", bench_columns},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    int found = 0;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (name == NULL || !strcmp(name, benches[i].name))
+        {
+            benches[i].run(count);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
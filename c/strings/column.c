@@ -0,0 +1,214 @@
+#include "column.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The number of strings handed to str_to_primitive_batch at a time when
+// gathering one column out of rows of fields.
+#define COLUMN_GATHER 256
+
+// The number of lines split by column_buffer_append_text before they are
+// converted.
+#define COLUMN_TEXT_ROWS 1024
+
+int column_buffer_init(column_buffer *buf, const my_type *types, size_t ncols)
+{
+    if (ncols > COLUMN_MAX)
+        return 1;
+
+    memset(buf, 0, sizeof(*buf));
+
+    for (size_t c = 0; c < ncols; c++)
+    {
+        if (types[c] >= MY_TYPE_MAX)
+            return 1;
+        buf->cols[c].type = types[c];
+    }
+
+    buf->ncols = ncols;
+    return 0;
+}
+
+void column_buffer_free(column_buffer *buf)
+{
+    for (size_t c = 0; c < buf->ncols; c++)
+        free(buf->cols[c].data);
+
+    memset(buf, 0, sizeof(*buf));
+}
+
+int column_buffer_reserve(column_buffer *buf, size_t n)
+{
+    size_t cap = buf->cap ? buf->cap : 64;
+
+    if (n <= buf->cap)
+        return 0;
+
+    while (cap < n)
+        cap *= 2;
+
+    // malloc returns memory aligned for any type, including long double, so
+    // every element of every column is properly aligned.
+    // Columns that have already grown keep their new size if a later one
+    // fails; cap only changes once they all have.
+    for (size_t c = 0; c < buf->ncols; c++)
+    {
+        size_t size = my_type_sizes[buf->cols[c].type];
+        void *data;
+
+        if (cap > (size_t)-1 / size)
+            return 1;
+
+        data = realloc(buf->cols[c].data, cap * size);
+        if (data == NULL)
+            return 1;
+
+        buf->cols[c].data = data;
+    }
+
+    buf->cap = cap;
+    return 0;
+}
+
+int column_buffer_append_rows(column_buffer *buf, const char **fields, size_t rows)
+{
+    const char *strs[COLUMN_GATHER];
+
+    if (column_buffer_reserve(buf, buf->rows + rows))
+        return 1;
+
+    // Each column is converted on its own, so the conversion for its type is
+    // looked up once and its values are written one after another.
+    // The rows are only counted once every column has converted, so a bad
+    // string leaves the buffer as it was.
+    for (size_t c = 0; c < buf->ncols; c++)
+    {
+        size_t size = my_type_sizes[buf->cols[c].type];
+        char *dest = (char *)buf->cols[c].data + buf->rows * size;
+
+        for (size_t r = 0; r < rows; r += COLUMN_GATHER)
+        {
+            size_t k = rows - r < COLUMN_GATHER ? rows - r : COLUMN_GATHER;
+
+            for (size_t i = 0; i < k; i++)
+                strs[i] = fields[(r + i) * buf->ncols + c];
+
+            if (str_to_primitive_batch(strs, k, buf->cols[c].type, dest + r * size))
+                return 1;
+        }
+    }
+
+    buf->rows += rows;
+    return 0;
+}
+
+int column_buffer_append_text(column_buffer *buf, char *text, char sep)
+{
+    const char **fields;
+    size_t rows = 0;
+    int res = 0;
+
+    if (buf->ncols == 0)
+        return 1;
+
+    fields = malloc(COLUMN_TEXT_ROWS * buf->ncols * sizeof(*fields));
+    if (fields == NULL)
+        return 1;
+
+    while (*text != '\0' && res == 0)
+    {
+        const char **row = fields + rows * buf->ncols;
+        size_t n = 0;
+        char *end;
+
+        if (*text == '\n' || (*text == '\r' && text[1] == '\n'))
+        {
+            text += *text == '\r' ? 2 : 1;
+            continue;
+        }
+
+        // Split one line into fields, ending each field with a NUL.
+        for (;;)
+        {
+            if (n == buf->ncols)
+            {
+                res = 1;
+                break;
+            }
+
+            row[n++] = text;
+            while (*text != sep && *text != '\n' && *text != '\0')
+                text++;
+
+            end = text;
+            if (*text == sep)
+            {
+                *text++ = '\0';
+                continue;
+            }
+
+            if (*text == '\n')
+                text++;
+            if (end > row[n - 1] && end[-1] == '\r')
+                end--;
+            *end = '\0';
+            break;
+        }
+
+        if (res == 0 && n != buf->ncols)
+            res = 1;
+
+        if (res == 0 && ++rows == COLUMN_TEXT_ROWS)
+        {
+            res = column_buffer_append_rows(buf, fields, rows);
+            rows = 0;
+        }
+    }
+
+    if (res == 0 && rows > 0)
+        res = column_buffer_append_rows(buf, fields, rows);
+
+    free(fields);
+    return res;
+}
+
+size_t column_buffer_write(const column_buffer *buf, size_t first, size_t n, float_format ff,
+                           char sep, char *buffer, size_t s, size_t *written)
+{
+    size_t pos = 0;
+    size_t r;
+
+    if (first > buf->rows)
+        first = buf->rows;
+    if (n > buf->rows - first)
+        n = buf->rows - first;
+
+    for (r = first; r < first + n; r++)
+    {
+        size_t row_start = pos;
+        size_t c;
+
+        for (c = 0; c < buf->ncols; c++)
+        {
+            const column *col = &buf->cols[c];
+            const char *value = (const char *)col->data + r * my_type_sizes[col->type];
+            size_t len = format_primitive(value, col->type, ff, buffer + pos, s - pos);
+
+            // The value and the character after it both have to fit.
+            if (len >= s - pos)
+                break;
+
+            buffer[pos + len] = c + 1 < buf->ncols ? sep : '\n';
+            pos += len + 1;
+        }
+
+        if (c < buf->ncols)
+        {
+            pos = row_start;
+            break;
+        }
+    }
+
+    *written = pos;
+    return r - first;
+}
@@ -0,0 +1,128 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <stddef.h>
+
+#include "convert.h"
+#include "format.h"
+
+// The most columns a column_buffer can have.
+#define COLUMN_MAX 64
+
+// One column of a column_buffer: a contiguous array of a single type.
+typedef struct column
+{
+    my_type type; // the type of every value in the column
+    void *data;   // an array of at least cap values of the type
+} column;
+
+// Rows of primitive values stored as one array per column, so that reading
+// every value of one column touches only that column's memory.
+//
+// The value in row r of column c is at
+//   (char *)buf.cols[c].data + r * my_type_sizes[buf.cols[c].type]
+// or can be read directly through a pointer of the right type, like
+//   ((double *)buf.cols[c].data)[r]
+typedef struct column_buffer
+{
+    column cols[COLUMN_MAX];
+    size_t ncols; // the number of columns
+    size_t rows;  // the number of rows in every column
+    size_t cap;   // the number of rows every column has room for
+} column_buffer;
+
+/**
+ * Initializes an empty buffer with one column per type.
+ *
+ * Params:
+ *   column_buffer* - the buffer to initialize
+ *   const my_type* - the type of each column
+ *   size_t - the number of columns, up to COLUMN_MAX
+ *
+ * Returns:
+ *   int - 0 on success, 1 if there are too many columns or a type is invalid
+ */
+int column_buffer_init(column_buffer *buf, const my_type *types, size_t ncols);
+
+/**
+ * Releases the memory held by every column.
+ *
+ * Params:
+ *   column_buffer* - the buffer
+ */
+void column_buffer_free(column_buffer *buf);
+
+/**
+ * Ensures every column can hold at least n rows without reallocating.
+ * The capacity grows geometrically so that repeated appends are amortized
+ * constant time.
+ *
+ * Params:
+ *   column_buffer* - the buffer
+ *   size_t - the required number of rows
+ *
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int column_buffer_reserve(column_buffer *buf, size_t n);
+
+/**
+ * Appends rows of strings, converting each column with
+ * str_to_primitive_batch. Either every row is appended or, if any string
+ * fails to convert, none of them are.
+ *
+ * Params:
+ *   column_buffer* - the buffer
+ *   const char** - rows * ncols strings, one row after another
+ *   size_t - the number of rows
+ *
+ * Returns:
+ *   int - 0 on success, 1 if a string failed to convert or a column could
+ *         not grow
+ */
+int column_buffer_append_rows(column_buffer *buf, const char **fields, size_t rows);
+
+/**
+ * Appends every line of a block of text, like the contents of a CSV file
+ * with only numeric columns. Each line must have exactly one field per
+ * column, separated by sep. Empty lines are skipped and a '\r' before a
+ * newline is ignored.
+ * The text is modified: every separator and newline is replaced with a NUL
+ * so that the fields can be converted in place.
+ * Lines are converted in groups, so if this fails, the lines before the
+ * group with the bad line have already been appended.
+ *
+ * Params:
+ *   column_buffer* - the buffer
+ *   char* - a NUL-terminated block of text
+ *   char - the field separator, like ','
+ *
+ * Returns:
+ *   int - 0 on success, 1 if a line has the wrong number of fields, a field
+ *         failed to convert, or a column could not grow
+ */
+int column_buffer_append_text(column_buffer *buf, char *text, char sep);
+
+/**
+ * Writes rows as text, with values separated by sep and each row followed
+ * by a newline. Values are converted by format_primitive, so FLOAT_FORMAT_FIXED
+ * gives the same text as primitive_to_str. No NUL terminator is written.
+ * A whole column can also be written with format_primitive_batch.
+ *
+ * Params:
+ *   const column_buffer* - the buffer
+ *   size_t - the first row to write
+ *   size_t - the number of rows to write
+ *   float_format - how floating point values are written
+ *   char - the separator between values
+ *   char* - a pointer to a char buffer
+ *   size_t - the size of the char buffer
+ *   size_t* - receives the number of bytes written to the char buffer
+ *
+ * Returns:
+ *   size_t - the number of whole rows that were written
+ */
+size_t column_buffer_write(const column_buffer *buf, size_t first, size_t n, float_format ff,
+                           char sep, char *buffer, size_t s, size_t *written);
+
+#endif
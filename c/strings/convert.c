@@ -0,0 +1,282 @@
+#include "convert.h"
+#include "format.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+const char *my_type_names[MY_TYPE_MAX] = {
+    "char",
+    "unsigned char",
+    "short",
+    "unsigned short",
+    "int",
+    "unsigned int",
+    "long",
+    "unsigned long",
+    "long long",
+    "unsigned long long",
+    "float",
+    "double",
+    "long double"};
+
+const size_t my_type_sizes[MY_TYPE_MAX] = {
+    sizeof(char),
+    sizeof(unsigned char),
+    sizeof(short),
+    sizeof(unsigned short),
+    sizeof(int),
+    sizeof(unsigned int),
+    sizeof(long),
+    sizeof(unsigned long),
+    sizeof(long long),
+    sizeof(unsigned long long),
+    sizeof(float),
+    sizeof(double),
+    sizeof(long double)};
+
+// Assigns a long value, v, to a destination pointed to by pointer p.
+// The value is cast as type t.
+#define as_value(t,v,p) *((t*) p) = (t)v
+
+int str_to_primitive(const char *str, my_type type, void *dest)
+{
+    if (type >= MY_TYPE_MAX)
+        return 1;
+
+    // This function relies on the following functions defined as part of the
+    // C99 standard:
+    //   strtol
+    //   strtoul
+    //   strtoll
+    //   strtoull
+    //   strtof
+    //   strtod
+    //   strtold
+    //
+    // Notes on strtol from https://en.cppreference.com/w/c/string/byte/strtol
+    // Ignores leading whitespace.
+    // The string may start with an optional plus or minus sign.
+    // The string may start with an optional 0 for octal or 0x or 0X for hexadecimal.
+    // If the base is 0, then the base is detected automatically.
+    // If the source string is empty or malformed, no conversion occurs.
+    //
+    // On success, the integer representation of the string is returned.
+    // If the integer value is out of range, then LONG_MIN or LONG_MAX is
+    // returned and errno is set to ERANGE.
+    // If no conversion is possible, then 0 is returned.
+
+    long               l_res;
+    unsigned long      ul_res;
+    long long          ll_res;
+    unsigned long long ull_res;
+    float              f_res;
+    double             d_res;
+    long double        ld_res;
+
+    // errno is only set on failure, so it has to be cleared first in order to
+    // tell whether this conversion was out of range.
+    errno = 0;
+
+    if      (type <= MY_TYPE_LONG)               l_res   = strtol   (str, NULL, 10);
+    else if (type == MY_TYPE_UNSIGNED_LONG)      ul_res  = strtoul  (str, NULL, 10);
+    else if (type == MY_TYPE_LONG_LONG)          ll_res  = strtoll  (str, NULL, 10);
+    else if (type == MY_TYPE_UNSIGNED_LONG_LONG) ull_res = strtoull (str, NULL, 10);
+    else if (type == MY_TYPE_FLOAT)              f_res   = strtof   (str, NULL);
+    else if (type == MY_TYPE_DOUBLE)             d_res   = strtod   (str, NULL);
+    else if (type == MY_TYPE_LONG_DOUBLE)        ld_res  = strtold  (str, NULL);
+
+    if (errno == ERANGE)
+        return 1;
+
+    switch (type)
+    {
+    case MY_TYPE_CHAR:               as_value(char,               l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_CHAR:      as_value(unsigned char,      l_res,   dest);  return 0;
+    case MY_TYPE_SHORT:              as_value(short,              l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_SHORT:     as_value(unsigned short,     l_res,   dest);  return 0;
+    case MY_TYPE_INT:                as_value(int,                l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_INT:       as_value(unsigned int,       l_res,   dest);  return 0;
+    case MY_TYPE_LONG:               as_value(long,               l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_LONG:      as_value(unsigned long,      ul_res,  dest);  return 0;
+    case MY_TYPE_LONG_LONG:          as_value(long long,          ll_res,  dest);  return 0;
+    case MY_TYPE_UNSIGNED_LONG_LONG: as_value(unsigned long long, ull_res, dest);  return 0;
+    case MY_TYPE_FLOAT:              as_value(float,              f_res,   dest);  return 0;
+    case MY_TYPE_DOUBLE:             as_value(double,             d_res,   dest);  return 0;
+    case MY_TYPE_LONG_DOUBLE:        as_value(long double,        ld_res,  dest);  return 0;
+    default: return 0;
+    }
+}
+
+int primitive_to_str(void* value, my_type type, char* buffer, size_t s)
+{
+    // Integers and characters are converted by format_primitive, which
+    // writes digits two at a time from a lookup table instead of
+    // interpreting a format string. Floating point values keep the "%f"
+    // output of snprintf.
+    //
+    // Notes on snprintf from https://en.cppreference.com/w/c/io/fprintf
+    // Writes the results to a character string buffer.
+    // At most bufsz - 1 characters are written.
+    // The resulting character string will be terminated with a null character, unless bufsz is zero.
+    // If bufsz is zero, nothing is written and buffer may be a null pointer,
+    // however the return value (number of bytes that would be written not including the null terminator)
+    // is still calculated and returned.
+    //
+    // format_primitive truncates its output the same way.
+
+    if (type >= MY_TYPE_MAX)
+        return 1;
+
+    format_primitive(value, type, FLOAT_FORMAT_FIXED, buffer, s);
+    return 0;
+}
+
+//----------------------------------------------------------------------------
+// batch conversion
+
+// A function that converts a whole array of strings to one type.
+typedef int (*batch_fn)(const char **strs, size_t n, void *dest);
+
+/**
+ * Parses an optionally signed base 10 integer the same way strtol does,
+ * without looking at the locale.
+ *
+ * Params:
+ *   const char* - a pointer to a string of characters
+ *   unsigned long long* - receives the magnitude of the value
+ *   int* - receives 1 if the value is negative
+ *
+ * Returns:
+ *   int - 0 on success, 1 if there are no digits or the magnitude is too big
+ */
+static inline int parse_decimal(const char *str, unsigned long long *mag, int *neg)
+{
+    unsigned long long v = 0;
+    const char *start;
+
+    while (*str == ' ' || (*str >= '\t' && *str <= '\r'))
+        str++;
+
+    *neg = *str == '-';
+    if (*str == '-' || *str == '+')
+        str++;
+
+    start = str;
+    while ((unsigned char)(*str - '0') < 10)
+    {
+        unsigned d = (unsigned)(*str - '0');
+        if (v > (ULLONG_MAX - d) / 10)
+            return 1;
+        v = v * 10 + d;
+        str++;
+    }
+
+    *mag = v;
+    return str == start;
+}
+
+// Defines a batch converter for a signed integer type.
+// The most negative value has a magnitude one greater than the maximum, so
+// it's built from (mag - 1) to avoid overflowing during the negation.
+#define DEFINE_SIGNED_BATCH(name, t, t_max)                                        \
+    static int name(const char **strs, size_t n, void *dest)                      \
+    {                                                                              \
+        t *out = dest;                                                             \
+        int res = 0;                                                               \
+        for (size_t i = 0; i < n; i++)                                             \
+        {                                                                          \
+            unsigned long long mag;                                                \
+            int neg;                                                               \
+            if (parse_decimal(strs[i], &mag, &neg) ||                              \
+                mag > (unsigned long long)(t_max) + (unsigned long long)neg)       \
+            {                                                                      \
+                res = 1;                                                           \
+                continue;                                                          \
+            }                                                                      \
+            out[i] = neg && mag ? (t)(-(t)(mag - 1) - 1) : (t)mag;                 \
+        }                                                                          \
+        return res;                                                                \
+    }
+
+// Defines a batch converter for an unsigned integer type.
+#define DEFINE_UNSIGNED_BATCH(name, t, t_max)                                      \
+    static int name(const char **strs, size_t n, void *dest)                      \
+    {                                                                              \
+        t *out = dest;                                                             \
+        int res = 0;                                                               \
+        for (size_t i = 0; i < n; i++)                                             \
+        {                                                                          \
+            unsigned long long mag;                                                \
+            int neg;                                                               \
+            if (parse_decimal(strs[i], &mag, &neg) || (neg && mag) ||              \
+                mag > (unsigned long long)(t_max))                                 \
+            {                                                                      \
+                res = 1;                                                           \
+                continue;                                                          \
+            }                                                                      \
+            out[i] = (t)mag;                                                       \
+        }                                                                          \
+        return res;                                                                \
+    }
+
+// Defines a batch converter for a floating point type using one of the
+// strto* functions.
+#define DEFINE_FLOAT_BATCH(name, t, conv)                                          \
+    static int name(const char **strs, size_t n, void *dest)                      \
+    {                                                                              \
+        t *out = dest;                                                             \
+        int res = 0;                                                               \
+        for (size_t i = 0; i < n; i++)                                             \
+        {                                                                          \
+            errno = 0;                                                             \
+            out[i] = conv(strs[i], NULL);                                          \
+            if (errno == ERANGE)                                                   \
+                res = 1;                                                           \
+        }                                                                          \
+        return res;                                                                \
+    }
+
+#if CHAR_MIN < 0
+DEFINE_SIGNED_BATCH  (batch_char,               char,               CHAR_MAX)
+#else
+DEFINE_UNSIGNED_BATCH(batch_char,               char,               CHAR_MAX)
+#endif
+DEFINE_UNSIGNED_BATCH(batch_unsigned_char,      unsigned char,      UCHAR_MAX)
+DEFINE_SIGNED_BATCH  (batch_short,              short,              SHRT_MAX)
+DEFINE_UNSIGNED_BATCH(batch_unsigned_short,     unsigned short,     USHRT_MAX)
+DEFINE_SIGNED_BATCH  (batch_int,                int,                INT_MAX)
+DEFINE_UNSIGNED_BATCH(batch_unsigned_int,       unsigned int,       UINT_MAX)
+DEFINE_SIGNED_BATCH  (batch_long,               long,               LONG_MAX)
+DEFINE_UNSIGNED_BATCH(batch_unsigned_long,      unsigned long,      ULONG_MAX)
+DEFINE_SIGNED_BATCH  (batch_long_long,          long long,          LLONG_MAX)
+DEFINE_UNSIGNED_BATCH(batch_unsigned_long_long, unsigned long long, ULLONG_MAX)
+DEFINE_FLOAT_BATCH   (batch_float,              float,              strtof)
+DEFINE_FLOAT_BATCH   (batch_double,             double,             strtod)
+DEFINE_FLOAT_BATCH   (batch_long_double,        long double,        strtold)
+
+// The batch converter for each type, indexed by my_type.
+static const batch_fn batch_fns[MY_TYPE_MAX] = {
+    batch_char,
+    batch_unsigned_char,
+    batch_short,
+    batch_unsigned_short,
+    batch_int,
+    batch_unsigned_int,
+    batch_long,
+    batch_unsigned_long,
+    batch_long_long,
+    batch_unsigned_long_long,
+    batch_float,
+    batch_double,
+    batch_long_double};
+
+int str_to_primitive_batch(const char **strs, size_t n, my_type type, void *dest)
+{
+    if (type >= MY_TYPE_MAX)
+        return 1;
+
+    return batch_fns[type](strs, n, dest);
+}
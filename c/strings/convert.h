@@ -0,0 +1,82 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+
+// an enum could also be defined as
+// enum my_enum { A, B, C };
+// but then it would need to be used like so:
+// enum my_enum e = A;
+// By wrapping it in a typedef, it can be used like:
+// my_enum e = A;
+typedef enum my_type
+{
+    MY_TYPE_CHAR = 0,
+    MY_TYPE_UNSIGNED_CHAR,
+    MY_TYPE_SHORT,
+    MY_TYPE_UNSIGNED_SHORT,
+    MY_TYPE_INT,
+    MY_TYPE_UNSIGNED_INT,
+    MY_TYPE_LONG,
+    MY_TYPE_UNSIGNED_LONG,
+    MY_TYPE_LONG_LONG,
+    MY_TYPE_UNSIGNED_LONG_LONG,
+    MY_TYPE_FLOAT,
+    MY_TYPE_DOUBLE,
+    MY_TYPE_LONG_DOUBLE,
+    MY_TYPE_MAX,
+} my_type;
+
+extern const char *my_type_names[MY_TYPE_MAX];
+
+// The size in bytes of each type, indexed by my_type.
+extern const size_t my_type_sizes[MY_TYPE_MAX];
+
+/**
+ * Converts a NUL-terminated string into one of the primitive types.
+ *
+ * Params:
+ *   const char* - a pointer to a string of characters
+ *   my_type - a type enumeration of the value's type
+ *   void* - a pointer to the destination for the converted value
+ * 
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int str_to_primitive(const char *str, my_type type, void *dest);
+
+/**
+ * Converts an array of NUL-terminated strings into an array of one of the
+ * primitive types.
+ * The conversion for the type is looked up once for the whole batch instead
+ * of once per value, and integers are parsed by a base 10 parser that
+ * doesn't consult the locale. Unlike str_to_primitive, an integer that
+ * doesn't fit in the destination type is a failure rather than being
+ * truncated, and unsigned types don't accept a minus sign.
+ *
+ * Params:
+ *   const char** - an array of pointers to strings
+ *   size_t - the number of strings
+ *   my_type - a type enumeration of every value's type
+ *   void* - a pointer to an array of that type with room for every value
+ *
+ * Returns:
+ *   int - 0 on success, 1 if the type is invalid or any string failed to
+ *         convert
+ */
+int str_to_primitive_batch(const char **strs, size_t n, my_type type, void *dest);
+
+/**
+ * Converts a primitive to a string of char.
+ * 
+ * Params:
+ *   void* - a pointer to the value to convert
+ *   my_type - a type enumeration of the value's type
+ *   char* - a pointer to a char buffer
+ * 
+ * Returns:
+ *   int - 0 on success, 1 on failure
+ */
+int primitive_to_str(void* value, my_type type, char* buffer, size_t s);
+
+#endif
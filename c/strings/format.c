@@ -0,0 +1,645 @@
+#include "format.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Room for the longest integer or shortest floating point output.
+#define FORMAT_TEMP_SIZE 64
+
+// Every two digit number from 00 to 99, so that digits can be produced in
+// pairs with one division by 100 instead of two divisions by 10.
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+//----------------------------------------------------------------------------
+// integers
+
+static inline unsigned count_digits(unsigned long long v)
+{
+    unsigned n = 1;
+    while (v >= 10000)
+    {
+        v /= 10000;
+        n += 4;
+    }
+    return n + (v >= 10) + (v >= 100) + (v >= 1000);
+}
+
+// Writes the digits of v from the end, two at a time, and returns the
+// number of digits. Values that fit in 32 bits use 32-bit division, which is
+// much cheaper than 64-bit division on most processors.
+static inline size_t format_u64(char *p, unsigned long long v)
+{
+    size_t len = count_digits(v);
+    char *d = p + len;
+
+    while (v > 0xFFFFFFFFULL)
+    {
+        unsigned r = (unsigned)(v % 100) * 2;
+        v /= 100;
+        d -= 2;
+        d[0] = digit_pairs[r];
+        d[1] = digit_pairs[r + 1];
+    }
+
+    unsigned int w = (unsigned int)v;
+    while (w >= 100)
+    {
+        unsigned r = (w % 100) * 2;
+        w /= 100;
+        d -= 2;
+        d[0] = digit_pairs[r];
+        d[1] = digit_pairs[r + 1];
+    }
+
+    if (w >= 10)
+    {
+        d -= 2;
+        d[0] = digit_pairs[w * 2];
+        d[1] = digit_pairs[w * 2 + 1];
+    }
+    else
+    {
+        d[-1] = (char)('0' + w);
+    }
+
+    return len;
+}
+
+static inline size_t format_i64(char *p, long long v)
+{
+    if (v < 0)
+    {
+        *p = '-';
+        return 1 + format_u64(p + 1, 0ULL - (unsigned long long)v);
+    }
+    return format_u64(p, (unsigned long long)v);
+}
+
+//----------------------------------------------------------------------------
+// shortest floating point output
+//
+// This is Florian Loitsch's Grisu2 algorithm. The value and the boundaries
+// halfway to its neighbours are scaled by a cached power of ten so that the
+// integer part of the upper boundary has only a few digits, and then digits
+// are generated until the result is within the boundaries. The output
+// always reads back as the same value, and it's the shortest such output for
+// the vast majority of values.
+
+// A floating point number with a 64-bit significand: f * 2^e.
+typedef struct diy_fp
+{
+    uint64_t f;
+    int e;
+} diy_fp;
+
+// 10^k for k = -348, -340, ..., 340, normalized to 64 bits.
+static const diy_fp cached_powers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, // 1e-348
+    {0xbaaee17fa23ebf76ULL, -1193}, // 1e-340
+    {0x8b16fb203055ac76ULL, -1166}, // 1e-332
+    {0xcf42894a5dce35eaULL, -1140}, // 1e-324
+    {0x9a6bb0aa55653b2dULL, -1113}, // 1e-316
+    {0xe61acf033d1a45dfULL, -1087}, // 1e-308
+    {0xab70fe17c79ac6caULL, -1060}, // 1e-300
+    {0xff77b1fcbebcdc4fULL, -1034}, // 1e-292
+    {0xbe5691ef416bd60cULL, -1007}, // 1e-284
+    {0x8dd01fad907ffc3cULL, -980}, // 1e-276
+    {0xd3515c2831559a83ULL, -954}, // 1e-268
+    {0x9d71ac8fada6c9b5ULL, -927}, // 1e-260
+    {0xea9c227723ee8bcbULL, -901}, // 1e-252
+    {0xaecc49914078536dULL, -874}, // 1e-244
+    {0x823c12795db6ce57ULL, -847}, // 1e-236
+    {0xc21094364dfb5637ULL, -821}, // 1e-228
+    {0x9096ea6f3848984fULL, -794}, // 1e-220
+    {0xd77485cb25823ac7ULL, -768}, // 1e-212
+    {0xa086cfcd97bf97f4ULL, -741}, // 1e-204
+    {0xef340a98172aace5ULL, -715}, // 1e-196
+    {0xb23867fb2a35b28eULL, -688}, // 1e-188
+    {0x84c8d4dfd2c63f3bULL, -661}, // 1e-180
+    {0xc5dd44271ad3cdbaULL, -635}, // 1e-172
+    {0x936b9fcebb25c996ULL, -608}, // 1e-164
+    {0xdbac6c247d62a584ULL, -582}, // 1e-156
+    {0xa3ab66580d5fdaf6ULL, -555}, // 1e-148
+    {0xf3e2f893dec3f126ULL, -529}, // 1e-140
+    {0xb5b5ada8aaff80b8ULL, -502}, // 1e-132
+    {0x87625f056c7c4a8bULL, -475}, // 1e-124
+    {0xc9bcff6034c13053ULL, -449}, // 1e-116
+    {0x964e858c91ba2655ULL, -422}, // 1e-108
+    {0xdff9772470297ebdULL, -396}, // 1e-100
+    {0xa6dfbd9fb8e5b88fULL, -369}, // 1e-92
+    {0xf8a95fcf88747d94ULL, -343}, // 1e-84
+    {0xb94470938fa89bcfULL, -316}, // 1e-76
+    {0x8a08f0f8bf0f156bULL, -289}, // 1e-68
+    {0xcdb02555653131b6ULL, -263}, // 1e-60
+    {0x993fe2c6d07b7facULL, -236}, // 1e-52
+    {0xe45c10c42a2b3b06ULL, -210}, // 1e-44
+    {0xaa242499697392d3ULL, -183}, // 1e-36
+    {0xfd87b5f28300ca0eULL, -157}, // 1e-28
+    {0xbce5086492111aebULL, -130}, // 1e-20
+    {0x8cbccc096f5088ccULL, -103}, // 1e-12
+    {0xd1b71758e219652cULL, -77}, // 1e-4
+    {0x9c40000000000000ULL, -50}, // 1e4
+    {0xe8d4a51000000000ULL, -24}, // 1e12
+    {0xad78ebc5ac620000ULL, 3}, // 1e20
+    {0x813f3978f8940984ULL, 30}, // 1e28
+    {0xc097ce7bc90715b3ULL, 56}, // 1e36
+    {0x8f7e32ce7bea5c70ULL, 83}, // 1e44
+    {0xd5d238a4abe98068ULL, 109}, // 1e52
+    {0x9f4f2726179a2245ULL, 136}, // 1e60
+    {0xed63a231d4c4fb27ULL, 162}, // 1e68
+    {0xb0de65388cc8ada8ULL, 189}, // 1e76
+    {0x83c7088e1aab65dbULL, 216}, // 1e84
+    {0xc45d1df942711d9aULL, 242}, // 1e92
+    {0x924d692ca61be758ULL, 269}, // 1e100
+    {0xda01ee641a708deaULL, 295}, // 1e108
+    {0xa26da3999aef774aULL, 322}, // 1e116
+    {0xf209787bb47d6b85ULL, 348}, // 1e124
+    {0xb454e4a179dd1877ULL, 375}, // 1e132
+    {0x865b86925b9bc5c2ULL, 402}, // 1e140
+    {0xc83553c5c8965d3dULL, 428}, // 1e148
+    {0x952ab45cfa97a0b3ULL, 455}, // 1e156
+    {0xde469fbd99a05fe3ULL, 481}, // 1e164
+    {0xa59bc234db398c25ULL, 508}, // 1e172
+    {0xf6c69a72a3989f5cULL, 534}, // 1e180
+    {0xb7dcbf5354e9beceULL, 561}, // 1e188
+    {0x88fcf317f22241e2ULL, 588}, // 1e196
+    {0xcc20ce9bd35c78a5ULL, 614}, // 1e204
+    {0x98165af37b2153dfULL, 641}, // 1e212
+    {0xe2a0b5dc971f303aULL, 667}, // 1e220
+    {0xa8d9d1535ce3b396ULL, 694}, // 1e228
+    {0xfb9b7cd9a4a7443cULL, 720}, // 1e236
+    {0xbb764c4ca7a44410ULL, 747}, // 1e244
+    {0x8bab8eefb6409c1aULL, 774}, // 1e252
+    {0xd01fef10a657842cULL, 800}, // 1e260
+    {0x9b10a4e5e9913129ULL, 827}, // 1e268
+    {0xe7109bfba19c0c9dULL, 853}, // 1e276
+    {0xac2820d9623bf429ULL, 880}, // 1e284
+    {0x80444b5e7aa7cf85ULL, 907}, // 1e292
+    {0xbf21e44003acdd2dULL, 933}, // 1e300
+    {0x8e679c2f5e44ff8fULL, 960}, // 1e308
+    {0xd433179d9c8cb841ULL, 986}, // 1e316
+    {0x9e19db92b4e31ba9ULL, 1013}, // 1e324
+    {0xeb96bf6ebadf77d9ULL, 1039}, // 1e332
+    {0xaf87023b9bf0ee6bULL, 1066}, // 1e340
+};
+
+static inline diy_fp diy_mul(diy_fp x, diy_fp y)
+{
+    const uint64_t m32 = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32;
+    uint64_t b = x.f & m32;
+    uint64_t c = y.f >> 32;
+    uint64_t d = y.f & m32;
+    uint64_t ac = a * c;
+    uint64_t bc = b * c;
+    uint64_t ad = a * d;
+    uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + (1ULL << 31);
+    diy_fp r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static inline diy_fp diy_normalize(diy_fp x)
+{
+    while (!(x.f & (1ULL << 63)))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+// Finds the cached power that brings a value with binary exponent e into
+// the range used by digit generation, and its decimal exponent k.
+static inline diy_fp cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    unsigned index;
+
+    if (dk - ik > 0.0)
+        ik++;
+
+    index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)index * 8);
+    return cached_powers[index];
+}
+
+static inline void grisu_round(char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static const uint32_t pow10_32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static void digit_gen(diy_fp w, diy_fp mp, uint64_t delta, char *buffer, int *len, int *k)
+{
+    diy_fp one;
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1;
+    uint64_t p2;
+    int kappa;
+
+    one.f = 1ULL << -mp.e;
+    one.e = mp.e;
+
+    p1 = (uint32_t)(mp.f >> -one.e);
+    p2 = mp.f & (one.f - 1);
+    kappa = (int)count_digits(p1);
+    *len = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t d = p1 / pow10_32[kappa - 1];
+        p1 %= pow10_32[kappa - 1];
+
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta)
+        {
+            *k += kappa;
+            grisu_round(buffer, *len, delta, tmp, (uint64_t)pow10_32[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    for (;;)
+    {
+        char d;
+
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> -one.e);
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta)
+        {
+            *k += kappa;
+            grisu_round(buffer, *len, delta, p2, one.f, -kappa < 10 ? wp_w * pow10_32[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+/**
+ * Generates the shortest digits for a positive, finite, non-zero value.
+ *
+ * Params:
+ *   uint64_t - the significand bits, without the hidden bit
+ *   int - the biased exponent bits
+ *   int - the number of significand bits (52 for double, 23 for float)
+ *   int - the exponent bias plus the number of significand bits
+ *   char* - receives the digits
+ *   int* - receives the number of digits
+ *
+ * Returns:
+ *   int - the decimal exponent, so that the value is digits * 10^exponent
+ */
+static int grisu2(uint64_t sig, int biased_e, int sig_bits, int bias, char *buffer, int *len)
+{
+    diy_fp v;
+    diy_fp plus;
+    diy_fp minus;
+    diy_fp c;
+    diy_fp w;
+    diy_fp wp;
+    diy_fp wm;
+    int k;
+
+    if (biased_e)
+    {
+        v.f = sig | (1ULL << sig_bits);
+        v.e = biased_e - bias;
+    }
+    else
+    {
+        v.f = sig;
+        v.e = 1 - bias;
+    }
+
+    // The boundaries are halfway between the value and its neighbours. The
+    // lower one is closer when the significand is a power of two.
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    while (!(plus.f & (1ULL << (sig_bits + 1))))
+    {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 64 - sig_bits - 2;
+    plus.e -= 64 - sig_bits - 2;
+
+    if (v.f == (1ULL << sig_bits))
+    {
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    }
+    else
+    {
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    c = cached_power(plus.e, &k);
+    w = diy_mul(diy_normalize(v), c);
+    wp = diy_mul(plus, c);
+    wm = diy_mul(minus, c);
+    wm.f++;
+    wp.f--;
+
+    digit_gen(w, wp, wp.f - wm.f, buffer, len, &k);
+    return k;
+}
+
+// Lays out digits * 10^k the way a person would write it: plain digits for
+// reasonable magnitudes and scientific notation for very big or very small
+// ones.
+static size_t layout_digits(char *p, const char *digits, int len, int k)
+{
+    int kk = len + k; // the position of the decimal point
+    char *start = p;
+
+    if (len <= kk && kk <= 21)
+    {
+        memcpy(p, digits, (size_t)len);
+        memset(p + len, '0', (size_t)(kk - len));
+        p += kk;
+    }
+    else if (0 < kk && kk <= 21)
+    {
+        memcpy(p, digits, (size_t)kk);
+        p[kk] = '.';
+        memcpy(p + kk + 1, digits + kk, (size_t)(len - kk));
+        p += len + 1;
+    }
+    else if (-6 < kk && kk <= 0)
+    {
+        p[0] = '0';
+        p[1] = '.';
+        memset(p + 2, '0', (size_t)-kk);
+        memcpy(p + 2 - kk, digits, (size_t)len);
+        p += 2 - kk + len;
+    }
+    else
+    {
+        int e = kk - 1;
+
+        *p++ = digits[0];
+        if (len > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)(len - 1));
+            p += len - 1;
+        }
+
+        // At least two exponent digits, like printf.
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        if (e < 0)
+            e = -e;
+        if (e < 10)
+            *p++ = '0';
+        p += format_u64(p, (unsigned long long)e);
+    }
+
+    return (size_t)(p - start);
+}
+
+static size_t format_ieee(char *p, uint64_t bits, int sig_bits, int exp_bits, int bias)
+{
+    uint64_t sig = bits & ((1ULL << sig_bits) - 1);
+    int biased_e = (int)((bits >> sig_bits) & ((1ULL << exp_bits) - 1));
+    int neg = (int)(bits >> (sig_bits + exp_bits)) & 1;
+    char digits[32];
+    char *start = p;
+    int len;
+    int k;
+
+    if (neg)
+        *p++ = '-';
+
+    if (biased_e == (1 << exp_bits) - 1)
+    {
+        memcpy(p, sig ? "nan" : "inf", 3);
+        return (size_t)(p - start) + 3;
+    }
+
+    if (biased_e == 0 && sig == 0)
+    {
+        *p = '0';
+        return (size_t)(p - start) + 1;
+    }
+
+    k = grisu2(sig, biased_e, sig_bits, bias, digits, &len);
+    return (size_t)(p - start) + layout_digits(p, digits, len, k);
+}
+
+static inline size_t format_double(char *p, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return format_ieee(p, bits, 52, 11, 1075);
+}
+
+static inline size_t format_float(char *p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return format_ieee(p, bits, 23, 8, 150);
+}
+
+//----------------------------------------------------------------------------
+// dispatch
+
+// Formats one value of a type into a buffer of at least FORMAT_TEMP_SIZE
+// bytes and returns its length.
+typedef size_t (*format_fn)(char *p, const void *value);
+
+#define DEFINE_CHAR_FORMAT(name, t)                   \
+    static size_t name(char *p, const void *value)    \
+    {                                                 \
+        *p = (char)*(const t *)value;                 \
+        return 1;                                     \
+    }
+
+#define DEFINE_SIGNED_FORMAT(name, t)                 \
+    static size_t name(char *p, const void *value)    \
+    {                                                 \
+        return format_i64(p, *(const t *)value);      \
+    }
+
+#define DEFINE_UNSIGNED_FORMAT(name, t)               \
+    static size_t name(char *p, const void *value)    \
+    {                                                 \
+        return format_u64(p, *(const t *)value);      \
+    }
+
+DEFINE_CHAR_FORMAT    (format_char,               char)
+DEFINE_CHAR_FORMAT    (format_unsigned_char,      unsigned char)
+DEFINE_SIGNED_FORMAT  (format_short,              short)
+DEFINE_UNSIGNED_FORMAT(format_unsigned_short,     unsigned short)
+DEFINE_SIGNED_FORMAT  (format_int,                int)
+DEFINE_UNSIGNED_FORMAT(format_unsigned_int,       unsigned int)
+DEFINE_SIGNED_FORMAT  (format_long,               long)
+DEFINE_UNSIGNED_FORMAT(format_unsigned_long,      unsigned long)
+DEFINE_SIGNED_FORMAT  (format_long_long,          long long)
+DEFINE_UNSIGNED_FORMAT(format_unsigned_long_long, unsigned long long)
+
+static size_t format_float_shortest(char *p, const void *value)
+{
+    return format_float(p, *(const float *)value);
+}
+
+static size_t format_double_shortest(char *p, const void *value)
+{
+    return format_double(p, *(const double *)value);
+}
+
+static size_t format_long_double_shortest(char *p, const void *value)
+{
+    int res = snprintf(p, FORMAT_TEMP_SIZE, "%.21Lg", *(const long double *)value);
+    return res < 0 ? 0 : (size_t)res;
+}
+
+// The formatter for each type, indexed by my_type.
+static const format_fn format_fns[MY_TYPE_MAX] = {
+    format_char,
+    format_unsigned_char,
+    format_short,
+    format_unsigned_short,
+    format_int,
+    format_unsigned_int,
+    format_long,
+    format_unsigned_long,
+    format_long_long,
+    format_unsigned_long_long,
+    format_float_shortest,
+    format_double_shortest,
+    format_long_double_shortest};
+
+// Writes a floating point value the same way as "%f". The output can be
+// hundreds of characters long, so it goes straight to the destination.
+static int format_fixed(const void *value, my_type type, char *buffer, size_t s)
+{
+    switch (type)
+    {
+    case MY_TYPE_FLOAT:       return snprintf(buffer, s, "%f",  *(const float *)value);
+    case MY_TYPE_DOUBLE:      return snprintf(buffer, s, "%f",  *(const double *)value);
+    case MY_TYPE_LONG_DOUBLE: return snprintf(buffer, s, "%Lf", *(const long double *)value);
+    default:                  return -1;
+    }
+}
+
+size_t format_primitive(const void *value, my_type type, float_format ff, char *buffer, size_t s)
+{
+    char temp[FORMAT_TEMP_SIZE];
+    size_t len;
+
+    if (type >= MY_TYPE_MAX)
+        return 0;
+
+    if (ff == FLOAT_FORMAT_FIXED && type >= MY_TYPE_FLOAT)
+    {
+        int res = format_fixed(value, type, buffer, s);
+        return res < 0 ? 0 : (size_t)res;
+    }
+
+    // Format into a temporary buffer first so that a small destination can
+    // be handled like snprintf does.
+    len = format_fns[type](temp, value);
+    if (s > 0)
+    {
+        size_t n = len < s ? len : s - 1;
+        memcpy(buffer, temp, n);
+        buffer[n] = '\0';
+    }
+
+    return len;
+}
+
+size_t format_primitive_batch(const void *values, size_t n, my_type type, float_format ff,
+                              char sep, char *buffer, size_t s, size_t *written)
+{
+    const unsigned char *v = values;
+    size_t size;
+    size_t pos = 0;
+    size_t i = 0;
+
+    *written = 0;
+    if (type >= MY_TYPE_MAX)
+        return 0;
+
+    size = my_type_sizes[type];
+
+    if (ff == FLOAT_FORMAT_FIXED && type >= MY_TYPE_FLOAT)
+    {
+        for (; i < n; i++)
+        {
+            // snprintf needs room for its NUL terminator, which is then
+            // replaced by the separator.
+            int res = format_fixed(v + i * size, type, buffer + pos, s - pos);
+            if (res < 0 || (size_t)res >= s - pos)
+                break;
+            pos += (size_t)res;
+            buffer[pos++] = sep;
+        }
+    }
+    else
+    {
+        // The formatter is looked up once, and values are written directly
+        // into the destination while there is room for the longest output.
+        format_fn fn = format_fns[type];
+
+        for (; i < n; i++)
+        {
+            size_t len;
+
+            if (s - pos > FORMAT_TEMP_SIZE)
+            {
+                len = fn(buffer + pos, v + i * size);
+            }
+            else
+            {
+                char temp[FORMAT_TEMP_SIZE];
+                len = fn(temp, v + i * size);
+                if (len + 1 > s - pos)
+                    break;
+                memcpy(buffer + pos, temp, len);
+            }
+
+            pos += len;
+            buffer[pos++] = sep;
+        }
+    }
+
+    *written = pos;
+    return i;
+}
@@ -0,0 +1,60 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+#include "convert.h"
+
+// How float, double and long double values are written.
+typedef enum float_format
+{
+    // The fewest digits that read back as the same value, like 3.14 or
+    // 1e+300. long double values always use "%.21Lg", since the 64-bit
+    // arithmetic used for float and double can't represent their boundaries.
+    FLOAT_FORMAT_SHORTEST = 0,
+
+    // The same output as printf with "%f".
+    FLOAT_FORMAT_FIXED,
+} float_format;
+
+/**
+ * Converts a primitive to a string of char without going through a format
+ * string for integers. Characters are written as-is, like "%c".
+ * The output is truncated and NUL-terminated if it doesn't fit, the same way
+ * snprintf would.
+ *
+ * Params:
+ *   const void* - a pointer to the value to convert
+ *   my_type - a type enumeration of the value's type
+ *   float_format - how floating point values are written
+ *   char* - a pointer to a char buffer
+ *   size_t - the size of the buffer
+ *
+ * Returns:
+ *   size_t - the length of the complete output, not including the NUL
+ *            terminator, or 0 if the type is invalid
+ */
+size_t format_primitive(const void *value, my_type type, float_format ff, char *buffer, size_t s);
+
+/**
+ * Converts an array of primitives into one contiguous buffer.
+ * Each value is followed by a separator character, and no NUL terminator
+ * is written. Conversion stops at the first value that doesn't fit.
+ *
+ * Params:
+ *   const void* - a pointer to an array of values of one type
+ *   size_t - the number of values
+ *   my_type - a type enumeration of every value's type
+ *   float_format - how floating point values are written
+ *   char - the character written after each value
+ *   char* - a pointer to a char buffer
+ *   size_t - the size of the buffer
+ *   size_t* - receives the number of bytes written to the buffer
+ *
+ * Returns:
+ *   size_t - the number of values that were written
+ */
+size_t format_primitive_batch(const void *values, size_t n, my_type type, float_format ff,
+                              char sep, char *buffer, size_t s, size_t *written);
+
+#endif
@@ -1,2 +1,7 @@
+SRC = column.c convert.c format.c
+
 all:
-	gcc -Wall -Werror main.c -o strings.out
+	gcc -Wall -Werror main.c $(SRC) -o strings.out
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.out
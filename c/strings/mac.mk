@@ -1,2 +1,7 @@
+SRC = column.c convert.c format.c
+
 all:
-	clang -Wall -Werror main.c -o strings.out
+	clang -Wall -Werror main.c $(SRC) -o strings.out
+
+bench:
+	clang -Wall -Werror -O2 bench.c $(SRC) -o bench.out
@@ -2,8 +2,10 @@
 //
 // The conversion of string to primitive is handled by the strtol function
 // and its friends like strtoll and strtof.
-// The conversion of primitives to strings is handled by snprintf.
 // These functions are available as of the C99 standard.
+// The conversion of primitives to strings is handled by format_primitive
+// from format.c, which writes integers and characters with a digit lookup
+// table and uses snprintf only for floating point values.
 //
 // The str_to_primitive and primitive_to_str rely on casting to and from a
 // void pointer, which is a feature that is either concealed, discouraged
@@ -12,178 +14,13 @@
 // way we do here. It's a little disappointing that newer languages try
 // to obscure this important functionality, but it's probably for the best.
 
-#include <errno.h>
-#include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
-#include <limits.h>
 
-#define CONV_BUFF_SIZE 64
-
-// an enum could also be defined as
-// enum my_enum { A, B, C };
-// but then it would need to be used like so:
-// enum my_enum e = A;
-// By wrapping it in a typedef, it can be used like:
-// my_enum e = A;
-typedef enum my_type
-{
-    MY_TYPE_CHAR = 0,
-    MY_TYPE_UNSIGNED_CHAR,
-    MY_TYPE_SHORT,
-    MY_TYPE_UNSIGNED_SHORT,
-    MY_TYPE_INT,
-    MY_TYPE_UNSIGNED_INT,
-    MY_TYPE_LONG,
-    MY_TYPE_UNSIGNED_LONG,
-    MY_TYPE_LONG_LONG,
-    MY_TYPE_UNSIGNED_LONG_LONG,
-    MY_TYPE_FLOAT,
-    MY_TYPE_DOUBLE,
-    MY_TYPE_LONG_DOUBLE,
-    MY_TYPE_MAX,
-} my_type;
-
-const char *my_type_names[MY_TYPE_MAX] = {
-    "char",
-    "unsigned char",
-    "short",
-    "unsigned short",
-    "int",
-    "unsigned int",
-    "long",
-    "unsigned long",
-    "long long",
-    "unsigned long long",
-    "float",
-    "double",
-    "long double"};
-
-// Assigns a long value, v, to a destination pointed to by pointer p.
-// The value is cast as type t.
-#define as_value(t,v,p) *((t*) p) = (t)v
-
-/**
- * Converts a NUL-terminated string into one of the primitive types.
- *
- * Params:
- *   const char* - a pointer to a string of characters
- *   my_type - a type enumeration of the value's type
- *   void* - a pointer to the destination for the converted value
- * 
- * Returns:
- *   int - 0 on success, 1 on failure
- */
-int str_to_primitive(const char *str, my_type type, void *dest)
-{
-    if (type >= MY_TYPE_MAX)
-        return 1;
+#include "column.h"
+#include "convert.h"
+#include "format.h"
 
-    // This function relies on the following functions defined as part of the
-    // C99 standard:
-    //   strtol
-    //   strtoul
-    //   strtoll
-    //   strtoull
-    //   strtof
-    //   strtod
-    //   strtold
-    //
-    // Notes on strtol from https://en.cppreference.com/w/c/string/byte/strtol
-    // Ignores leading whitespace.
-    // The string may start with an optional plus or minus sign.
-    // The string may start with an optional 0 for octal or 0x or 0X for hexadecimal.
-    // If the base is 0, then the base is detected automatically.
-    // If the source string is empty or malformed, no conversion occurs.
-    //
-    // On success, the integer representation of the string is returned.
-    // If the integer value is out of range, then LONG_MIN or LONG_MAX is
-    // returned and errno is set to ERANGE.
-    // If no conversion is possible, then 0 is returned.
-
-    long               l_res;
-    unsigned long      ul_res;
-    long long          ll_res;
-    unsigned long long ull_res;
-    float              f_res;
-    double             d_res;
-    long double        ld_res;
-
-    if      (type <= MY_TYPE_LONG)               l_res   = strtol   (str, NULL, 10);
-    else if (type == MY_TYPE_UNSIGNED_LONG)      ul_res  = strtoul  (str, NULL, 10);
-    else if (type == MY_TYPE_LONG_LONG)          ll_res  = strtoll  (str, NULL, 10);
-    else if (type == MY_TYPE_UNSIGNED_LONG_LONG) ull_res = strtoull (str, NULL, 10);
-    else if (type == MY_TYPE_FLOAT)              f_res   = strtof   (str, NULL);
-    else if (type == MY_TYPE_DOUBLE)             d_res   = strtod   (str, NULL);
-    else if (type == MY_TYPE_LONG_DOUBLE)        ld_res  = strtold  (str, NULL);
-
-    if (errno == ERANGE)
-        return 1;
-
-    switch (type)
-    {
-    case MY_TYPE_CHAR:               as_value(char,               l_res,   dest);  return 0;
-    case MY_TYPE_UNSIGNED_CHAR:      as_value(unsigned char,      l_res,   dest);  return 0;
-    case MY_TYPE_SHORT:              as_value(short,              l_res,   dest);  return 0;
-    case MY_TYPE_UNSIGNED_SHORT:     as_value(unsigned short,     l_res,   dest);  return 0;
-    case MY_TYPE_INT:                as_value(int,                l_res,   dest);  return 0;
-    case MY_TYPE_UNSIGNED_INT:       as_value(unsigned int,       l_res,   dest);  return 0;
-    case MY_TYPE_LONG:               as_value(long,               l_res,   dest);  return 0;
-    case MY_TYPE_UNSIGNED_LONG:      as_value(unsigned long,      ul_res,  dest);  return 0;
-    case MY_TYPE_LONG_LONG:          as_value(long long,          ll_res,  dest);  return 0;
-    case MY_TYPE_UNSIGNED_LONG_LONG: as_value(unsigned long long, ull_res, dest);  return 0;
-    case MY_TYPE_FLOAT:              as_value(float,              f_res,   dest);  return 0;
-    case MY_TYPE_DOUBLE:             as_value(double,             d_res,   dest);  return 0;
-    case MY_TYPE_LONG_DOUBLE:        as_value(long double,        ld_res,  dest);  return 0;
-    default: return 0;
-    }
-}
-
-/**
- * Converts a primitive to a string of char.
- * 
- * Params:
- *   void* - a pointer to the value to convert
- *   my_type - a type enumeration of the value's type
- *   char* - a pointer to a char buffer
- * 
- * Returns:
- *   int - 0 on success, 1 on failure
- */
-int primitive_to_str(void* value, my_type type, char* buffer, size_t s)
-{
-    // This function relies on snprintf to convert strings.
-    //
-    // Notes on snprintf from https://en.cppreference.com/w/c/io/fprintf
-    // Writes the results to a character string buffer.
-    // At most bufsz - 1 characters are written.
-    // The resulting character string will be terminated with a null character, unless bufsz is zero.
-    // If bufsz is zero, nothing is written and buffer may be a null pointer,
-    // however the return value (number of bytes that would be written not including the null terminator)
-    // is still calculated and returned.
-
-    int res = 0;
-
-    switch (type)
-    {
-    case MY_TYPE_CHAR:               res = snprintf(buffer, s, "%c",   *(char*)value);               break;
-    case MY_TYPE_UNSIGNED_CHAR:      res = snprintf(buffer, s, "%c",   *(unsigned char*)value);      break;
-    case MY_TYPE_SHORT:              res = snprintf(buffer, s, "%hd",  *(short*)value);              break;
-    case MY_TYPE_UNSIGNED_SHORT:     res = snprintf(buffer, s, "%hu",  *(unsigned short*)value);     break;
-    case MY_TYPE_INT:                res = snprintf(buffer, s, "%d",   *(int*)value);                break;
-    case MY_TYPE_UNSIGNED_INT:       res = snprintf(buffer, s, "%u",   *(unsigned int*)value);       break;
-    case MY_TYPE_LONG:               res = snprintf(buffer, s, "%ld",  *(long*)value);               break;
-    case MY_TYPE_UNSIGNED_LONG:      res = snprintf(buffer, s, "%ld",  *(unsigned long*)value);      break;
-    case MY_TYPE_LONG_LONG:          res = snprintf(buffer, s, "%lld", *(long long*)value);          break;
-    case MY_TYPE_UNSIGNED_LONG_LONG: res = snprintf(buffer, s, "%llu", *(unsigned long long*)value); break;
-    case MY_TYPE_FLOAT:              res = snprintf(buffer, s, "%f",   *(float*)value);              break;
-    case MY_TYPE_DOUBLE:             res = snprintf(buffer, s, "%f",   *(double*)value);             break;
-    case MY_TYPE_LONG_DOUBLE:        res = snprintf(buffer, s, "%Lf",  *(long double*)value);        break;
-    default: break;
-    }
-
-    return res >= 0;
-}
+#define CONV_BUFF_SIZE 64
 
 int main()
 {
@@ -291,5 +128,80 @@ int main()
     printf("double:             %s\n", double_buf);
     printf("long double:        %s\n", long_double_buf);
 
+    printf("\n");
+
+    // convert a whole array of strings at once
+    const char *batch_strs[] = {"24601", "1776", "-2319", "42", "99999999999"};
+    size_t batch_size = sizeof(batch_strs) / sizeof(batch_strs[0]);
+    int batch_nums[sizeof(batch_strs) / sizeof(batch_strs[0])] = {0};
+
+    int batch_res = str_to_primitive_batch(batch_strs, batch_size, MY_TYPE_INT, batch_nums);
+
+    printf("+-------------------------------------+\n");
+    printf("|       batch string to primitive     |\n");
+    printf("+-------------------------------------+\n");
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        printf("%-19s %d\n", batch_strs[i], batch_nums[i]);
+    }
+    printf("result:             %s\n", batch_res ? "at least one value did not fit" : "success");
+
+    printf("\n");
+
+    // write floating point values with the fewest digits that read back as
+    // the same value, and write many values into one buffer
+    char shortest_buf[CONV_BUFF_SIZE];
+    char batch_buf[CONV_BUFF_SIZE];
+    size_t batch_len;
+
+    printf("+-------------------------------------+\n");
+    printf("|       shortest and batch output     |\n");
+    printf("+-------------------------------------+\n");
+    format_primitive(&float_num, MY_TYPE_FLOAT, FLOAT_FORMAT_SHORTEST, shortest_buf, CONV_BUFF_SIZE);
+    printf("float:              %s\n", shortest_buf);
+    format_primitive(&double_num, MY_TYPE_DOUBLE, FLOAT_FORMAT_SHORTEST, shortest_buf, CONV_BUFF_SIZE);
+    printf("double:             %s\n", shortest_buf);
+
+    format_primitive_batch(batch_nums, batch_size, MY_TYPE_INT, FLOAT_FORMAT_SHORTEST, ',',
+                           batch_buf, CONV_BUFF_SIZE - 1, &batch_len);
+    batch_buf[batch_len] = '\0';
+    printf("int batch:          %s\n", batch_buf);
+
+    printf("\n");
+
+    // read lines of numeric text into one array per column
+    char csv[] = "1,19.99,3\n"
+                 "2,4.5,12\n"
+                 "3,100.25,1\n";
+    const my_type csv_types[] = {MY_TYPE_INT, MY_TYPE_DOUBLE, MY_TYPE_UNSIGNED_INT};
+    column_buffer table;
+    char table_buf[CONV_BUFF_SIZE];
+    size_t table_len;
+    double total = 0;
+
+    column_buffer_init(&table, csv_types, sizeof(csv_types) / sizeof(csv_types[0]));
+    int table_res = column_buffer_append_text(&table, csv, ',');
+
+    // every price is next to the others in memory, and so is every quantity
+    const double *prices = table.cols[1].data;
+    const unsigned int *quantities = table.cols[2].data;
+    for (size_t i = 0; i < table.rows; i++)
+    {
+        total += prices[i] * quantities[i];
+    }
+
+    printf("+-------------------------------------+\n");
+    printf("|       columns                       |\n");
+    printf("+-------------------------------------+\n");
+    printf("result:             %s\n", table_res ? "at least one line did not fit" : "success");
+    printf("rows:               %zu\n", table.rows);
+    printf("total:              %.2f\n", total);
+
+    column_buffer_write(&table, 0, table.rows, FLOAT_FORMAT_SHORTEST, ';', table_buf, CONV_BUFF_SIZE - 1, &table_len);
+    table_buf[table_len] = '\0';
+    printf("written back:\n%s", table_buf);
+
+    column_buffer_free(&table);
+
     return 0;
 }
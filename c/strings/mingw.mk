@@ -1,2 +1,7 @@
+SRC = column.c convert.c format.c
+
 all:
-	gcc -Wall -Werror main.c -o strings.exe
+	gcc -Wall -Werror main.c $(SRC) -o strings.exe
+
+bench:
+	gcc -Wall -Werror -O2 bench.c $(SRC) -o bench.exe
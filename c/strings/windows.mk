@@ -1,2 +1,7 @@
+SRC = column.c convert.c format.c
+
 all:
-	cl /W3 /WX main.c /Fe"strings.exe"
+	cl /W3 /WX main.c $(SRC) /Fe"strings.exe"
+
+bench:
+	cl /W3 /WX /O2 bench.c $(SRC) /Fe"bench.exe"
@@ -0,0 +1,155 @@
+#ifndef BAGEL_HPP
+#define BAGEL_HPP
+
+#include <cstring>
+
+#include "log_sink.hpp"
+#include "string_table.hpp"
+
+enum Flavor
+{
+    PLAIN = 0,
+    BLUEBERRY,
+    CINNAMON,
+    BAGEL_FLAVOR_MAX
+};
+
+// A handle to a flavor name in Bagel::BagelNames. The handles of the Flavor
+// values are the values themselves, and BAGEL_FLAVOR_MAX is "none".
+typedef StringHandle FlavorHandle;
+
+class Data
+{
+public:
+    int num;
+
+    // num is written to bagel snapshots, so it must never be left
+    // uninitialized.
+    Data() : num(0)
+    {
+    }
+
+    Data(int num)
+    {
+        this->num = num;
+    }
+};
+
+// a plain old regular class
+class Bagel
+{
+private:
+    // Every flavor name is stored once, so a bagel only holds a handle to its
+    // name instead of a copy of it.
+    static StringTable BagelNames;
+
+    // A common convention is to use the m_ prefix for member variables.
+    int m_ID;
+
+    // This creates an instance of the Data class.
+    // If this instance is not created in a member initializer list, it will
+    // be instantiated with the default constructor.
+    Data m_Data;
+
+    FlavorHandle m_Flavor;
+
+public:
+    int Price;
+
+    // default constructor
+    // This will be present event if we don't define it.
+    // When using a member initializer list, the members should be initialized
+    // in the order they were declared.
+    Bagel() : m_ID(0), m_Data(0xBEEF), m_Flavor(BAGEL_FLAVOR_MAX), Price(0) // member initializer list
+    {
+    }
+
+    // parameterized constructor
+    Bagel(int id)
+    {
+        m_ID = id;
+        Price = 0;
+        m_Flavor = BAGEL_FLAVOR_MAX;
+    }
+
+    // destructor (automatically called when the class is deleted)
+    ~Bagel()
+    {
+    }
+
+    Bagel(int id, int price, enum Flavor name)
+    {
+        m_ID = id;
+        Price = price;
+        m_Flavor = name >= BAGEL_FLAVOR_MAX || name < 0 ? BAGEL_FLAVOR_MAX : name;
+    }
+
+    // Creates a bagel with a flavor from RegisterFlavor.
+    Bagel(int id, int price, FlavorHandle flavor)
+    {
+        m_ID = id;
+        Price = price;
+        m_Flavor = BagelNames.Contains(flavor) ? flavor : BAGEL_FLAVOR_MAX;
+    }
+
+    // A constructor can call another constructor of the same class in its
+    // member initializer list.
+    Bagel(int id, int price, FlavorHandle flavor, Data data) : Bagel(id, price, flavor)
+    {
+        m_Data = data;
+    }
+
+    // Adds a flavor that isn't in the Flavor enum, or gets the handle of one
+    // that's already known.
+    static FlavorHandle RegisterFlavor(std::string_view name)
+    {
+        return BagelNames.Intern(name);
+    }
+
+    // Gets the name of a flavor, or "none" if it isn't a flavor.
+    static const char *FlavorName(FlavorHandle flavor)
+    {
+        return BagelNames.Name(BagelNames.Contains(flavor) ? flavor : BAGEL_FLAVOR_MAX);
+    }
+
+    // The number of flavors, including "none". Handles go from 0 up to one
+    // less than this.
+    static size_t FlavorCount()
+    {
+        return BagelNames.Size();
+    }
+
+    int ID() const
+    {
+        return m_ID;
+    }
+
+    FlavorHandle GetFlavor() const
+    {
+        return m_Flavor;
+    }
+
+    const Data &GetData() const
+    {
+        return m_Data;
+    }
+
+    const char *Name() const
+    {
+        return BagelNames.Name(m_Flavor);
+    }
+
+    void Describe()
+    {
+        Log().Line("ID: ", m_ID, ", name: ", Name(), ", price: ", Price);
+    }
+};
+
+// The inline keyword from C++ 17 lets the definition live in a header that
+// is included by more than one source file.
+inline StringTable Bagel::BagelNames = {"plain",
+                                        "blueberry",
+                                        "cinnamon",
+                                        "none"};
+
+#endif
@@ -0,0 +1,294 @@
+// A catalog of bagels keyed by ID that many threads can use at once.
+//
+// The inventory is a hash table with a fixed number of slots and linear
+// probing, where every slot holds the bagel's ID, its Data, and a single
+// 64-bit word that holds its price and flavor. A bagel's Data is written
+// once, before the word is published, and never changes. The price and
+// flavor can change, but because they are one word they can't be seen half
+// updated, and:
+//
+// - Find and GetPrice are wait-free. They never retry, and never wait for a
+//   thread that is writing.
+// - Insert is lock-free. A thread claims an empty slot with a
+//   compare-and-swap, so a stalled thread can't stop the others.
+// - SetPrice is wait-free, and AddToPrice is lock-free.
+// - ForEach reads the entries one at a time without blocking anyone. Each
+//   entry it gives is consistent, but entries that change while it runs may
+//   be seen before or after the change.
+//
+// This is the same idea as a sequence lock on each entry. But everything
+// that can change fits in one word, so the version number and the retry
+// loop aren't needed.
+//
+// Bagels can't be removed, and the table doesn't grow, so the capacity must
+// be chosen up front. Flavors should be registered with Bagel::RegisterFlavor
+// before other threads start using the inventory, because the table of
+// flavor names isn't thread safe.
+
+#ifndef BAGEL_INVENTORY_HPP
+#define BAGEL_INVENTORY_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+
+#include "bagel.hpp"
+
+// The ID that marks an empty slot, which can't be used by a bagel.
+#define INVENTORY_EMPTY_ID INT_MIN
+
+// Whether a price and flavor have been stored in a slot.
+#define INVENTORY_PRESENT (1ULL << 63)
+
+class BagelInventory
+{
+public:
+    // Creates an inventory with room for a number of bagels. The table has
+    // at least twice as many slots so that probe sequences stay short.
+    explicit BagelInventory(size_t capacity) : m_Size(0)
+    {
+        m_SlotCount = 16;
+        while (m_SlotCount < capacity * 2)
+            m_SlotCount *= 2;
+        m_Capacity = capacity;
+
+        m_Slots.reset(new Slot[m_SlotCount]);
+        for (size_t i = 0; i < m_SlotCount; i++)
+        {
+            m_Slots[i].id.store(INVENTORY_EMPTY_ID, std::memory_order_relaxed);
+            m_Slots[i].data.store(0, std::memory_order_relaxed);
+            m_Slots[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    BagelInventory(const BagelInventory &) = delete;
+    BagelInventory &operator=(const BagelInventory &) = delete;
+
+    // Adds a bagel.
+    //
+    // Returns:
+    //   bool - false if a bagel with the same ID is already in the inventory
+    //          or being added by another thread, the ID is
+    //          INVENTORY_EMPTY_ID, or the inventory is full
+    bool Insert(const Bagel &bagel)
+    {
+        return Insert(bagel.ID(), bagel.Price, bagel.GetFlavor(), bagel.GetData());
+    }
+
+    bool Insert(int id, int price, FlavorHandle flavor, Data data = Data(0))
+    {
+        if (id == INVENTORY_EMPTY_ID)
+            return false;
+
+        // Reserve room first, so that a full table never has to be probed
+        // all the way around.
+        size_t size = m_Size.load(std::memory_order_relaxed);
+        do
+        {
+            if (size >= m_Capacity)
+                return false;
+        } while (!m_Size.compare_exchange_weak(size, size + 1, std::memory_order_relaxed));
+
+        for (size_t i = Hash(id);; i = (i + 1) & (m_SlotCount - 1))
+        {
+            int found = m_Slots[i].id.load(std::memory_order_acquire);
+            if (found == INVENTORY_EMPTY_ID &&
+                m_Slots[i].id.compare_exchange_strong(found, id, std::memory_order_acq_rel))
+            {
+                // The slot is ours. Readers that find the ID before this
+                // store don't see the bagel yet, and readers that see the
+                // bagel see its data too.
+                m_Slots[i].data.store(data.num, std::memory_order_relaxed);
+                m_Slots[i].value.store(Pack(price, flavor), std::memory_order_release);
+                return true;
+            }
+
+            // The compare-and-swap put the ID that won the slot in found.
+            if (found == id)
+            {
+                m_Size.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+    }
+
+    // Gets a copy of a bagel.
+    //
+    // Returns:
+    //   bool - false if no bagel has the ID
+    bool Find(int id, Bagel &bagel) const
+    {
+        Slot *slot = FindSlot(id);
+        uint64_t value;
+
+        if (slot == nullptr || !((value = slot->value.load(std::memory_order_acquire)) & INVENTORY_PRESENT))
+            return false;
+
+        bagel = ToBagel(id, *slot, value);
+        return true;
+    }
+
+    bool GetPrice(int id, int &price) const
+    {
+        uint64_t value;
+        if (!Load(id, value))
+            return false;
+
+        price = UnpackPrice(value);
+        return true;
+    }
+
+    // Changes the price of a bagel. A bagel's flavor never changes, so this
+    // is a single store.
+    //
+    // Returns:
+    //   bool - false if no bagel has the ID
+    bool SetPrice(int id, int price)
+    {
+        Slot *slot = FindSlot(id);
+        uint64_t value;
+
+        if (slot == nullptr || !((value = slot->value.load(std::memory_order_acquire)) & INVENTORY_PRESENT))
+            return false;
+
+        slot->value.store(Pack(price, UnpackFlavor(value)), std::memory_order_release);
+        return true;
+    }
+
+    // Adds to the price of a bagel, without losing changes made by other
+    // threads at the same time.
+    //
+    // Returns:
+    //   bool - false if no bagel has the ID
+    bool AddToPrice(int id, int amount, int *newPrice = nullptr)
+    {
+        Slot *slot = FindSlot(id);
+        if (slot == nullptr)
+            return false;
+
+        std::atomic<uint64_t> &word = slot->value;
+        uint64_t value = word.load(std::memory_order_acquire);
+        uint64_t next;
+        do
+        {
+            if (!(value & INVENTORY_PRESENT))
+                return false;
+            next = Pack(UnpackPrice(value) + amount, UnpackFlavor(value));
+        } while (!word.compare_exchange_weak(value, next, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        if (newPrice != nullptr)
+            *newPrice = UnpackPrice(next);
+        return true;
+    }
+
+    // Calls a function with a copy of every bagel, in no particular order.
+    template <typename F>
+    void ForEach(F &&f) const
+    {
+        for (size_t i = 0; i < m_SlotCount; i++)
+        {
+            int id = m_Slots[i].id.load(std::memory_order_acquire);
+            if (id == INVENTORY_EMPTY_ID)
+                continue;
+
+            uint64_t value = m_Slots[i].value.load(std::memory_order_acquire);
+            if (value & INVENTORY_PRESENT)
+                f(ToBagel(id, m_Slots[i], value));
+        }
+    }
+
+    // Describes every bagel, in no particular order.
+    void Describe() const
+    {
+        ForEach([](Bagel bagel) { bagel.Describe(); });
+    }
+
+    // The number of bagels that have been added, counting any that are being
+    // added right now.
+    size_t Size() const
+    {
+        return m_Size.load(std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const
+    {
+        return m_Capacity;
+    }
+
+private:
+    // Slots are packed 4 to a cache line rather than padded, since the
+    // inventory is meant for reading far more than for writing. The data
+    // fits in what would otherwise be padding after the ID.
+    struct Slot
+    {
+        std::atomic<int> id;
+        std::atomic<int> data;
+        std::atomic<uint64_t> value;
+    };
+
+    static_assert(sizeof(Slot) == 16, "slots are packed 4 to a cache line");
+
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t m_SlotCount;
+    size_t m_Capacity;
+    std::atomic<size_t> m_Size;
+
+    size_t Hash(int id) const
+    {
+        // Fibonacci hashing spreads out IDs that are close together.
+        uint64_t h = static_cast<uint32_t>(id) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h >> 32) & (m_SlotCount - 1);
+    }
+
+    static uint64_t Pack(int price, FlavorHandle flavor)
+    {
+        return INVENTORY_PRESENT | (static_cast<uint64_t>(flavor) << 32) | static_cast<uint32_t>(price);
+    }
+
+    static int UnpackPrice(uint64_t value)
+    {
+        return static_cast<int>(static_cast<uint32_t>(value));
+    }
+
+    static FlavorHandle UnpackFlavor(uint64_t value)
+    {
+        return static_cast<FlavorHandle>(value >> 32);
+    }
+
+    // Makes a copy of a bagel from its slot and a value loaded with acquire
+    // ordering, which makes the data stored before it visible.
+    static Bagel ToBagel(int id, const Slot &slot, uint64_t value)
+    {
+        return Bagel(id, UnpackPrice(value), UnpackFlavor(value), Data(slot.data.load(std::memory_order_relaxed)));
+    }
+
+    // Gets the slot with an ID, or nullptr if there isn't one. The table is
+    // never full, so an empty slot always ends the search.
+    Slot *FindSlot(int id) const
+    {
+        if (id == INVENTORY_EMPTY_ID)
+            return nullptr;
+
+        for (size_t i = Hash(id);; i = (i + 1) & (m_SlotCount - 1))
+        {
+            int found = m_Slots[i].id.load(std::memory_order_acquire);
+            if (found == id)
+                return &m_Slots[i];
+            if (found == INVENTORY_EMPTY_ID)
+                return nullptr;
+        }
+    }
+
+    bool Load(int id, uint64_t &value) const
+    {
+        Slot *slot = FindSlot(id);
+        if (slot == nullptr)
+            return false;
+
+        value = slot->value.load(std::memory_order_acquire);
+        return (value & INVENTORY_PRESENT) != 0;
+    }
+};
+
+#endif
@@ -0,0 +1,499 @@
+// A compact binary format for saving and loading many bagels at once.
+//
+// Describe writes a bagel as text, which is easy to read but slow to write,
+// slower to parse, and about twice the size. A snapshot stores each bagel as
+// a 16-byte record of fixed-width little-endian fields, so it reads back the
+// same on any machine:
+//
+//   offset  size  field
+//   0       4     ID
+//   4       4     price
+//   8       4     data
+//   12      2     flavor code
+//   14      2     reserved, 0
+//
+// Flavor handles are only meaningful inside the program that made them, so
+// a snapshot starts with the names of its flavors, and each record stores
+// the flavor's code in that list. The codes of the Flavor enum values are
+// the values themselves. When a snapshot is loaded, every name is passed to
+// Bagel::RegisterFlavor, so flavors added at runtime come back too.
+//
+// The whole snapshot is:
+//
+//   header          32 bytes, see BagelSnapshotHeader
+//   flavor names    a 2-byte length and the text of each name, padded to a
+//                   multiple of 8 bytes
+//   records         record size * count bytes
+//
+// The header holds a version, which only changes when old loaders can't
+// read the format any more, and the size of a record. A loader skips any
+// bytes at the end of a record that it doesn't know about, so fields can be
+// added to the end without a new version.
+//
+// The file functions map the file into memory with mmap and encode or
+// decode the records in place, so the data is never copied through a
+// separate buffer. On Windows they use stdio instead. A snapshot is saved to
+// a ".tmp" file beside the target, flushed to disk, and then renamed over
+// it, so the old snapshot stays whole until the new one is.
+
+#ifndef BAGEL_SNAPSHOT_HPP
+#define BAGEL_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#endif
+
+#include "bagel.hpp"
+
+#define BAGEL_SNAPSHOT_MAGIC "BAGL"
+#define BAGEL_SNAPSHOT_VERSION 1
+#define BAGEL_SNAPSHOT_HEADER_SIZE 32
+#define BAGEL_RECORD_SIZE 16
+
+// The number of records the Windows versions encode or decode at a time.
+#define BAGEL_SNAPSHOT_CHUNK_RECORDS 4096
+
+struct BagelSnapshotHeader
+{
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t flavorCount;
+    uint32_t flavorTableSize; // including padding
+    uint64_t recordCount;
+};
+
+inline void StoreLE16(unsigned char *p, uint16_t value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+inline void StoreLE32(unsigned char *p, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)(value >> (8 * i));
+}
+
+inline void StoreLE64(unsigned char *p, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (unsigned char)(value >> (8 * i));
+}
+
+inline uint16_t LoadLE16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+inline uint32_t LoadLE32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline uint64_t LoadLE64(const unsigned char *p)
+{
+    return (uint64_t)LoadLE32(p) | (uint64_t)LoadLE32(p + 4) << 32;
+}
+
+/**
+ * Writes a bagel as a record.
+ *
+ * Params:
+ *   const Bagel& - the bagel
+ *   unsigned char* - where to write BAGEL_RECORD_SIZE bytes
+ */
+inline void EncodeBagel(const Bagel &bagel, unsigned char *record)
+{
+    StoreLE32(record, (uint32_t)bagel.ID());
+    StoreLE32(record + 4, (uint32_t)bagel.Price);
+    StoreLE32(record + 8, (uint32_t)bagel.GetData().num);
+    StoreLE16(record + 12, bagel.GetFlavor());
+    StoreLE16(record + 14, 0);
+}
+
+/**
+ * Reads a bagel from a record.
+ *
+ * Params:
+ *   const unsigned char* - the record
+ *   const std::vector<FlavorHandle>& - the handle of each flavor code in the
+ *                                      snapshot
+ *   Bagel& - the bagel
+ *
+ * Returns:
+ *   bool - false if the flavor code isn't in the snapshot
+ */
+inline bool DecodeBagel(const unsigned char *record, const std::vector<FlavorHandle> &flavors, Bagel &bagel)
+{
+    uint16_t code = LoadLE16(record + 12);
+    if (code >= flavors.size())
+        return false;
+
+    bagel = Bagel((int)LoadLE32(record), (int)LoadLE32(record + 4), flavors[code], Data((int)LoadLE32(record + 8)));
+    return true;
+}
+
+/**
+ * Gets the size of the flavor names part of a snapshot of every flavor
+ * registered so far.
+ *
+ * Returns:
+ *   size_t - the size in bytes, including padding
+ */
+inline size_t BagelFlavorTableSize()
+{
+    size_t size = 0;
+    for (size_t i = 0; i < Bagel::FlavorCount(); i++)
+        size += 2 + strlen(Bagel::FlavorName((FlavorHandle)i));
+    return (size + 7) & ~(size_t)7;
+}
+
+/**
+ * Gets the size of a snapshot.
+ *
+ * Params:
+ *   size_t - the number of bagels
+ *
+ * Returns:
+ *   size_t - the size in bytes
+ */
+inline size_t BagelSnapshotSize(size_t count)
+{
+    return BAGEL_SNAPSHOT_HEADER_SIZE + BagelFlavorTableSize() + count * BAGEL_RECORD_SIZE;
+}
+
+/**
+ * Writes the header and flavor names of a snapshot.
+ *
+ * Params:
+ *   size_t - the number of bagels that will follow
+ *   unsigned char* - where to write BagelSnapshotSize(0) bytes
+ *
+ * Returns:
+ *   size_t - the number of bytes written, which is where the records start
+ */
+inline size_t WriteBagelSnapshotHeader(size_t count, unsigned char *dest)
+{
+    size_t tableSize = BagelFlavorTableSize();
+    unsigned char *p = dest + BAGEL_SNAPSHOT_HEADER_SIZE;
+
+    memset(dest, 0, BAGEL_SNAPSHOT_HEADER_SIZE + tableSize);
+    memcpy(dest, BAGEL_SNAPSHOT_MAGIC, 4);
+    StoreLE16(dest + 4, BAGEL_SNAPSHOT_VERSION);
+    StoreLE16(dest + 6, BAGEL_RECORD_SIZE);
+    StoreLE32(dest + 8, (uint32_t)Bagel::FlavorCount());
+    StoreLE32(dest + 12, (uint32_t)tableSize);
+    StoreLE64(dest + 16, count);
+
+    for (size_t i = 0; i < Bagel::FlavorCount(); i++)
+    {
+        const char *name = Bagel::FlavorName((FlavorHandle)i);
+        size_t length = strlen(name);
+        StoreLE16(p, (uint16_t)length);
+        memcpy(p + 2, name, length);
+        p += 2 + length;
+    }
+
+    return BAGEL_SNAPSHOT_HEADER_SIZE + tableSize;
+}
+
+/**
+ * Writes a snapshot of some bagels.
+ *
+ * Params:
+ *   const Bagel* - the bagels
+ *   size_t - the number of bagels
+ *   unsigned char* - where to write BagelSnapshotSize(count) bytes
+ *
+ * Returns:
+ *   size_t - the number of bytes written
+ */
+inline size_t WriteBagelSnapshot(const Bagel *bagels, size_t count, unsigned char *dest)
+{
+    unsigned char *p = dest + WriteBagelSnapshotHeader(count, dest);
+    for (size_t i = 0; i < count; i++, p += BAGEL_RECORD_SIZE)
+        EncodeBagel(bagels[i], p);
+    return (size_t)(p - dest);
+}
+
+/**
+ * Checks the header and flavor names of a snapshot, without registering
+ * any flavors.
+ *
+ * Params:
+ *   const unsigned char* - the snapshot
+ *   size_t - the size of the snapshot, or at least of its header and
+ *            flavor names
+ *   BagelSnapshotHeader& - the header
+ *
+ * Returns:
+ *   size_t - where the records start, or 0 if the snapshot isn't valid or
+ *            is from a version this code doesn't know
+ */
+inline size_t CheckBagelSnapshotHeader(const unsigned char *src, size_t size, BagelSnapshotHeader &header)
+{
+    if (size < BAGEL_SNAPSHOT_HEADER_SIZE || memcmp(src, BAGEL_SNAPSHOT_MAGIC, 4) != 0)
+        return 0;
+
+    header.version = LoadLE16(src + 4);
+    header.recordSize = LoadLE16(src + 6);
+    header.flavorCount = LoadLE32(src + 8);
+    header.flavorTableSize = LoadLE32(src + 12);
+    header.recordCount = LoadLE64(src + 16);
+
+    // A program can't have more flavors than its StringTable holds, so
+    // neither can a snapshot it wrote.
+    if (header.version == 0 || header.version > BAGEL_SNAPSHOT_VERSION || header.recordSize < BAGEL_RECORD_SIZE ||
+        header.flavorCount > STRING_TABLE_MAX_SIZE || header.flavorTableSize > size - BAGEL_SNAPSHOT_HEADER_SIZE)
+        return 0;
+
+    const unsigned char *p = src + BAGEL_SNAPSHOT_HEADER_SIZE;
+    const unsigned char *end = p + header.flavorTableSize;
+    for (uint32_t i = 0; i < header.flavorCount; i++)
+    {
+        if (end - p < 2 || end - p - 2 < LoadLE16(p))
+            return 0;
+        p += 2 + LoadLE16(p);
+    }
+
+    return BAGEL_SNAPSHOT_HEADER_SIZE + header.flavorTableSize;
+}
+
+/**
+ * Reads the header and flavor names of a snapshot, registering any flavors
+ * that aren't known yet. Nothing is registered unless the whole header and
+ * flavor table are valid.
+ *
+ * Params:
+ *   const unsigned char* - the snapshot
+ *   size_t - the size of the snapshot, or at least of its header and
+ *            flavor names
+ *   BagelSnapshotHeader& - the header
+ *   std::vector<FlavorHandle>& - the handle of each flavor code
+ *
+ * Returns:
+ *   size_t - where the records start, or 0 if the snapshot isn't valid, is
+ *            from a version this code doesn't know, or has more new
+ *            flavors than there is room for
+ */
+inline size_t ReadBagelSnapshotHeader(const unsigned char *src, size_t size, BagelSnapshotHeader &header,
+                                      std::vector<FlavorHandle> &flavors)
+{
+    size_t start = CheckBagelSnapshotHeader(src, size, header);
+    if (start == 0)
+        return 0;
+
+    const unsigned char *p = src + BAGEL_SNAPSHOT_HEADER_SIZE;
+    flavors.clear();
+    try
+    {
+        for (uint32_t i = 0; i < header.flavorCount; i++)
+        {
+            size_t length = LoadLE16(p);
+            flavors.push_back(Bagel::RegisterFlavor(std::string_view((const char *)p + 2, length)));
+            p += 2 + length;
+        }
+    }
+    catch (const std::length_error &)
+    {
+        // The names from this snapshot and the ones already registered
+        // don't all fit in the flavor table.
+        return 0;
+    }
+
+    return start;
+}
+
+/**
+ * Reads a snapshot, adding its bagels to the end of a vector.
+ *
+ * Params:
+ *   const unsigned char* - the snapshot
+ *   size_t - the size of the snapshot
+ *   std::vector<Bagel>& - the bagels
+ *
+ * Returns:
+ *   bool - false if the snapshot isn't valid, in which case the vector
+ *          isn't changed
+ */
+inline bool ReadBagelSnapshot(const unsigned char *src, size_t size, std::vector<Bagel> &bagels)
+{
+    BagelSnapshotHeader header;
+    std::vector<FlavorHandle> flavors;
+    size_t start = CheckBagelSnapshotHeader(src, size, header);
+
+    if (start == 0 || header.recordCount > (size - start) / header.recordSize)
+        return false;
+
+    // Every flavor code is checked before any name is registered, so an
+    // invalid snapshot doesn't add flavors to the program.
+    const unsigned char *p = src + start;
+    for (size_t i = 0; i < header.recordCount; i++, p += header.recordSize)
+    {
+        if (LoadLE16(p + 12) >= header.flavorCount)
+            return false;
+    }
+
+    if (ReadBagelSnapshotHeader(src, size, header, flavors) == 0)
+        return false;
+
+    size_t before = bagels.size();
+    bagels.resize(before + header.recordCount);
+
+    p = src + start;
+    for (size_t i = 0; i < header.recordCount; i++, p += header.recordSize)
+        DecodeBagel(p, flavors, bagels[before + i]);
+    return true;
+}
+
+#ifndef _WIN32
+/**
+ * Saves a snapshot of some bagels to a file, replacing it if it exists.
+ *
+ * Params:
+ *   const char* - the path of the file
+ *   const Bagel* - the bagels
+ *   size_t - the number of bagels
+ *
+ * Returns:
+ *   bool - false if the file couldn't be written
+ */
+inline bool SaveBagelSnapshot(const char *path, const Bagel *bagels, size_t count)
+{
+    // The snapshot is written next to the file and renamed over it once it
+    // is on disk, so a crash never leaves a file that is half written.
+    std::string temp = std::string(path) + ".tmp";
+    size_t size = BagelSnapshotSize(count);
+    int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    // The blocks are allocated up front, so a full disk is an error here
+    // rather than a SIGBUS while writing to the mapping.
+#ifdef __linux__
+    bool ok = posix_fallocate(fd, 0, (off_t)size) == 0;
+#else
+    bool ok = ftruncate(fd, (off_t)size) == 0;
+#endif
+    void *map = ok ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map != MAP_FAILED)
+    {
+        WriteBagelSnapshot(bagels, count, (unsigned char *)map);
+        ok = msync(map, size, MS_SYNC) == 0;
+        ok = munmap(map, size) == 0 && ok;
+    }
+    else
+        ok = false;
+
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path) != 0)
+    {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Loads a snapshot from a file, adding its bagels to the end of a vector.
+ *
+ * Params:
+ *   const char* - the path of the file
+ *   std::vector<Bagel>& - the bagels
+ *
+ * Returns:
+ *   bool - false if the file couldn't be read or isn't a valid snapshot
+ */
+inline bool LoadBagelSnapshot(const char *path, std::vector<Bagel> &bagels)
+{
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    // The records are read once from start to end.
+    madvise(map, size, MADV_SEQUENTIAL);
+    bool ok = ReadBagelSnapshot((const unsigned char *)map, size, bagels);
+    munmap(map, size);
+    return ok;
+}
+#else
+inline bool SaveBagelSnapshot(const char *path, const Bagel *bagels, size_t count)
+{
+    std::string temp = std::string(path) + ".tmp";
+    std::vector<unsigned char> buffer(BagelSnapshotSize(0) + BAGEL_SNAPSHOT_CHUNK_RECORDS * BAGEL_RECORD_SIZE);
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (f == NULL)
+        return false;
+
+    size_t used = WriteBagelSnapshotHeader(count, buffer.data());
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i += BAGEL_SNAPSHOT_CHUNK_RECORDS)
+    {
+        size_t n = count - i < BAGEL_SNAPSHOT_CHUNK_RECORDS ? count - i : BAGEL_SNAPSHOT_CHUNK_RECORDS;
+        for (size_t k = 0; k < n; k++, used += BAGEL_RECORD_SIZE)
+            EncodeBagel(bagels[i + k], buffer.data() + used);
+        ok = fwrite(buffer.data(), 1, used, f) == used;
+        used = 0;
+    }
+    if (ok && used > 0)
+        ok = fwrite(buffer.data(), 1, used, f) == used;
+
+    ok = ok && fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool LoadBagelSnapshot(const char *path, std::vector<Bagel> &bagels)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+
+    std::vector<unsigned char> data;
+    unsigned char chunk[BAGEL_SNAPSHOT_CHUNK_RECORDS * BAGEL_RECORD_SIZE];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+
+    return ReadBagelSnapshot(data.data(), data.size(), bagels);
+}
+#endif
+
+#endif
@@ -0,0 +1,374 @@
+// A collection of bagels stored as a struct of arrays.
+//
+// std::vector<Bagel> keeps each bagel's ID, data, flavor and price together,
+// so a loop that only looks at prices still pulls everything else through
+// the cache. BagelStore keeps each member in its own array instead. Queries
+// over prices and flavors read only those arrays, and work on 8 bagels at a
+// time with AVX2 when the CPU has it. Flavors are FlavorHandles, so flavors
+// added with Bagel::RegisterFlavor can be stored and queried too.
+//
+// Iterating over a store gives BagelView objects, which refer to one bagel's
+// entries in the arrays and can be used much like a Bagel.
+
+#ifndef BAGEL_STORE_HPP
+#define BAGEL_STORE_HPP
+
+#include <climits>
+#include <cstddef>
+#include <vector>
+
+#include "bagel.hpp"
+
+// The AVX2 queries use GCC/Clang target attributes so that they can be
+// compiled without -mavx2 and selected at runtime.
+// Other compilers and architectures only get the scalar loops.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BAGEL_STORE_HAVE_AVX2
+#include <immintrin.h>
+#define BAGEL_STORE_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#endif
+
+// Selects bagels by flavor and price. BAGEL_FLAVOR_MAX matches every flavor.
+struct BagelQuery
+{
+    FlavorHandle flavor = BAGEL_FLAVOR_MAX;
+    int minPrice = INT_MIN;
+    int maxPrice = INT_MAX;
+};
+
+class BagelStore;
+
+// One bagel in a BagelStore. A view is only valid until the store changes
+// size.
+class BagelView
+{
+public:
+    BagelView(BagelStore *store, size_t index) : m_Store(store), m_Index(index)
+    {
+    }
+
+    int ID() const;
+    int Price() const;
+    void SetPrice(int price);
+    FlavorHandle GetFlavor() const;
+    Data &GetData() const;
+
+    const char *Name() const
+    {
+        return Bagel::FlavorName(GetFlavor());
+    }
+
+    // Creates a separate Bagel with the same ID, price, flavor and data.
+    Bagel ToBagel() const
+    {
+        return Bagel(ID(), Price(), GetFlavor(), GetData());
+    }
+
+    void Describe() const
+    {
+        Log().Line("ID: ", ID(), ", name: ", Name(), ", price: ", Price());
+    }
+
+private:
+    BagelStore *m_Store;
+    size_t m_Index;
+};
+
+class BagelStore
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(BagelStore *store, size_t index) : m_Store(store), m_Index(index)
+        {
+        }
+
+        BagelView operator*() const
+        {
+            return BagelView(m_Store, m_Index);
+        }
+
+        Iterator &operator++()
+        {
+            m_Index++;
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return m_Index == other.m_Index;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return m_Index != other.m_Index;
+        }
+
+    private:
+        BagelStore *m_Store;
+        size_t m_Index;
+    };
+
+    void Reserve(size_t count)
+    {
+        m_IDs.reserve(count);
+        m_Prices.reserve(count);
+        m_Flavors.reserve(count);
+        m_Data.reserve(count);
+    }
+
+    // Adds a bagel, the same way as Bagel(id, price, flavor). The flavor can
+    // be a Flavor or a handle from Bagel::RegisterFlavor.
+    void Add(int id, int price, FlavorHandle flavor, Data data = Data(0))
+    {
+        m_IDs.push_back(id);
+        m_Prices.push_back(price);
+        m_Flavors.push_back(flavor < Bagel::FlavorCount() ? flavor : BAGEL_FLAVOR_MAX);
+        m_Data.push_back(data);
+    }
+
+    size_t Size() const
+    {
+        return m_IDs.size();
+    }
+
+    BagelView operator[](size_t index)
+    {
+        return BagelView(this, index);
+    }
+
+    Iterator begin()
+    {
+        return Iterator(this, 0);
+    }
+
+    Iterator end()
+    {
+        return Iterator(this, Size());
+    }
+
+    // The prices of every bagel, in the order they were added.
+    const std::vector<int> &Prices() const
+    {
+        return m_Prices;
+    }
+
+    // Adds up the prices of every bagel.
+    long long SumPrices() const
+    {
+        return SumPrices(BagelQuery());
+    }
+
+    // Adds up the prices of the bagels that match a query.
+    long long SumPrices(const BagelQuery &query) const
+    {
+        long long sum = 0;
+        size_t i = 0;
+
+#ifdef BAGEL_STORE_HAVE_AVX2
+        if (HaveAVX2())
+            i = SumAVX2(query, sum);
+#endif
+
+        for (; i < Size(); i++)
+        {
+            if (Matches(query, i))
+                sum += m_Prices[i];
+        }
+        return sum;
+    }
+
+    // Gets the lowest and highest prices of the bagels that match a query.
+    //
+    // Returns:
+    //   bool - false if no bagel matches, in which case the prices are not
+    //          changed
+    bool PriceRange(int &minPrice, int &maxPrice, const BagelQuery &query = BagelQuery()) const
+    {
+        int lo = INT_MAX;
+        int hi = INT_MIN;
+        size_t count = 0;
+        size_t i = 0;
+
+#ifdef BAGEL_STORE_HAVE_AVX2
+        if (HaveAVX2())
+            i = PriceRangeAVX2(query, lo, hi, count);
+#endif
+
+        for (; i < Size(); i++)
+        {
+            if (Matches(query, i))
+            {
+                lo = m_Prices[i] < lo ? m_Prices[i] : lo;
+                hi = m_Prices[i] > hi ? m_Prices[i] : hi;
+                count++;
+            }
+        }
+
+        if (count == 0)
+            return false;
+
+        minPrice = lo;
+        maxPrice = hi;
+        return true;
+    }
+
+    // Appends the index of every bagel that matches a query, in order.
+    //
+    // Returns:
+    //   size_t - the number of indices appended
+    size_t Filter(const BagelQuery &query, std::vector<size_t> &indices) const
+    {
+        size_t before = indices.size();
+        size_t i = 0;
+
+#ifdef BAGEL_STORE_HAVE_AVX2
+        if (HaveAVX2())
+            i = FilterAVX2(query, indices);
+#endif
+
+        for (; i < Size(); i++)
+        {
+            if (Matches(query, i))
+                indices.push_back(i);
+        }
+        return indices.size() - before;
+    }
+
+private:
+    friend class BagelView;
+
+    std::vector<int> m_IDs;
+    std::vector<int> m_Prices;
+    std::vector<FlavorHandle> m_Flavors;
+    std::vector<Data> m_Data;
+
+    bool Matches(const BagelQuery &query, size_t i) const
+    {
+        return (query.flavor == BAGEL_FLAVOR_MAX || m_Flavors[i] == query.flavor) && m_Prices[i] >= query.minPrice &&
+               m_Prices[i] <= query.maxPrice;
+    }
+
+#ifdef BAGEL_STORE_HAVE_AVX2
+    static bool HaveAVX2()
+    {
+        static const bool have = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+        return have;
+    }
+
+    // Sets every lane of the result for the 8 bagels starting at i that
+    // match a query. Flavors are 16 bits, so 8 of them are loaded at once and
+    // widened to 32-bit lanes to line up with the prices.
+    BAGEL_STORE_TARGET_AVX2 __m256i MatchAVX2(const BagelQuery &query, size_t i) const
+    {
+        static_assert(sizeof(FlavorHandle) == 2, "flavors are loaded as 16-bit lanes");
+
+        __m256i prices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m_Prices.data() + i));
+        __m256i match = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(query.minPrice), prices),
+                                                            _mm256_cmpgt_epi32(prices, _mm256_set1_epi32(query.maxPrice))),
+                                            _mm256_set1_epi32(-1));
+        if (query.flavor != BAGEL_FLAVOR_MAX)
+        {
+            __m256i flavors =
+                _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(m_Flavors.data() + i)));
+            match = _mm256_and_si256(match, _mm256_cmpeq_epi32(flavors, _mm256_set1_epi32(query.flavor)));
+        }
+        return match;
+    }
+
+    // Each of these handles whole groups of 8 bagels and returns the index
+    // of the first bagel it didn't look at.
+
+    BAGEL_STORE_TARGET_AVX2 size_t SumAVX2(const BagelQuery &query, long long &sum) const
+    {
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+
+        for (; i + 8 <= Size(); i += 8)
+        {
+            __m256i prices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m_Prices.data() + i));
+            prices = _mm256_and_si256(prices, MatchAVX2(query, i));
+
+            // Widen to 64 bits so that millions of prices can't overflow.
+            total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(prices)));
+            total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(prices, 1)));
+        }
+
+        sum += _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) + _mm256_extract_epi64(total, 2) +
+               _mm256_extract_epi64(total, 3);
+        return i;
+    }
+
+    BAGEL_STORE_TARGET_AVX2 size_t PriceRangeAVX2(const BagelQuery &query, int &lo, int &hi, size_t &count) const
+    {
+        __m256i low = _mm256_set1_epi32(INT_MAX);
+        __m256i high = _mm256_set1_epi32(INT_MIN);
+        int lanes[8];
+        size_t i = 0;
+
+        for (; i + 8 <= Size(); i += 8)
+        {
+            __m256i prices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m_Prices.data() + i));
+            __m256i match = MatchAVX2(query, i);
+
+            // Lanes that don't match are replaced with values that can't
+            // change the result.
+            low = _mm256_min_epi32(low, _mm256_blendv_epi8(_mm256_set1_epi32(INT_MAX), prices, match));
+            high = _mm256_max_epi32(high, _mm256_blendv_epi8(_mm256_set1_epi32(INT_MIN), prices, match));
+            count += (size_t)__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(match)));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), low);
+        for (int k = 0; k < 8; k++)
+            lo = lanes[k] < lo ? lanes[k] : lo;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), high);
+        for (int k = 0; k < 8; k++)
+            hi = lanes[k] > hi ? lanes[k] : hi;
+        return i;
+    }
+
+    BAGEL_STORE_TARGET_AVX2 size_t FilterAVX2(const BagelQuery &query, std::vector<size_t> &indices) const
+    {
+        size_t i = 0;
+
+        for (; i + 8 <= Size(); i += 8)
+        {
+            unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(MatchAVX2(query, i)));
+            while (bits != 0)
+            {
+                indices.push_back(i + _tzcnt_u32(bits));
+                bits &= bits - 1;
+            }
+        }
+        return i;
+    }
+#endif
+};
+
+inline int BagelView::ID() const
+{
+    return m_Store->m_IDs[m_Index];
+}
+
+inline int BagelView::Price() const
+{
+    return m_Store->m_Prices[m_Index];
+}
+
+inline void BagelView::SetPrice(int price)
+{
+    m_Store->m_Prices[m_Index] = price;
+}
+
+inline FlavorHandle BagelView::GetFlavor() const
+{
+    return m_Store->m_Flavors[m_Index];
+}
+
+inline Data &BagelView::GetData() const
+{
+    return m_Store->m_Data[m_Index];
+}
+
+#endif
@@ -0,0 +1,1198 @@
+// Benchmarks for the classes examples.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// The stress benchmark checks the results of the concurrent inventory, the
+// log and snapshot benchmarks check what they read back, and the arena
+// benchmark checks buffers with mixed alignments. They exit with an error
+// if anything is wrong.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "bagel.hpp"
+#include "bagel_inventory.hpp"
+#include "bagel_snapshot.hpp"
+#include "bagel_store.hpp"
+#include "fish.hpp"
+#include "log_sink.hpp"
+#include "memory.hpp"
+
+#define BENCH_DEFAULT_COUNT 1000000
+
+// The number of buffers allocated while handling one request in the arena
+// benchmark.
+#define BENCH_BUFFERS_PER_REQUEST 32
+
+// The block size of the arena in the mixed alignment run. It's small, so
+// most requests cross several blocks, and odd, so the end of a block isn't
+// aligned, like a block made for one large allocation.
+#define BENCH_MIXED_BLOCK_SIZE 4093
+
+// The number of times the fish benchmark goes through every fish.
+#define BENCH_FISH_PASSES 10
+
+// The number of times the store benchmark runs each query.
+#define BENCH_STORE_PASSES 10
+
+// The number of times the construct benchmark fills its vector.
+#define BENCH_CONSTRUCT_PASSES 10
+
+// The number of lookups made by each reader thread in the inventory
+// benchmark.
+#define BENCH_INVENTORY_READS (1 << 20)
+
+// The most reader threads the inventory benchmark uses, unless the machine
+// has more cores.
+#define BENCH_INVENTORY_THREADS 8
+
+// The number of times each writer thread in the stress benchmark changes
+// every price.
+#define BENCH_STRESS_ROUNDS 20
+
+// The most threads the log benchmark uses, unless the machine has more
+// cores.
+#define BENCH_LOG_THREADS 4
+
+typedef unsigned char my_byte;
+
+typedef void (*BenchFn)(size_t);
+
+struct Bench
+{
+    const char *name;
+    BenchFn run;
+};
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double NowSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Gets the amount of memory the process currently has in RAM.
+ *
+ * Returns:
+ *   long - the resident set size in kilobytes, or -1 if it isn't known on
+ *          this platform
+ */
+static long ResidentKilobytes()
+{
+#ifdef __linux__
+    long pages = -1;
+    long resident = -1;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return -1;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        resident = -1;
+    fclose(f);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    return -1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// arena: request-scoped my_byte buffers from new[], ArenaResource and
+// std::pmr::monotonic_buffer_resource
+
+/**
+ * Gets the size of every buffer allocated by one request.
+ *
+ * Params:
+ *   size_t* - receives BENCH_BUFFERS_PER_REQUEST sizes between 16 and 1039
+ *   unsigned long long& - the state of the random number generator
+ */
+static void RequestSizes(size_t *sizes, unsigned long long &seed)
+{
+    for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        sizes[i] = 16 + (size_t)((seed >> 33) % 1024);
+    }
+}
+
+static void ReportRate(const char *name, size_t count, double seconds)
+{
+    printf("  %-36s %10.2f ns/alloc %8.1f M allocs/s\n", name, seconds * 1e9 / (double)count,
+           (double)count / seconds / 1e6);
+}
+
+template <typename Resource>
+static double RunRequests(Resource &resource, size_t requests, unsigned long long &check)
+{
+    size_t sizes[BENCH_BUFFERS_PER_REQUEST];
+    unsigned long long seed = 24601;
+    double start = NowSeconds();
+
+    for (size_t r = 0; r < requests; r++)
+    {
+        RequestSizes(sizes, seed);
+        for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+        {
+            my_byte *data = static_cast<my_byte *>(resource.allocate(sizes[i], alignof(my_byte)));
+            data[0] = (my_byte)i;
+            data[sizes[i] - 1] = (my_byte)r;
+            check += data[0] + data[sizes[i] - 1];
+        }
+
+        if constexpr (std::is_same_v<Resource, ArenaResource>)
+            resource.Reset();
+        else
+            resource.release();
+    }
+
+    return NowSeconds() - start;
+}
+
+static void ArenaFailed(const char *what, size_t request, int i)
+{
+    fprintf(stderr, "arena: %s (request %zu, buffer %d)\n", what, request, i);
+    exit(1);
+}
+
+/**
+ * Allocates buffers of odd sizes with no alignment, each followed by one
+ * that needs 8 to 64 byte alignment, so the padding for alignment often
+ * runs past the end of a block. Every buffer is filled and checked before
+ * the arena is reset, so a buffer placed outside its block or over another
+ * one is found.
+ *
+ * Params:
+ *   ArenaResource& - the arena
+ *   size_t - the number of requests
+ *   unsigned long long& - receives a checksum
+ *
+ * Returns:
+ *   double - the time taken in seconds
+ */
+static double RunMixedRequests(ArenaResource &arena, size_t requests, unsigned long long &check)
+{
+    size_t sizes[BENCH_BUFFERS_PER_REQUEST];
+    my_byte *buffers[BENCH_BUFFERS_PER_REQUEST];
+    unsigned long long seed = 24601;
+    double start = NowSeconds();
+
+    for (size_t r = 0; r < requests; r++)
+    {
+        RequestSizes(sizes, seed);
+        for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+        {
+            size_t alignment = i % 2 == 0 ? 1 : (size_t)8 << (i / 2 % 4);
+            size_t size = i % 2 == 0 ? sizes[i] | 1 : sizes[i];
+
+            sizes[i] = size;
+            buffers[i] = static_cast<my_byte *>(arena.allocate(size, alignment));
+            if (reinterpret_cast<uintptr_t>(buffers[i]) % alignment != 0)
+                ArenaFailed("a buffer isn't aligned", r, i);
+            memset(buffers[i], i, size);
+        }
+
+        for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+        {
+            if (buffers[i][0] != (my_byte)i || buffers[i][sizes[i] - 1] != (my_byte)i)
+                ArenaFailed("a buffer was overwritten", r, i);
+            check += buffers[i][sizes[i] - 1];
+        }
+
+        arena.Reset();
+    }
+
+    return NowSeconds() - start;
+}
+
+static void BenchArena(size_t count)
+{
+    size_t requests = count / BENCH_BUFFERS_PER_REQUEST;
+    size_t allocs = requests * BENCH_BUFFERS_PER_REQUEST;
+    unsigned long long check = 0;
+    double start;
+
+    printf("arena: %zu requests of %d buffers\n", requests, BENCH_BUFFERS_PER_REQUEST);
+
+    {
+        size_t sizes[BENCH_BUFFERS_PER_REQUEST];
+        my_byte *buffers[BENCH_BUFFERS_PER_REQUEST];
+        unsigned long long seed = 24601;
+
+        start = NowSeconds();
+        for (size_t r = 0; r < requests; r++)
+        {
+            RequestSizes(sizes, seed);
+            for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+            {
+                buffers[i] = new my_byte[sizes[i]];
+                buffers[i][0] = (my_byte)i;
+                buffers[i][sizes[i] - 1] = (my_byte)r;
+                check += buffers[i][0] + buffers[i][sizes[i] - 1];
+            }
+            for (int i = 0; i < BENCH_BUFFERS_PER_REQUEST; i++)
+                delete[] buffers[i];
+        }
+        ReportRate("new[] and delete[]", allocs, NowSeconds() - start);
+    }
+
+    {
+        ArenaResource arena;
+        ReportRate("ArenaResource", allocs, RunRequests(arena, requests, check));
+    }
+
+    {
+        std::pmr::monotonic_buffer_resource monotonic(ARENA_DEFAULT_BLOCK_SIZE);
+        ReportRate("std::pmr::monotonic_buffer_resource", allocs, RunRequests(monotonic, requests, check));
+    }
+
+    {
+        ArenaResource arena(BENCH_MIXED_BLOCK_SIZE);
+        ReportRate("ArenaResource, mixed alignment", allocs, RunMixedRequests(arena, requests, check));
+    }
+
+    printf("  (check %llX)\n", check);
+}
+
+//----------------------------------------------------------------------------
+// pool: Bagel objects from new, PoolResource and
+// std::pmr::unsynchronized_pool_resource
+
+template <typename Create, typename Destroy>
+static void RunBagels(const char *name, size_t count, std::vector<Bagel *> &bagels, Create create, Destroy destroy)
+{
+    long rss = ResidentKilobytes();
+    double start;
+    double seconds;
+
+    // Every bagel is kept alive while the memory is measured, so memory freed
+    // by an earlier run can't hide how much this one needs.
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i++)
+        bagels[i] = create(i);
+    seconds = NowSeconds() - start;
+
+    if (rss >= 0)
+        rss = ResidentKilobytes() - rss;
+
+    // Churn: replace every other bagel, the way objects in a long running
+    // program are created and destroyed in no particular order.
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i += 2)
+    {
+        destroy(bagels[i]);
+        bagels[i] = create(i);
+    }
+    seconds += NowSeconds() - start;
+
+    ReportRate(name, count + (count + 1) / 2, seconds);
+    if (rss >= 0)
+        printf("  %-36s %10.1f bytes/bagel (RSS)\n", "", (double)rss * 1024.0 / (double)count);
+}
+
+static void BenchPool(size_t count)
+{
+    std::vector<Bagel *> global(count);
+    std::vector<Bagel *> pooled(count);
+    std::vector<Bagel *> standard(count);
+    PoolResource pool(sizeof(Bagel), alignof(Bagel));
+    std::pmr::unsynchronized_pool_resource standardPool;
+
+    printf("pool: %zu bagels of %zu bytes\n", count, sizeof(Bagel));
+
+    RunBagels("new and delete", count, global,
+              [](size_t i) { return new Bagel((int)i, 100, PLAIN); },
+              [](Bagel *b) { delete b; });
+
+    RunBagels("PoolResource", count, pooled,
+              [&](size_t i) { return NewObject<Bagel>(&pool, (int)i, 100, PLAIN); },
+              [&](Bagel *b) { DeleteObject(&pool, b); });
+
+    RunBagels("std::pmr::unsynchronized_pool_resource", count, standard,
+              [&](size_t i) { return NewObject<Bagel>(&standardPool, (int)i, 100, PLAIN); },
+              [&](Bagel *b) { DeleteObject(&standardPool, b); });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        delete global[i];
+        DeleteObject(&pool, pooled[i]);
+        DeleteObject(&standardPool, standard[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// fish: virtual calls through std::vector<Fish *> versus std::variant and
+// FishTank
+
+// What doFishThings does, without printing. A character that differs between
+// the types is taken from each message and mixed into the check, so no call
+// can be skipped and the check depends on the order of the fish.
+template <typename T>
+static inline void FishThings(T &fish, unsigned long long &check)
+{
+    check = check * 31 + (unsigned char)fish.Bloop()[4];
+    check = check * 31 + (unsigned char)fish.Floop()[4];
+    check = check * 31 + (unsigned char)fish.Sploop()[4];
+}
+
+template <typename Run>
+static void RunFish(const char *name, size_t count, Run run)
+{
+    unsigned long long check = 0;
+    double start = NowSeconds();
+
+    for (int pass = 0; pass < BENCH_FISH_PASSES; pass++)
+    {
+        run(check);
+    }
+
+    double seconds = NowSeconds() - start;
+    printf("  %-36s %10.2f ns/fish  (check %llX)\n", name, seconds * 1e9 / (double)(count * BENCH_FISH_PASSES),
+           check);
+}
+
+static void BenchFish(size_t count)
+{
+    std::vector<Fish *> mixed;
+    std::vector<Fish *> grouped;
+    std::vector<std::variant<Amberjack, Gar>> variants;
+    FishTank<Amberjack, Gar> tank;
+    unsigned long long seed = 24601;
+
+    printf("fish: %zu fish of 2 types in random order, %d passes\n", count, BENCH_FISH_PASSES);
+
+    mixed.reserve(count);
+    variants.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        if ((seed >> 63) != 0)
+        {
+            mixed.push_back(new Amberjack());
+            variants.emplace_back(Amberjack());
+            tank.Add(Amberjack());
+        }
+        else
+        {
+            mixed.push_back(new Gar());
+            variants.emplace_back(Gar());
+            tank.Add(Gar());
+        }
+    }
+
+    // The same objects sorted by type, so the CPU can predict the calls, but
+    // still looks them up in the vtable.
+    for (Fish *fish : mixed)
+    {
+        if (fish->ID() == 1)
+            grouped.push_back(fish);
+    }
+    for (Fish *fish : mixed)
+    {
+        if (fish->ID() != 1)
+            grouped.push_back(fish);
+    }
+
+    // The grouped runs visit the types in the same order as FishTank, so
+    // they should all have the same check, and the mixed runs should match
+    // each other.
+    RunFish("std::vector<Fish *>", count, [&](unsigned long long &check) {
+        for (Fish *fish : mixed)
+            FishThings(*fish, check);
+    });
+
+    RunFish("std::variant and std::visit", count, [&](unsigned long long &check) {
+        for (auto &fish : variants)
+            std::visit([&](auto &f) { FishThings(f, check); }, fish);
+    });
+
+    RunFish("std::vector<Fish *> grouped by type", count, [&](unsigned long long &check) {
+        for (Fish *fish : grouped)
+            FishThings(*fish, check);
+    });
+
+    RunFish("FishTank::ForEach", count, [&](unsigned long long &check) {
+        tank.ForEach([&](auto &fish) { FishThings(fish, check); });
+    });
+
+    for (Fish *fish : mixed)
+    {
+        delete fish;
+    }
+}
+
+//----------------------------------------------------------------------------
+// store: price queries over std::vector<Bagel> versus BagelStore
+
+template <typename Query>
+static void RunQuery(const char *name, size_t count, Query query)
+{
+    long long check = 0;
+    double start = NowSeconds();
+
+    for (int pass = 0; pass < BENCH_STORE_PASSES; pass++)
+    {
+        check += query();
+    }
+
+    double seconds = NowSeconds() - start;
+    printf("  %-36s %10.3f ns/bagel  (check %lld)\n", name, seconds * 1e9 / (double)(count * BENCH_STORE_PASSES),
+           check);
+}
+
+static void BenchStore(size_t count)
+{
+    std::vector<Bagel> bagels;
+    BagelStore store;
+    std::vector<size_t> indices;
+    BagelQuery query;
+    unsigned long long seed = 24601;
+
+    printf("store: %zu bagels, %zu bytes each in std::vector<Bagel>, %d passes\n", count, sizeof(Bagel),
+           BENCH_STORE_PASSES);
+
+    bagels.reserve(count);
+    store.Reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int price = 50 + (int)((seed >> 33) % 451);
+        Flavor flavor = (Flavor)((seed >> 20) % BAGEL_FLAVOR_MAX);
+        bagels.emplace_back((int)i, price, flavor);
+        store.Add((int)i, price, flavor);
+    }
+
+    // Blueberry bagels from 100 to 200, which is about 1 in 14 of them.
+    query.flavor = BLUEBERRY;
+    query.minPrice = 100;
+    query.maxPrice = 200;
+
+    RunQuery("sum std::vector<Bagel>", count, [&]() {
+        long long sum = 0;
+        for (const Bagel &b : bagels)
+            sum += b.Price;
+        return sum;
+    });
+    RunQuery("sum BagelStore", count, [&]() { return store.SumPrices(); });
+
+    RunQuery("min/max std::vector<Bagel>", count, [&]() {
+        int lo = INT_MAX;
+        int hi = INT_MIN;
+        for (const Bagel &b : bagels)
+        {
+            lo = b.Price < lo ? b.Price : lo;
+            hi = b.Price > hi ? b.Price : hi;
+        }
+        return (long long)lo * 1000 + hi;
+    });
+    RunQuery("min/max BagelStore", count, [&]() {
+        int lo = 0;
+        int hi = 0;
+        store.PriceRange(lo, hi);
+        return (long long)lo * 1000 + hi;
+    });
+
+    RunQuery("filter std::vector<Bagel>", count, [&]() {
+        indices.clear();
+        for (size_t i = 0; i < bagels.size(); i++)
+        {
+            const Bagel &b = bagels[i];
+            if (b.Price >= query.minPrice && b.Price <= query.maxPrice && b.GetFlavor() == query.flavor)
+                indices.push_back(i);
+        }
+        return (long long)indices.size();
+    });
+    RunQuery("filter BagelStore", count, [&]() {
+        indices.clear();
+        return (long long)store.Filter(query, indices);
+    });
+
+    RunQuery("filtered sum BagelStore", count, [&]() { return store.SumPrices(query); });
+}
+
+//----------------------------------------------------------------------------
+// construct: bagels that copy their name versus bagels with a flavor handle
+
+// How Bagel used to store its name, with its own copy in every object.
+class CopiedNameBagel
+{
+public:
+    char Name[32];
+    int Price;
+
+    CopiedNameBagel(int id, int price, Flavor name) : m_ID(id), m_Data(0)
+    {
+        Price = price;
+        const char *text = Bagel::FlavorName(name);
+        size_t l = strlen(text);
+        for (size_t i = 0; i < l; i++)
+        {
+            Name[i] = text[i];
+        }
+        Name[l] = '\0';
+    }
+
+private:
+    int m_ID;
+    Data m_Data;
+};
+
+static const char *NameOf(const CopiedNameBagel &b)
+{
+    return b.Name;
+}
+
+static const char *NameOf(const Bagel &b)
+{
+    return b.Name();
+}
+
+template <typename T, typename Make>
+static void RunConstruct(const char *name, size_t count, Make make)
+{
+    std::vector<T> bagels;
+    unsigned long long check = 0;
+    double seconds = 0;
+
+    bagels.reserve(count);
+    for (int pass = 0; pass < BENCH_CONSTRUCT_PASSES; pass++)
+    {
+        bagels.clear();
+
+        double start = NowSeconds();
+        for (size_t i = 0; i < count; i++)
+        {
+            bagels.push_back(make(i));
+        }
+        seconds += NowSeconds() - start;
+
+        check += (unsigned char)NameOf(bagels[count / 2])[0] + (unsigned char)NameOf(bagels[count - 1])[1];
+    }
+
+    printf("  %-36s %10.2f ns/bagel %4zu bytes/bagel  (check %llu)\n", name,
+           seconds * 1e9 / (double)(count * BENCH_CONSTRUCT_PASSES), sizeof(T), check);
+}
+
+static void BenchConstruct(size_t count)
+{
+    FlavorHandle everything = Bagel::RegisterFlavor("everything");
+
+    if (count == 0)
+        return;
+
+    printf("construct: %zu bagels, %d passes\n", count, BENCH_CONSTRUCT_PASSES);
+
+    RunConstruct<CopiedNameBagel>("copied name", count, [](size_t i) {
+        return CopiedNameBagel((int)i, 100, (Flavor)(i % BAGEL_FLAVOR_MAX));
+    });
+
+    RunConstruct<Bagel>("Flavor handle", count, [](size_t i) {
+        return Bagel((int)i, 100, (Flavor)(i % BAGEL_FLAVOR_MAX));
+    });
+
+    RunConstruct<Bagel>("registered flavor handle", count, [&](size_t i) {
+        return Bagel((int)i, 100, everything);
+    });
+}
+
+//----------------------------------------------------------------------------
+// inventory: reads from BagelInventory versus a std::unordered_map guarded
+// by a std::mutex, with 1 to N reader threads and one writer
+
+// The same operations as BagelInventory, with a lock around every one.
+class LockedInventory
+{
+public:
+    void Insert(const Bagel &bagel)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Bagels.emplace(bagel.ID(), bagel);
+    }
+
+    bool GetPrice(int id, int &price) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto found = m_Bagels.find(id);
+        if (found == m_Bagels.end())
+            return false;
+        price = found->second.Price;
+        return true;
+    }
+
+    bool AddToPrice(int id, int amount)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto found = m_Bagels.find(id);
+        if (found == m_Bagels.end())
+            return false;
+        found->second.Price += amount;
+        return true;
+    }
+
+private:
+    mutable std::mutex m_Mutex;
+    std::unordered_map<int, Bagel> m_Bagels;
+};
+
+// Runs reader threads that each look up random bagels, while one writer
+// keeps changing prices until they finish.
+//
+// Returns:
+//   double - the total number of lookups per second
+template <typename Inventory>
+static double RunReaders(Inventory &inventory, size_t count, unsigned int readers, unsigned long long &check)
+{
+    std::atomic<bool> start(false);
+    std::atomic<unsigned int> running(readers);
+    std::atomic<unsigned long long> sum(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int t = 0; t < readers; t++)
+    {
+        threads.emplace_back([&, t]() {
+            unsigned long long seed = 24601 + t;
+            unsigned long long local = 0;
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            for (int i = 0; i < BENCH_INVENTORY_READS; i++)
+            {
+                int price = 0;
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                inventory.GetPrice((int)((seed >> 33) % count), price);
+                local += (unsigned int)price;
+            }
+            sum.fetch_add(local);
+            running.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    std::thread writer([&]() {
+        unsigned long long seed = 42;
+        while (!start.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        while (running.load(std::memory_order_acquire) > 0)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            inventory.AddToPrice((int)((seed >> 33) % count), 1);
+        }
+    });
+
+    double begin = NowSeconds();
+    start.store(true, std::memory_order_release);
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = NowSeconds() - begin;
+    writer.join();
+
+    check += sum.load();
+    return (double)readers * BENCH_INVENTORY_READS / seconds;
+}
+
+static void BenchInventory(size_t count)
+{
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    BagelInventory inventory(count);
+    LockedInventory locked;
+    unsigned long long check = 0;
+
+    if (count == 0)
+        return;
+    if (maxThreads < BENCH_INVENTORY_THREADS)
+        maxThreads = BENCH_INVENTORY_THREADS;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Bagel bagel((int)i, 100 + (int)(i % 400), (Flavor)(i % BAGEL_FLAVOR_MAX));
+        inventory.Insert(bagel);
+        locked.Insert(bagel);
+    }
+
+    printf("inventory: %zu bagels, %d reads per thread, 1 writer, %u cores\n", count, BENCH_INVENTORY_READS,
+           std::thread::hardware_concurrency());
+    printf("  %-8s %22s %22s\n", "readers", "BagelInventory", "mutex + unordered_map");
+
+    for (unsigned int readers = 1; readers <= maxThreads; readers *= 2)
+    {
+        double lockFree = RunReaders(inventory, count, readers, check);
+        double mutex = RunReaders(locked, count, readers, check);
+        printf("  %-8u %14.1f M reads/s %14.1f M reads/s\n", readers, lockFree / 1e6, mutex / 1e6);
+    }
+
+    printf("  (check %llX)\n", check);
+}
+
+//----------------------------------------------------------------------------
+// stress: checks BagelInventory while many threads insert, update, read and
+// iterate at the same time
+
+static void StressFailed(const char *what, int id)
+{
+    fprintf(stderr, "stress: %s (ID %d)\n", what, id);
+    exit(1);
+}
+
+static int StressPrice(int id)
+{
+    return id % 1000;
+}
+
+static void StressInventory(size_t count)
+{
+    unsigned int threadCount = std::thread::hardware_concurrency();
+    std::vector<std::thread> threads;
+    std::atomic<size_t> inserted(0);
+    std::atomic<bool> writing(true);
+    int ids = (int)count;
+
+    if (threadCount < 4)
+        threadCount = 4;
+
+    BagelInventory inventory(count);
+
+    printf("stress: %zu bagels, %u threads\n", count, threadCount);
+
+    // Every thread tries to insert every bagel, starting at a different
+    // place, so each insert races with the others.
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&, t]() {
+            size_t mine = 0;
+            for (int i = 0; i < ids; i++)
+            {
+                int id = (int)((i + (size_t)t * ids / threadCount) % ids);
+                if (inventory.Insert(id, StressPrice(id), (FlavorHandle)(id % BAGEL_FLAVOR_MAX), Data(~id)))
+                    mine++;
+            }
+            inserted.fetch_add(mine);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    threads.clear();
+
+    if (inserted.load() != count || inventory.Size() != count)
+        StressFailed("wrong number of bagels inserted", -1);
+    if (inventory.Insert(0, 0, PLAIN) || inventory.Insert(ids, 0, PLAIN))
+        StressFailed("insert succeeded on a duplicate or full inventory", 0);
+
+    // Half the threads add 1 to every price, while the others check that
+    // prices only go up and flavors and data never change, and that
+    // iterating always sees every bagel.
+    unsigned int writers = threadCount / 2;
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        if (t < writers)
+        {
+            threads.emplace_back([&]() {
+                for (int round = 0; round < BENCH_STRESS_ROUNDS; round++)
+                {
+                    for (int id = 0; id < ids; id++)
+                    {
+                        if (!inventory.AddToPrice(id, 1))
+                            StressFailed("a bagel went missing", id);
+                    }
+                }
+            });
+        }
+        else
+        {
+            threads.emplace_back([&]() {
+                std::vector<int> last(count);
+                do
+                {
+                    for (int id = 0; id < ids; id++)
+                    {
+                        Bagel bagel;
+                        if (!inventory.Find(id, bagel))
+                            StressFailed("a bagel went missing", id);
+                        if (bagel.GetFlavor() != id % BAGEL_FLAVOR_MAX)
+                            StressFailed("a flavor changed", id);
+                        if (bagel.GetData().num != ~id)
+                            StressFailed("data was lost", id);
+                        if (bagel.Price < last[id] || bagel.Price < StressPrice(id))
+                            StressFailed("a price went down", id);
+                        last[id] = bagel.Price;
+                    }
+
+                    size_t seen = 0;
+                    inventory.ForEach([&](const Bagel &) { seen++; });
+                    if (seen != count)
+                        StressFailed("iteration missed a bagel", -1);
+                } while (writing.load());
+            });
+        }
+    }
+
+    for (unsigned int t = 0; t < writers; t++)
+        threads[t].join();
+    writing.store(false);
+    for (unsigned int t = writers; t < threadCount; t++)
+        threads[t].join();
+
+    for (int id = 0; id < ids; id++)
+    {
+        int price = 0;
+        if (!inventory.GetPrice(id, price) || price != StressPrice(id) + (int)writers * BENCH_STRESS_ROUNDS)
+            StressFailed("an update was lost", id);
+    }
+
+    printf("  ok\n");
+}
+
+//----------------------------------------------------------------------------
+// snapshot: saving and loading bagels as Describe-style text and as a binary
+// snapshot
+
+// Adds up every field of some bagels, so that two sets can be compared.
+static unsigned long long SumBagels(const std::vector<Bagel> &bagels)
+{
+    unsigned long long sum = 0;
+    for (const Bagel &bagel : bagels)
+    {
+        sum = sum * 31 + (unsigned int)bagel.ID();
+        sum = sum * 31 + (unsigned int)bagel.Price;
+        sum = sum * 31 + (unsigned int)bagel.GetData().num;
+        sum = sum * 31 + bagel.GetFlavor();
+    }
+    return sum;
+}
+
+static void ReportSnapshot(const char *name, size_t count, double seconds, const std::string &path,
+                           unsigned long long check)
+{
+    std::error_code error;
+    double megabytes = (double)std::filesystem::file_size(path, error) / 1e6;
+    printf("  %-22s %8.2f ns/bagel %9.1f MB/s %8.1f MB  (check %llX)\n", name, seconds * 1e9 / (double)count,
+           megabytes / seconds, megabytes, check);
+}
+
+static void BenchSnapshot(size_t count)
+{
+    FlavorHandle everything = Bagel::RegisterFlavor("everything");
+    std::string dir = std::filesystem::temp_directory_path().string();
+    std::string textPath = dir + "/bagel_bench.txt";
+    std::string snapshotPath = dir + "/bagel_bench.snapshot";
+    std::vector<Bagel> bagels;
+    std::vector<Bagel> loaded;
+    double start;
+    double seconds;
+
+    if (count == 0)
+        return;
+
+    bagels.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        FlavorHandle flavor = i % 5 == 4 ? everything : (FlavorHandle)(i % 4);
+        bagels.emplace_back((int)i, 100 + (int)(i % 400), flavor, Data((int)(i * 7)));
+    }
+
+    printf("snapshot: %zu bagels, files in %s\n", count, dir.c_str());
+
+    // Describe's format, with the data added so that the text can be read
+    // back.
+    start = NowSeconds();
+    FILE *f = fopen(textPath.c_str(), "w");
+    if (f == NULL)
+        return;
+    for (const Bagel &bagel : bagels)
+    {
+        fprintf(f, "ID: %d, name: %s, price: %d, data: %d\n", bagel.ID(), bagel.Name(), bagel.Price,
+                bagel.GetData().num);
+    }
+    fclose(f);
+    seconds = NowSeconds() - start;
+    ReportSnapshot("save text", count, seconds, textPath, SumBagels(bagels));
+
+    start = NowSeconds();
+    f = fopen(textPath.c_str(), "r");
+    if (f == NULL)
+        return;
+    loaded.clear();
+    loaded.reserve(count);
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        int id;
+        int price;
+        int data;
+        char name[32];
+        if (sscanf(line, "ID: %d, name: %31[^,], price: %d, data: %d", &id, name, &price, &data) == 4)
+            loaded.emplace_back(id, price, Bagel::RegisterFlavor(name), Data(data));
+    }
+    fclose(f);
+    seconds = NowSeconds() - start;
+    ReportSnapshot("load text", count, seconds, textPath, SumBagels(loaded));
+
+    start = NowSeconds();
+    if (!SaveBagelSnapshot(snapshotPath.c_str(), bagels.data(), bagels.size()))
+    {
+        fprintf(stderr, "snapshot: can't save %s\n", snapshotPath.c_str());
+        exit(1);
+    }
+    seconds = NowSeconds() - start;
+    ReportSnapshot("save snapshot", count, seconds, snapshotPath, SumBagels(bagels));
+
+    start = NowSeconds();
+    loaded.clear();
+    if (!LoadBagelSnapshot(snapshotPath.c_str(), loaded))
+    {
+        fprintf(stderr, "snapshot: can't load %s\n", snapshotPath.c_str());
+        exit(1);
+    }
+    seconds = NowSeconds() - start;
+    ReportSnapshot("load snapshot", count, seconds, snapshotPath, SumBagels(loaded));
+
+    if (SumBagels(loaded) != SumBagels(bagels))
+    {
+        fprintf(stderr, "snapshot: the loaded bagels are different\n");
+        exit(1);
+    }
+
+    std::filesystem::remove(textPath);
+    std::filesystem::remove(snapshotPath);
+}
+
+//----------------------------------------------------------------------------
+// log: std::cout with std::endl against LogSink, with many threads logging
+// lines like Bagel::Describe
+
+#ifndef _WIN32
+// The time each thread took to log each of its lines, in nanoseconds.
+typedef std::vector<std::vector<unsigned int>> LogLatencies;
+
+// Runs a number of threads that each log their share of count lines, and
+// records how long each call took.
+//
+// Returns:
+//   double - the time from the start until the last thread was done, in
+//            seconds
+template <typename LogFn>
+static double RunLoggers(size_t count, unsigned int threadCount, LogLatencies &latencies, LogFn log)
+{
+    std::vector<std::thread> threads;
+    std::atomic<bool> start(false);
+
+    latencies.assign(threadCount, std::vector<unsigned int>());
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&, t]() {
+            std::vector<unsigned int> &mine = latencies[t];
+            size_t lines = count / threadCount;
+            mine.reserve(lines);
+
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            for (size_t i = 0; i < lines; i++)
+            {
+                auto before = std::chrono::steady_clock::now();
+                log(t, (int)i, 100 + (int)(i % 400), Bagel::FlavorName((FlavorHandle)(i % BAGEL_FLAVOR_MAX)));
+                auto after = std::chrono::steady_clock::now();
+                mine.push_back((unsigned int)std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+            }
+        });
+    }
+
+    double begin = NowSeconds();
+    start.store(true, std::memory_order_release);
+    for (std::thread &thread : threads)
+        thread.join();
+    return NowSeconds() - begin;
+}
+
+static void ReportLoggers(const char *name, unsigned int threadCount, double seconds, LogLatencies &latencies)
+{
+    std::vector<unsigned int> all;
+    for (std::vector<unsigned int> &mine : latencies)
+        all.insert(all.end(), mine.begin(), mine.end());
+    if (all.empty())
+        return;
+
+    std::sort(all.begin(), all.end());
+    auto at = [&](double fraction) { return all[(size_t)(fraction * (double)(all.size() - 1))]; };
+
+    printf("  %-20s %7u %10.2f M lines/s %8u %8u %8u %10u\n", name, threadCount, (double)all.size() / seconds / 1e6,
+           at(0.5), at(0.99), at(0.999), all.back());
+}
+
+// Logs lines from many threads to a temporary file, and checks that every
+// line was written once and in one piece.
+static bool CheckLogSink(size_t count, unsigned int threadCount)
+{
+    FILE *f = tmpfile();
+    if (f == NULL)
+        return false;
+
+    {
+        // A small ring, so that the threads have to wait for the writer.
+        LogSink sink(fileno(f), 64);
+        LogLatencies latencies;
+        RunLoggers(count, threadCount, latencies, [&](unsigned int t, int id, int price, const char *name) {
+            sink.Line("thread ", t, " ID: ", id, ", name: ", name, ", price: ", price);
+        });
+        // A line longer than the whole ring.
+        sink.Write(std::string(64 * LOG_SLOT_SIZE * 2, '-') + "\n");
+    }
+
+    std::vector<int> next(threadCount, 0);
+    char line[128];
+    bool ok = true;
+
+    rewind(f);
+    while (ok && fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned int t;
+        int id;
+        int price;
+        char name[32];
+
+        if (line[0] == '-')
+        {
+            // The long line is read in pieces.
+            continue;
+        }
+        if (sscanf(line, "thread %u ID: %d, name: %31[a-z], price: %d", &t, &id, name, &price) != 4 ||
+            t >= threadCount || id != next[t] || price != 100 + id % 400 ||
+            strcmp(name, Bagel::FlavorName((FlavorHandle)(id % BAGEL_FLAVOR_MAX))) != 0)
+        {
+            fprintf(stderr, "log: bad line: %s", line);
+            ok = false;
+        }
+        next[t] = id + 1;
+    }
+
+    for (unsigned int t = 0; ok && t < threadCount; t++)
+    {
+        if ((size_t)next[t] != count / threadCount)
+        {
+            fprintf(stderr, "log: thread %u wrote %d of %zu lines\n", t, next[t], count / threadCount);
+            ok = false;
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+#endif
+
+static void BenchLog(size_t count)
+{
+#ifdef _WIN32
+    (void)count;
+    printf("log: not supported on Windows\n");
+#else
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    LogLatencies latencies;
+
+    if (count == 0)
+        return;
+    if (maxThreads < BENCH_LOG_THREADS)
+        maxThreads = BENCH_LOG_THREADS;
+
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull < 0)
+        return;
+
+    printf("log: %zu lines to /dev/null, %u cores\n", count, std::thread::hardware_concurrency());
+    printf("  %-20s %7s %18s %8s %8s %8s %10s\n", "", "threads", "throughput", "p50 ns", "p99 ns", "p99.9 ns",
+           "max ns");
+
+    for (unsigned int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+    {
+        // std::cout writes to the standard output, so that is pointed at
+        // /dev/null while the threads run.
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        double seconds = RunLoggers(count, threadCount, latencies, [](unsigned int, int id, int price, const char *name) {
+            std::cout << "ID: " << id << ", name: " << name << ", price: " << price << std::endl;
+        });
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+        ReportLoggers("std::cout, std::endl", threadCount, seconds, latencies);
+
+        // The time includes the flush at the end, so every line has been
+        // written.
+        {
+            LogSink sink(devNull);
+            double begin = NowSeconds();
+            RunLoggers(count, threadCount, latencies, [&](unsigned int, int id, int price, const char *name) {
+                sink.Line("ID: ", id, ", name: ", name, ", price: ", price);
+            });
+            sink.Flush();
+            ReportLoggers("LogSink", threadCount, NowSeconds() - begin, latencies);
+        }
+    }
+    close(devNull);
+
+    if (!CheckLogSink(count, maxThreads))
+        exit(1);
+    printf("  every line was written once and in one piece\n");
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+static const Bench benches[] = {
+    {"arena", BenchArena},
+    {"pool", BenchPool},
+    {"fish", BenchFish},
+    {"store", BenchStore},
+    {"construct", BenchConstruct},
+    {"inventory", BenchInventory},
+    {"stress", StressInventory},
+    {"log", BenchLog},
+    {"snapshot", BenchSnapshot},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    bool found = false;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (const Bench &b : benches)
+    {
+        if (name == NULL || !strcmp(name, b.name))
+        {
+            b.run(count);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#ifndef FISH_HPP
+#define FISH_HPP
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "log_sink.hpp"
+
+// Each fish returns what it says instead of printing it, so that the same
+// classes can be used by the examples and by the benchmarks.
+class Fish
+{
+public:
+    // A class with virtual functions needs a virtual destructor if objects
+    // are ever deleted through a pointer to the base class.
+    virtual ~Fish()
+    {
+    }
+
+    const char *Bloop()
+    {
+        return "bloop";
+    }
+
+    // A virtual function may be overridden.
+    virtual const char *Floop()
+    {
+        return "floop from a generic fish";
+    }
+
+    // A pure virtual function has no default implementation.
+    // Classes that inherit from this class are required to provide an
+    // implementation in order to be instantiated.
+    virtual const char *Sploop() = 0;
+
+    int ID() const
+    {
+        return m_ID;
+    }
+
+    // Protected stuff is accessible by classes that inherit from this class.
+protected:
+    int m_ID;
+};
+
+// The final keyword means no class can inherit from Amberjack. When the
+// compiler knows an object is exactly an Amberjack, it can call its
+// overrides directly, or inline them, instead of looking them up in the
+// vtable.
+class Amberjack final : public Fish
+{
+public:
+    Amberjack()
+    {
+        m_ID = 1; // m_ID is inherited from the Fish class
+    }
+
+    void DefineAmberjack()
+    {
+        Log().Line("[ID: ", m_ID, "] An amberjack wears a plaid shirt and chops amber.");
+    }
+
+    // The override keyword is optional here, but it's usefule
+    // for reminding ourselves that a function has been overridden.
+    // The use of the override keyword is considered a C++11 extension
+    // and may require additional compiler options on certain platforms.
+    const char *Floop() override
+    {
+        return "floop, but from an amberjack";
+    }
+
+    const char *Sploop() override
+    {
+        return "The amberjack gladly implemented the Sploop method.";
+    }
+};
+
+class Gar final : public Fish
+{
+public:
+    Gar()
+    {
+        m_ID = 2; // m_ID is inherited from the Fish class
+    }
+
+    void DefineGar()
+    {
+        Log().Line("[ID: ", m_ID, "] A gar is stored in a garage.");
+    }
+
+    const char *Sploop() override
+    {
+        return "The gar begrudgingly implemented the Sploop method.";
+    }
+};
+
+// Stores fish grouped by their concrete type, with one array for each type.
+//
+// Calling a virtual function through a Fish* loads the vtable of whatever the
+// pointer happens to point to and makes an indirect call, which the CPU has
+// to guess when the types are mixed. ForEach goes through one array at a
+// time instead, so it calls each type's overrides directly, the objects are
+// next to each other in memory, and the same code runs for a whole array.
+//
+// The types should be final, or the compiler can't be sure that an object in
+// the array isn't some other class that overrides the functions again.
+//
+// Usage:
+//   FishTank<Amberjack, Gar> tank;
+//   tank.Add(Gar());
+//   tank.ForEach([](auto &fish) { fish.Sploop(); });
+template <typename... Types>
+class FishTank
+{
+public:
+    // Adds a copy of a fish to the array for its type.
+    template <typename T>
+    void Add(T fish)
+    {
+        std::get<std::vector<T>>(m_Fish).push_back(std::move(fish));
+    }
+
+    // Creates a fish in place at the end of the array for its type.
+    template <typename T, typename... Args>
+    T &Emplace(Args &&...args)
+    {
+        return std::get<std::vector<T>>(m_Fish).emplace_back(std::forward<Args>(args)...);
+    }
+
+    // Reserves room for a number of fish of one type.
+    template <typename T>
+    void Reserve(size_t count)
+    {
+        std::get<std::vector<T>>(m_Fish).reserve(count);
+    }
+
+    // Gets every fish of one type.
+    template <typename T>
+    std::vector<T> &Get()
+    {
+        return std::get<std::vector<T>>(m_Fish);
+    }
+
+    // The number of fish of every type.
+    size_t Size() const
+    {
+        return (std::get<std::vector<Types>>(m_Fish).size() + ... + 0);
+    }
+
+    // Calls a function with every fish, one type at a time, in the order the
+    // types are listed. The function is called with a reference to the
+    // concrete type, so a generic lambda gets a separate copy for each type.
+    template <typename F>
+    void ForEach(F &&f)
+    {
+        (ForEachOf<Types>(f), ...);
+    }
+
+private:
+    std::tuple<std::vector<Types>...> m_Fish;
+
+    template <typename T, typename F>
+    void ForEachOf(F &f)
+    {
+        for (T &fish : std::get<std::vector<T>>(m_Fish))
+        {
+            f(fish);
+        }
+    }
+};
+
+#endif
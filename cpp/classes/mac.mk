@@ -1,2 +1,11 @@
+# The memory resources in ../common/memory.hpp and the inline variables in
+# bagel.hpp need C++ 17, so we use the -std=c++17 flag.
+#
+# The log sink in ../common/log_sink.hpp and the benchmarks start threads,
+# so everything is built with -pthread.
+
 all:
-	clang++ -Wall -Werror main.cpp -o classes.out
+	clang++ -Wall -Werror -std=c++17 -pthread -I../common main.cpp -o classes.out
+
+bench:
+	clang++ -Wall -Werror -std=c++17 -O2 -pthread -I../common bench.cpp -o bench.out
@@ -1,187 +1,136 @@
-#include <iostream>
 #include <cstring>
+#include <vector>
 
-#define BAGEL_NAME_SIZE 32
+#include "bagel.hpp"
+#include "bagel_inventory.hpp"
+#include "bagel_snapshot.hpp"
+#include "bagel_store.hpp"
+#include "fish.hpp"
+#include "log_sink.hpp"
+#include "memory.hpp"
 
-enum Flavor
-{
-    PLAIN = 0,
-    BLUEBERRY,
-    CINNAMON,
-    BAGEL_FLAVOR_MAX
-};
-
-class Data
+void doFishThings(Fish *fish)
 {
-public:
-    int num;
-
-    Data()
-    {
-    }
-
-    Data(int num)
-    {
-        this->num = num;
-    }
-};
+    Log().Line(fish->Bloop());
+    Log().Line(fish->Floop());
+    Log().Line(fish->Sploop());
+}
 
-// a plain old regular class
-class Bagel
+int main()
 {
-private:
-    static const char *BagelNames[4];
-
-    // A common convention is to use the m_ prefix for member variables.
-    int m_ID;
-
-    // This creates an instance of the Data class.
-    // If this instance is not created in a member initializer list, it will
-    // be instantiated with the default constructor.
-    Data m_Data;
-
-public:
-    char Name[BAGEL_NAME_SIZE];
-    int Price;
-
-    // default constructor
-    // This will be present event if we don't define it.
-    // When using a member initializer list, the members should be initialized
-    // in the order they were declared.
-    Bagel() : m_ID(0), m_Data(0xBEEF) // member initializer list
-    {
-        Name[0] = '\0';
-    }
-
-    // parameterized constructor
-    Bagel(int id)
-    {
-        m_ID = id;
-        Name[0] = '\0';
-    }
-
-    // destructor (automatically called when the class is deleted)
-    ~Bagel()
-    {
-    }
+    //------------------------------------------------------------------------
+    // class basics
 
-    Bagel(int id, int price, enum Flavor name)
-    {
-        m_ID = id;
-        Price = price;
-        name = name >= BAGEL_FLAVOR_MAX ? BAGEL_FLAVOR_MAX : name;
-
-        size_t l = strlen(BagelNames[name]);
-        for (size_t i = 0; i < l; i++)
-        {
-            Name[i] = BagelNames[name][i];
-        }
-        Name[l] = '\0';
-    }
+    Bagel noBagel;
+    Bagel plainBagel(1, 100, PLAIN);
+    Bagel blueberryBagel(2, 314, BLUEBERRY);
+    Bagel cinnamonBagel(3, 250, CINNAMON);
 
-    void Describe()
-    {
-        std::cout << "ID: " << m_ID << ", name: " << Name << ", price: " << Price << std::endl;
-    }
-};
+    noBagel.Describe();
+    plainBagel.Describe();
+    blueberryBagel.Describe();
+    cinnamonBagel.Describe();
 
-const char *Bagel::BagelNames[4] = {"plain",
-                                    "blueberry",
-                                    "cinnamon",
-                                    "none"};
+    // Flavors that aren't in the Flavor enum can be added while the program
+    // runs. Bagels only hold a handle to the name, which is stored once.
+    FlavorHandle everything = Bagel::RegisterFlavor("everything");
+    Bagel everythingBagel(4, 325, everything);
+    everythingBagel.Describe();
+    Log().Line("size of a bagel: ", sizeof(Bagel), " bytes");
 
-class Fish
-{
-public:
-    void Bloop()
-    {
-        std::cout << "bloop" << std::endl;
-    }
+    //------------------------------------------------------------------------
+    // memory resources
 
-    // A virtual function may be overridden.
-    virtual void Floop()
+    // A pool hands out slots that each fit one Bagel, so creating and
+    // destroying many of them doesn't go through the global allocator.
+    PoolResource bagelPool(sizeof(Bagel), alignof(Bagel));
+    Bagel *pooledBagels[3];
+    for (int i = 0; i < 3; i++)
     {
-        std::cout << "floop from a generic fish" << std::endl;
+        pooledBagels[i] = NewObject<Bagel>(&bagelPool, 10 + i, 100 + i, (Flavor)i);
     }
-
-    // A pure virtual function has no default implementation.
-    // Classes that inherit from this class are required to provide an
-    // implementation in order to be instantiated.F
-    virtual void Sploop() = 0;
-
-    // Protected stuff is accessible by classes that inherit from this class.
-protected:
-    int m_ID;
-};
-
-class Amberjack : public Fish
-{
-public:
-    Amberjack()
+    Log().Line("bagels in the pool: ", bagelPool.SlotsInUse());
+    pooledBagels[2]->Describe();
+    for (int i = 0; i < 3; i++)
     {
-        m_ID = 1; // m_ID is inherited from the Fish class
+        DeleteObject(&bagelPool, pooledBagels[i]);
     }
 
-    void DefineAmberjack()
-    {
-        std::cout << "[ID: " << m_ID << "] An amberjack wears a plaid shirt and chops amber." << std::endl;
-    }
+    // An arena hands out memory by moving a pointer forward, and takes all of
+    // it back at once when it's reset, like at the end of a request.
+    ArenaResource requestArena;
+    Data *requestData = NewObject<Data>(&requestArena, 0xCAFE);
+    Bagel *requestBagel = NewObject<Bagel>(&requestArena, 20, 275, CINNAMON);
+    Log().Line("data from the arena: ", LogHex(requestData->num), ", bytes used: ", requestArena.BytesAllocated());
+    requestBagel->Describe();
 
-    // The override keyword is optional here, but it's usefule
-    // for reminding ourselves that a function has been overridden.
-    // The use of the override keyword is considered a C++11 extension
-    // and may require additional compiler options on certain platforms.
-    void Floop() // override
-    {
-        std::cout << "floop, but from an amberjack" << std::endl;
-    }
+    // Bagel and Data have trivial destructors, so their memory can be taken
+    // back without destroying them one by one.
+    requestArena.Reset();
 
-    void Sploop() // override
-    {
-        std::cout << "The amberjack gladly implemented the Sploop method." << std::endl;
-    }
-};
+    //------------------------------------------------------------------------
+    // struct of arrays
+
+    // A store keeps each member of its bagels in a separate array, so a query
+    // on prices only reads prices.
+    BagelStore store;
+    store.Add(30, 100, PLAIN);
+    store.Add(31, 314, BLUEBERRY);
+    store.Add(32, 250, CINNAMON);
+    store.Add(33, 199, BLUEBERRY);
+    store.Add(34, 325, everything);
+
+    BagelQuery blueberry;
+    blueberry.flavor = BLUEBERRY;
+    blueberry.maxPrice = 300;
+
+    int minPrice = 0;
+    int maxPrice = 0;
+    store.PriceRange(minPrice, maxPrice);
+    Log().Line("store total: ", store.SumPrices(), ", blueberry under 300: ", store.SumPrices(blueberry),
+               ", prices from ", minPrice, " to ", maxPrice);
+
+    // Flavors from RegisterFlavor can be queried the same way.
+    BagelQuery everythingQuery;
+    everythingQuery.flavor = everything;
+    Log().Line("everything bagels: ", store.SumPrices(everythingQuery));
+
+    // Iterating gives views that work much like bagels.
+    for (BagelView bagel : store)
+    {
+        if (bagel.GetFlavor() == CINNAMON)
+            bagel.SetPrice(bagel.Price() + 25);
+        bagel.Describe();
+    }
+
+    // An inventory can be read and updated by many threads at once without
+    // locks. Each bagel's price and flavor are one atomic word.
+    BagelInventory inventory(16);
+    inventory.Insert(plainBagel);
+    inventory.Insert(blueberryBagel);
+    inventory.Insert(everythingBagel);
+
+    int newPrice = 0;
+    inventory.AddToPrice(2, 10, &newPrice);
+    Log().Line("bagels in the inventory: ", inventory.Size(), ", new blueberry price: ", newPrice);
+    inventory.Describe();
 
-class Gar : public Fish
-{
-public:
-    Gar()
-    {
-        m_ID = 2; // m_ID is inherited from the Fish class
-    }
+    //------------------------------------------------------------------------
+    // serialization
 
-    void DefineGar()
-    {
-        std::cout << "[ID: " << m_ID << "] A gar is stored in a garage." << std::endl;
-    }
+    // A snapshot stores each bagel as a fixed-size binary record, with the
+    // flavor as a small code instead of its name. SaveBagelSnapshot and
+    // LoadBagelSnapshot do the same with a file.
+    Bagel toSave[] = {plainBagel, blueberryBagel, everythingBagel};
+    std::vector<unsigned char> snapshot(BagelSnapshotSize(3));
+    WriteBagelSnapshot(toSave, 3, snapshot.data());
 
-    void Sploop() // override
+    std::vector<Bagel> restored;
+    if (ReadBagelSnapshot(snapshot.data(), snapshot.size(), restored))
     {
-        std::cout << "The gar begrudgingly implemented the Sploop method." << std::endl;
+        Log().Line("restored ", restored.size(), " bagels from a snapshot of ", snapshot.size(), " bytes");
+        restored.back().Describe();
     }
-};
-
-void doFishThings(Fish *fish)
-{
-    fish->Bloop();
-    fish->Floop();
-    fish->Sploop();
-}
-
-int main()
-{
-    //------------------------------------------------------------------------
-    // class basics
-
-    Bagel noBagel;
-    Bagel plainBagel(1, 100, PLAIN);
-    Bagel blueberryBagel(2, 314, BLUEBERRY);
-    Bagel cinnamonBagel(3, 250, CINNAMON);
-
-    noBagel.Describe();
-    plainBagel.Describe();
-    blueberryBagel.Describe();
-    cinnamonBagel.Describe();
 
     //------------------------------------------------------------------------
     // inheritance
@@ -195,5 +144,19 @@ int main()
     gar.DefineGar();
     doFishThings(&gar);
 
+    // A tank keeps each type of fish in its own array, so ForEach knows the
+    // concrete type of every fish and doesn't need virtual calls.
+    FishTank<Amberjack, Gar> tank;
+    tank.Emplace<Amberjack>();
+    tank.Emplace<Gar>();
+    tank.Add(gar);
+
+    Log().Line("fish in the tank: ", tank.Size());
+    tank.ForEach([](auto &fish) { Log().Line("[ID: ", fish.ID(), "] ", fish.Sploop()); });
+
+    // Nothing above waited for its output to be written. Shutting the sink
+    // down writes whatever is still in it.
+    Log().Shutdown();
+
     return 0;
 }
\ No newline at end of file
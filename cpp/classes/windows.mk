@@ -1,2 +1,8 @@
+# The memory resources in ../common/memory.hpp and the inline variables in
+# bagel.hpp need C++ 17, so we use the /std:c++17 flag.
+
 all:
-	cl /W3 /WX /EHsc main.cpp /Fe"classes.exe"
+	cl /W3 /WX /EHsc /std:c++17 /I../common main.cpp /Fe"classes.exe"
+
+bench:
+	cl /W3 /WX /EHsc /std:c++17 /O2 /I../common bench.cpp /Fe"bench.exe"
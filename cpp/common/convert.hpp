@@ -0,0 +1,205 @@
+// Conversions between strings and primitive types, resolved at compile time.
+//
+// This is the C++ counterpart of c/strings/convert.h. The C functions take a
+// my_type enumeration and a void pointer, so every call has to switch on the
+// type at runtime, cast the pointer, and check errno. Here the destination
+// type is a template parameter, so the compiler picks the conversion with
+// if constexpr and there is nothing left to decide when the program runs.
+//
+// The conversions use std::from_chars and std::to_chars from C++ 17, which
+// don't consult the locale, don't allocate, and report errors through their
+// return value instead of errno. The concepts used to constrain the templates
+// need C++ 20.
+
+#ifndef CONVERT_HPP
+#define CONVERT_HPP
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+// The longest string PrimitiveToStr can produce for any type, including the
+// NUL terminator.
+#define PRIMITIVE_STR_SIZE 64
+
+// Any of the types covered by my_type in the C version: the character,
+// integer and floating point types, but not bool.
+template <typename T>
+concept Primitive = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+// The types that are read as numbers but written as a single character,
+// like "%c".
+template <typename T>
+concept Character = std::is_same_v<T, char> ||
+                    std::is_same_v<T, signed char> ||
+                    std::is_same_v<T, unsigned char>;
+
+/**
+ * Converts a string into one of the primitive types.
+ * Like strtol, leading whitespace and a leading '+' are skipped and anything
+ * after the number is ignored. Integers are base 10. Characters are read as
+ * numbers, so "97" is 'a'. Unlike str_to_primitive, a value that doesn't fit
+ * in the destination type is a failure rather than being truncated.
+ *
+ * Params:
+ *   std::string_view - the string, which doesn't need to be NUL-terminated
+ *   T& - the destination for the converted value, which is left unchanged
+ *        on failure
+ *
+ * Returns:
+ *   bool - true on success, false on failure
+ */
+template <Primitive T>
+bool StrToPrimitive(std::string_view str, T &dest)
+{
+    const char *first = str.data();
+    const char *last = first + str.size();
+
+    while (first != last && (*first == ' ' || (*first >= '\t' && *first <= '\r')))
+    {
+        first++;
+    }
+
+    // from_chars rejects a '+', but strtol accepts one.
+    if (first != last && *first == '+')
+    {
+        first++;
+        if (first != last && *first == '-')
+        {
+            return false;
+        }
+    }
+
+    if constexpr (std::is_floating_point_v<T>)
+    {
+#if defined(__cpp_lib_to_chars)
+        std::from_chars_result res = std::from_chars(first, last, dest);
+        return res.ec == std::errc() && res.ptr != first;
+#else
+        // Standard libraries that don't have floating point from_chars yet
+        // fall back to the strto* functions, which need a NUL terminator.
+        char buffer[PRIMITIVE_STR_SIZE];
+        char *end;
+        T value;
+        size_t len = static_cast<size_t>(last - first);
+
+        if (len >= sizeof(buffer))
+        {
+            return false;
+        }
+        memcpy(buffer, first, len);
+        buffer[len] = '\0';
+
+        errno = 0;
+        if constexpr (std::is_same_v<T, float>)
+            value = strtof(buffer, &end);
+        else if constexpr (std::is_same_v<T, double>)
+            value = strtod(buffer, &end);
+        else
+            value = strtold(buffer, &end);
+
+        if (errno == ERANGE || end == buffer)
+        {
+            return false;
+        }
+        dest = value;
+        return true;
+#endif
+    }
+    else
+    {
+        std::from_chars_result res = std::from_chars(first, last, dest, 10);
+        return res.ec == std::errc();
+    }
+}
+
+/**
+ * Converts a primitive to a NUL-terminated string.
+ * Characters are written as-is, like "%c". Floating point values are
+ * written with the fewest digits that read back as the same value, like
+ * 3.14 or 1e+300.
+ *
+ * Params:
+ *   T - the value to convert
+ *   char* - a pointer to a char buffer
+ *   size_t - the size of the buffer, where PRIMITIVE_STR_SIZE always fits
+ *
+ * Returns:
+ *   size_t - the length of the string, not including the NUL terminator, or
+ *            0 if it doesn't fit in the buffer
+ */
+template <Primitive T>
+size_t PrimitiveToStr(T value, char *buffer, size_t s)
+{
+    if (s == 0)
+    {
+        return 0;
+    }
+
+    if constexpr (Character<T>)
+    {
+        if (s < 2)
+        {
+            return 0;
+        }
+        buffer[0] = static_cast<char>(value);
+        buffer[1] = '\0';
+        return 1;
+    }
+#if !defined(__cpp_lib_to_chars)
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        // Without floating point to_chars, max_digits10 digits still read
+        // back as the same value, but aren't always the fewest.
+        int len;
+        if constexpr (std::is_same_v<T, long double>)
+            len = snprintf(buffer, s, "%.*Lg", std::numeric_limits<T>::max_digits10, value);
+        else
+            len = snprintf(buffer, s, "%.*g", std::numeric_limits<T>::max_digits10, static_cast<double>(value));
+
+        if (len < 0 || static_cast<size_t>(len) >= s)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(len);
+    }
+#endif
+    else
+    {
+        std::to_chars_result res = std::to_chars(buffer, buffer + s - 1, value);
+        if (res.ec != std::errc())
+        {
+            return 0;
+        }
+        *res.ptr = '\0';
+        return static_cast<size_t>(res.ptr - buffer);
+    }
+}
+
+/**
+ * Converts a primitive to a std::string, the same way as PrimitiveToStr.
+ *
+ * Params:
+ *   T - the value to convert
+ *
+ * Returns:
+ *   std::string - the converted value
+ */
+template <Primitive T>
+std::string PrimitiveToString(T value)
+{
+    char buffer[PRIMITIVE_STR_SIZE];
+    size_t len = PrimitiveToStr(value, buffer, sizeof(buffer));
+    return std::string(buffer, len);
+}
+
+#endif
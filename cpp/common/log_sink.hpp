@@ -0,0 +1,454 @@
+// A logging sink that doesn't make the caller wait for the output.
+//
+// Writing a line with std::cout << ... << std::endl flushes the stream, so
+// every line is a system call made by the thread that logged it, while it
+// holds the stream's lock. A LogSink splits the work in two:
+//
+// - The logging thread builds the line in a buffer of its own, then copies
+//   it into a ring of fixed-size slots shared by every thread. A slot is
+//   claimed with a compare-and-swap, so threads never take a lock to log and
+//   a stalled thread can't stop the others. Long lines take several slots
+//   next to each other, and are never mixed up with other lines.
+// - A writer thread takes the lines out of the ring in order, gathers them
+//   in a large buffer and writes the buffer with one call.
+//
+// Flush waits until everything logged before it has been written, and
+// Shutdown flushes and stops the writer thread. Other threads should be done
+// logging before Shutdown is called. Lines logged after it are written
+// straight away by the thread that logs them.
+//
+// If the ring fills up, logging threads wait for the writer to make room
+// rather than lose lines.
+//
+// Usage:
+//   Log().Line("ID: ", id, ", price: ", price);
+//   Log().Flush();
+
+#ifndef LOG_SINK_HPP
+#define LOG_SINK_HPP
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// The size of each slot in the ring, including its header.
+#define LOG_SLOT_SIZE 128
+
+// The default number of slots in the ring. Must be a power of 2.
+#define LOG_DEFAULT_SLOTS 4096
+
+// The size of the writer thread's buffer, which is the most it writes at
+// once.
+#define LOG_WRITE_BUFFER_SIZE (64 * 1024)
+
+// How many times the writer thread yields when the ring is empty before it
+// sleeps. Lines logged meanwhile are taken without having to wake it.
+#define LOG_IDLE_SPINS 64
+
+#define LOG_STDOUT 1
+#define LOG_STDERR 2
+
+// Makes LogSink::Line write an integer in hexadecimal.
+struct LogHex
+{
+    explicit LogHex(unsigned long long value) : value(value)
+    {
+    }
+
+    unsigned long long value;
+};
+
+class LogSink
+{
+public:
+    // Creates a sink that writes to a file descriptor, and starts its
+    // writer thread. The sink doesn't close the descriptor.
+    explicit LogSink(int fd = LOG_STDOUT, size_t slots = LOG_DEFAULT_SLOTS)
+        : m_FD(fd), m_Head(0), m_Tail(0), m_Written(0), m_FlushTarget(0), m_Stop(false), m_Sleeping(false),
+          m_Running(true), m_BytesWritten(0)
+    {
+        m_SlotCount = 2;
+        while (m_SlotCount < slots)
+            m_SlotCount *= 2;
+
+        m_Slots.reset(new Slot[m_SlotCount]);
+        for (size_t i = 0; i < m_SlotCount; i++)
+            m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+
+        m_Buffer.reset(new char[LOG_WRITE_BUFFER_SIZE]);
+        m_Writer = std::thread(&LogSink::Run, this);
+    }
+
+    LogSink(const LogSink &) = delete;
+    LogSink &operator=(const LogSink &) = delete;
+
+    ~LogSink()
+    {
+        Shutdown();
+    }
+
+    // Logs a line made of any number of values, with a newline added.
+    // Strings and characters are copied as they are, and numbers are
+    // written in decimal, or in hexadecimal when wrapped in LogHex.
+    template <typename... Args>
+    void Line(const Args &...args)
+    {
+        std::string &line = ThreadBuffer();
+        line.clear();
+        (Append(line, args), ...);
+        line.push_back('\n');
+        Write(line);
+    }
+
+    // Logs text as it is. Text longer than the ring is split, and may be
+    // mixed with lines from other threads.
+    void Write(std::string_view text)
+    {
+        if (!m_Running.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            WriteAll(text.data(), text.size());
+            return;
+        }
+
+        size_t most = m_SlotCount * SLOT_TEXT_SIZE;
+        while (text.size() > most)
+        {
+            Enqueue(text.substr(0, most));
+            text.remove_prefix(most);
+        }
+        if (!text.empty())
+            Enqueue(text);
+    }
+
+    // Waits until everything logged before the call has been written.
+    void Flush()
+    {
+        if (!m_Running.load(std::memory_order_acquire))
+            return;
+
+        uint64_t target = m_Head.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (target > m_FlushTarget)
+            m_FlushTarget = target;
+        m_Wake.notify_one();
+        m_Flushed.wait(lock, [&] { return m_Written >= target || !m_Running.load(std::memory_order_relaxed); });
+    }
+
+    // Writes everything that was logged and stops the writer thread. Lines
+    // logged after this are written by the threads that log them.
+    void Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Stop)
+                return;
+            m_Stop = true;
+            m_Wake.notify_one();
+        }
+        m_Writer.join();
+    }
+
+    // The number of bytes handed to the file descriptor so far.
+    unsigned long long BytesWritten() const
+    {
+        return m_BytesWritten.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Each slot holds part of a line. The first slot of a line also holds
+    // its length and the number of slots it takes.
+    //
+    // A slot's sequence says who may use it. When it equals the position
+    // of the slot in the ring, counting from the start and never wrapping,
+    // the slot is free for that position. One more means the line in it is
+    // ready to be written. The writer moves it a whole lap ahead when it is
+    // done with it.
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        uint32_t length;
+        uint32_t count;
+        char text[LOG_SLOT_SIZE - sizeof(std::atomic<uint64_t>) - 2 * sizeof(uint32_t)];
+    };
+
+    static constexpr size_t SLOT_TEXT_SIZE = sizeof(Slot::text);
+
+    int m_FD;
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t m_SlotCount;
+
+    // The next position to claim. Kept away from the writer's fields so
+    // that logging threads and the writer don't fight over a cache line.
+    alignas(64) std::atomic<uint64_t> m_Head;
+
+    // The writer's fields. m_Written and m_FlushTarget are guarded by
+    // m_Mutex.
+    alignas(64) uint64_t m_Tail;
+    uint64_t m_Written;
+    uint64_t m_FlushTarget;
+    bool m_Stop;
+    std::atomic<bool> m_Sleeping;
+    std::atomic<bool> m_Running;
+    std::atomic<unsigned long long> m_BytesWritten;
+    std::unique_ptr<char[]> m_Buffer;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Flushed;
+    std::thread m_Writer;
+
+    // The buffer each thread builds its lines in. It keeps its memory, so a
+    // thread stops allocating after its longest line.
+    static std::string &ThreadBuffer()
+    {
+        static thread_local std::string buffer;
+        return buffer;
+    }
+
+    template <typename T>
+    static void Append(std::string &line, const T &value)
+    {
+        if constexpr (std::is_same_v<T, char>)
+        {
+            line.push_back(value);
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            line.append(value ? "true" : "false");
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            char text[24];
+            std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+            line.append(text, result.ptr);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            char text[32];
+            int length = snprintf(text, sizeof(text), "%g", static_cast<double>(value));
+            line.append(text, length > 0 ? static_cast<size_t>(length) : 0);
+        }
+        else if constexpr (std::is_same_v<T, LogHex>)
+        {
+            char text[24];
+            std::to_chars_result result = std::to_chars(text, text + sizeof(text), value.value, 16);
+            line.append(text, result.ptr);
+        }
+        else
+        {
+            line.append(std::string_view(value));
+        }
+    }
+
+    // Claims enough slots for some text, which must fit in the ring, copies
+    // the text into them and hands them to the writer.
+    void Enqueue(std::string_view text)
+    {
+        uint64_t count = (text.size() + SLOT_TEXT_SIZE - 1) / SLOT_TEXT_SIZE;
+        uint64_t position = m_Head.load(std::memory_order_relaxed);
+
+        // The writer frees slots in order, so if the last slot is free, the
+        // ones before it are too.
+        for (;;)
+        {
+            uint64_t last = position + count - 1;
+            uint64_t sequence = m_Slots[last & (m_SlotCount - 1)].sequence.load(std::memory_order_acquire);
+
+            if (sequence == last)
+            {
+                if (m_Head.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+                    break;
+            }
+            else if (sequence < last)
+            {
+                // The ring is full.
+                std::this_thread::yield();
+                position = m_Head.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                // Another thread claimed the slot first.
+                position = m_Head.load(std::memory_order_relaxed);
+            }
+        }
+
+        Slot &first = m_Slots[position & (m_SlotCount - 1)];
+        first.length = static_cast<uint32_t>(text.size());
+        first.count = static_cast<uint32_t>(count);
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+            size_t length = text.size() < SLOT_TEXT_SIZE ? text.size() : SLOT_TEXT_SIZE;
+            memcpy(m_Slots[(position + i) & (m_SlotCount - 1)].text, text.data(), length);
+            text.remove_prefix(length);
+        }
+
+        for (uint64_t i = count; i > 1; i--)
+            m_Slots[(position + i - 1) & (m_SlotCount - 1)].sequence.store(position + i, std::memory_order_release);
+
+        // The first slot is published last, since the writer starts there.
+        // The store and the load of m_Sleeping are sequentially consistent,
+        // and so are the writer's, so either the writer sees this line
+        // before it sleeps or this thread sees that it is asleep.
+        first.sequence.store(position + 1, std::memory_order_seq_cst);
+        if (m_Sleeping.load(std::memory_order_seq_cst))
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Sleeping.exchange(false, std::memory_order_relaxed))
+                m_Wake.notify_one();
+        }
+    }
+
+    // The writer thread.
+    void Run()
+    {
+        size_t used = 0;
+        int spins = 0;
+
+        for (;;)
+        {
+            bool took = false;
+
+            // Take every line that's ready, writing whenever the buffer
+            // fills up.
+            for (;;)
+            {
+                Slot &first = m_Slots[m_Tail & (m_SlotCount - 1)];
+                if (first.sequence.load(std::memory_order_acquire) != m_Tail + 1)
+                    break;
+
+                uint64_t count = first.count;
+                size_t left = first.length;
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    Slot &slot = m_Slots[(m_Tail + i) & (m_SlotCount - 1)];
+                    size_t length = left < SLOT_TEXT_SIZE ? left : SLOT_TEXT_SIZE;
+                    if (used + length > LOG_WRITE_BUFFER_SIZE)
+                    {
+                        WriteAll(m_Buffer.get(), used);
+                        used = 0;
+                    }
+                    memcpy(m_Buffer.get() + used, slot.text, length);
+                    used += length;
+                    left -= length;
+                }
+
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    m_Slots[(m_Tail + i) & (m_SlotCount - 1)].sequence.store(m_Tail + i + m_SlotCount,
+                                                                             std::memory_order_release);
+                }
+                m_Tail += count;
+                took = true;
+            }
+
+            if (used > 0)
+            {
+                WriteAll(m_Buffer.get(), used);
+                used = 0;
+            }
+
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Written = m_Tail;
+            if (m_Written >= m_FlushTarget)
+                m_Flushed.notify_all();
+
+            if (took)
+            {
+                spins = 0;
+                continue;
+            }
+
+            // Everything claimed before Shutdown has been written.
+            if (m_Stop && m_Tail == m_Head.load(std::memory_order_acquire))
+            {
+                m_Running.store(false, std::memory_order_release);
+                m_Flushed.notify_all();
+                return;
+            }
+
+            // Sleep until a line is logged or there's a flush to finish,
+            // after yielding for a while in case more lines come soon. If a
+            // flush or Shutdown is waiting on a line that's still being
+            // copied in, let its thread run.
+            if (m_FlushTarget <= m_Written && !m_Stop && spins < LOG_IDLE_SPINS)
+            {
+                spins++;
+                lock.unlock();
+                std::this_thread::yield();
+            }
+            else if (m_FlushTarget <= m_Written && !m_Stop)
+            {
+                m_Sleeping.store(true, std::memory_order_seq_cst);
+                if (m_Slots[m_Tail & (m_SlotCount - 1)].sequence.load(std::memory_order_seq_cst) == m_Tail + 1)
+                {
+                    m_Sleeping.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                m_Wake.wait(lock, [&] {
+                    return !m_Sleeping.load(std::memory_order_relaxed) || m_FlushTarget > m_Written || m_Stop;
+                });
+                m_Sleeping.store(false, std::memory_order_relaxed);
+            }
+            else
+            {
+                lock.unlock();
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void WriteAll(const char *data, size_t size)
+    {
+        m_BytesWritten.fetch_add(size, std::memory_order_relaxed);
+        while (size > 0)
+        {
+#ifdef _WIN32
+            int written = _write(m_FD, data, static_cast<unsigned int>(size));
+            if (written < 0)
+                return;
+#else
+            ssize_t written = write(m_FD, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+#endif
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+};
+
+/**
+ * Gets the sink for the standard output, which is created the first time
+ * it's used and flushed when the program exits.
+ *
+ * Returns:
+ *   LogSink& - the sink
+ */
+inline LogSink &Log()
+{
+    static LogSink sink(LOG_STDOUT);
+    return sink;
+}
+
+#endif
@@ -0,0 +1,340 @@
+// Memory resources for workloads that allocate many short-lived objects.
+//
+// Both classes derive from std::pmr::memory_resource from C++ 17, so they
+// can be handed to anything that takes one, like std::pmr::vector or
+// std::pmr::polymorphic_allocator, and objects can be created in them with
+// NewObject and DeleteObject.
+//
+// ArenaResource hands out memory by moving a pointer forward through large
+// blocks. Nothing is freed individually; Reset makes all of it available
+// again at once, which suits memory that lives as long as one request.
+//
+// PoolResource hands out slots of one fixed size from a free list, which
+// suits many objects of the same type that are created and destroyed in any
+// order.
+//
+// Neither class is thread safe.
+
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// The default size of each block an ArenaResource gets from upstream.
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+// The default number of slots a PoolResource gets from upstream at a time.
+#define POOL_DEFAULT_SLOTS_PER_CHUNK 1024
+
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+    explicit ArenaResource(size_t blockSize = ARENA_DEFAULT_BLOCK_SIZE,
+                           std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : m_Upstream(upstream), m_BlockSize(blockSize < sizeof(Block) * 2 ? sizeof(Block) * 2 : blockSize),
+          m_Used(nullptr), m_Free(nullptr), m_Ptr(nullptr), m_End(nullptr), m_BytesAllocated(0)
+    {
+    }
+
+    ArenaResource(const ArenaResource &) = delete;
+    ArenaResource &operator=(const ArenaResource &) = delete;
+
+    ~ArenaResource()
+    {
+        Release();
+    }
+
+    // Makes every block available again without returning it upstream.
+    // Everything allocated from the arena becomes invalid.
+    void Reset()
+    {
+        while (m_Used != nullptr)
+        {
+            Block *block = m_Used;
+            m_Used = block->next;
+
+            // Blocks made for a single large allocation are returned, so one
+            // unusual request doesn't keep its memory forever.
+            if (block->size == m_BlockSize)
+            {
+                block->next = m_Free;
+                m_Free = block;
+            }
+            else
+            {
+                m_Upstream->deallocate(block, block->size, alignof(std::max_align_t));
+            }
+        }
+
+        m_Ptr = nullptr;
+        m_End = nullptr;
+        m_BytesAllocated = 0;
+    }
+
+    // Returns every block upstream.
+    void Release()
+    {
+        Reset();
+        while (m_Free != nullptr)
+        {
+            Block *block = m_Free;
+            m_Free = block->next;
+            m_Upstream->deallocate(block, block->size, alignof(std::max_align_t));
+        }
+    }
+
+    // The number of bytes handed out since the last Reset, not counting
+    // padding for alignment.
+    size_t BytesAllocated() const
+    {
+        return m_BytesAllocated;
+    }
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        char *p = AlignUp(m_Ptr, alignment);
+
+        // The padding for alignment can take p past the end of the block.
+        if (p == nullptr || p > m_End || bytes > static_cast<size_t>(m_End - p))
+        {
+            NextBlock(bytes, alignment);
+            p = AlignUp(m_Ptr, alignment);
+        }
+
+        m_Ptr = p + bytes;
+        m_BytesAllocated += bytes;
+        return p;
+    }
+
+    // Memory is only reclaimed by Reset.
+    void do_deallocate(void *, size_t, size_t) override
+    {
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    // The header at the start of every block.
+    struct alignas(std::max_align_t) Block
+    {
+        Block *next;
+        size_t size;
+    };
+
+    std::pmr::memory_resource *m_Upstream;
+    size_t m_BlockSize;
+    Block *m_Used; // blocks handed out since the last Reset, newest first
+    Block *m_Free; // blocks of m_BlockSize kept by Reset
+    char *m_Ptr;   // the next free byte in the newest block
+    char *m_End;   // one past the last byte of the newest block
+    size_t m_BytesAllocated;
+
+    static char *AlignUp(char *p, size_t alignment)
+    {
+        uintptr_t v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char *>((v + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+    }
+
+    // Makes a block with room for an allocation the newest one.
+    // The rest of the current block is abandoned until the next Reset.
+    void NextBlock(size_t bytes, size_t alignment)
+    {
+        Block *block;
+        size_t need = sizeof(Block) + bytes + alignment;
+
+        if (need < bytes)
+            throw std::bad_alloc();
+
+        if (need <= m_BlockSize && m_Free != nullptr)
+        {
+            block = m_Free;
+            m_Free = block->next;
+        }
+        else
+        {
+            size_t size = need <= m_BlockSize ? m_BlockSize : need;
+            block = static_cast<Block *>(m_Upstream->allocate(size, alignof(std::max_align_t)));
+            block->size = size;
+        }
+
+        block->next = m_Used;
+        m_Used = block;
+        m_Ptr = reinterpret_cast<char *>(block + 1);
+        m_End = reinterpret_cast<char *>(block) + block->size;
+    }
+};
+
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+    // Creates a pool of slots that each fit an object of the given size and
+    // alignment. Requests that don't fit in a slot are passed upstream.
+    explicit PoolResource(size_t objectSize, size_t objectAlignment = alignof(std::max_align_t),
+                          size_t slotsPerChunk = POOL_DEFAULT_SLOTS_PER_CHUNK,
+                          std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : m_Upstream(upstream), m_Chunks(nullptr), m_Free(nullptr), m_SlotsPerChunk(slotsPerChunk > 0 ? slotsPerChunk : 1),
+          m_SlotsInUse(0)
+    {
+        m_Alignment = objectAlignment > alignof(Slot) ? objectAlignment : alignof(Slot);
+        m_SlotSize = objectSize > sizeof(Slot) ? objectSize : sizeof(Slot);
+        m_SlotSize = (m_SlotSize + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+        // The chunk header takes up the first slot of every chunk.
+        m_HeaderSize = (sizeof(Chunk) + m_Alignment - 1) / m_Alignment * m_Alignment;
+    }
+
+    PoolResource(const PoolResource &) = delete;
+    PoolResource &operator=(const PoolResource &) = delete;
+
+    // Returns every chunk upstream. Any slots still in use become invalid.
+    ~PoolResource()
+    {
+        while (m_Chunks != nullptr)
+        {
+            Chunk *chunk = m_Chunks;
+            m_Chunks = chunk->next;
+            m_Upstream->deallocate(chunk, ChunkSize(), m_Alignment);
+        }
+    }
+
+    // The size of each slot after rounding up for alignment.
+    size_t SlotSize() const
+    {
+        return m_SlotSize;
+    }
+
+    // The number of slots that have been allocated and not deallocated.
+    size_t SlotsInUse() const
+    {
+        return m_SlotsInUse;
+    }
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (bytes > m_SlotSize || alignment > m_Alignment)
+            return m_Upstream->allocate(bytes, alignment);
+
+        if (m_Free == nullptr)
+            Grow();
+
+        Slot *slot = m_Free;
+        m_Free = slot->next;
+        m_SlotsInUse++;
+        return slot;
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        if (bytes > m_SlotSize || alignment > m_Alignment)
+        {
+            m_Upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+
+        Slot *slot = static_cast<Slot *>(p);
+        slot->next = m_Free;
+        m_Free = slot;
+        m_SlotsInUse--;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    // A free slot holds a pointer to the next free slot.
+    struct Slot
+    {
+        Slot *next;
+    };
+
+    struct Chunk
+    {
+        Chunk *next;
+    };
+
+    std::pmr::memory_resource *m_Upstream;
+    Chunk *m_Chunks;
+    Slot *m_Free;
+    size_t m_SlotsPerChunk;
+    size_t m_SlotsInUse;
+    size_t m_SlotSize;
+    size_t m_Alignment;
+    size_t m_HeaderSize;
+
+    size_t ChunkSize() const
+    {
+        return m_HeaderSize + m_SlotSize * m_SlotsPerChunk;
+    }
+
+    // Gets another chunk from upstream and adds its slots to the free list
+    // in address order, so objects allocated one after another are next to
+    // each other in memory.
+    void Grow()
+    {
+        Chunk *chunk = static_cast<Chunk *>(m_Upstream->allocate(ChunkSize(), m_Alignment));
+        char *first = reinterpret_cast<char *>(chunk) + m_HeaderSize;
+
+        chunk->next = m_Chunks;
+        m_Chunks = chunk;
+
+        for (size_t i = m_SlotsPerChunk; i > 0; i--)
+        {
+            Slot *slot = reinterpret_cast<Slot *>(first + (i - 1) * m_SlotSize);
+            slot->next = m_Free;
+            m_Free = slot;
+        }
+    }
+};
+
+/**
+ * Creates an object in memory from a resource.
+ *
+ * Params:
+ *   std::pmr::memory_resource* - the resource to allocate from
+ *   Args&&... - the arguments for the object's constructor
+ *
+ * Returns:
+ *   T* - the new object
+ */
+template <typename T, typename... Args>
+T *NewObject(std::pmr::memory_resource *resource, Args &&...args)
+{
+    void *p = resource->allocate(sizeof(T), alignof(T));
+    try
+    {
+        return new (p) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        resource->deallocate(p, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+/**
+ * Destroys an object created by NewObject and returns its memory to the
+ * resource. The pointer must have the object's real type, not a base class.
+ *
+ * Params:
+ *   std::pmr::memory_resource* - the resource the object came from
+ *   T* - the object
+ */
+template <typename T>
+void DeleteObject(std::pmr::memory_resource *resource, T *object)
+{
+    object->~T();
+    resource->deallocate(object, sizeof(T), alignof(T));
+}
+
+#endif
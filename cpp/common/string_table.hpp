@@ -0,0 +1,112 @@
+// A table of interned strings.
+//
+// Each distinct string is stored once and given a 16-bit handle, so objects
+// that share a name can hold the handle instead of a copy of the text.
+// Looking up the name of a handle is an array index, and interning a string
+// that's already in the table finds its existing handle.
+//
+// The text is kept in an ArenaResource, so the pointers returned by Name
+// stay valid for as long as the table exists, even as more strings are
+// added. Nothing is ever removed.
+//
+// The class is not thread safe.
+
+#ifndef STRING_TABLE_HPP
+#define STRING_TABLE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "memory.hpp"
+
+typedef uint16_t StringHandle;
+
+// The number of strings a StringTable can hold.
+#define STRING_TABLE_MAX_SIZE 65536
+
+// The size of the arena blocks that hold the text.
+#define STRING_TABLE_BLOCK_SIZE 4096
+
+class StringTable
+{
+public:
+    StringTable() : m_Text(STRING_TABLE_BLOCK_SIZE)
+    {
+    }
+
+    // Creates a table with strings that get the handles 0, 1, 2 and so on.
+    StringTable(std::initializer_list<const char *> strings) : m_Text(STRING_TABLE_BLOCK_SIZE)
+    {
+        for (const char *s : strings)
+        {
+            Intern(s);
+        }
+    }
+
+    StringTable(const StringTable &) = delete;
+    StringTable &operator=(const StringTable &) = delete;
+
+    // Gets the handle of a string, adding it to the table if it isn't there.
+    // Throws std::length_error if the table is full.
+    StringHandle Intern(std::string_view s)
+    {
+        auto found = m_Handles.find(s);
+        if (found != m_Handles.end())
+            return found->second;
+
+        if (m_Names.size() >= STRING_TABLE_MAX_SIZE)
+            throw std::length_error("StringTable is full");
+
+        char *text = static_cast<char *>(m_Text.allocate(s.size() + 1, 1));
+        memcpy(text, s.data(), s.size());
+        text[s.size()] = '\0';
+
+        StringHandle handle = static_cast<StringHandle>(m_Names.size());
+        m_Names.push_back(text);
+        m_Handles.emplace(std::string_view(text, s.size()), handle);
+        return handle;
+    }
+
+    // Gets the handle of a string without adding it.
+    //
+    // Returns:
+    //   bool - false if the string isn't in the table
+    bool Find(std::string_view s, StringHandle &handle) const
+    {
+        auto found = m_Handles.find(s);
+        if (found == m_Handles.end())
+            return false;
+
+        handle = found->second;
+        return true;
+    }
+
+    // Gets the text of a handle, which must have come from this table.
+    const char *Name(StringHandle handle) const
+    {
+        return m_Names[handle];
+    }
+
+    // Whether a handle came from this table.
+    bool Contains(StringHandle handle) const
+    {
+        return handle < m_Names.size();
+    }
+
+    size_t Size() const
+    {
+        return m_Names.size();
+    }
+
+private:
+    ArenaResource m_Text;
+    std::vector<const char *> m_Names;
+    std::unordered_map<std::string_view, StringHandle> m_Handles;
+};
+
+#endif
@@ -0,0 +1,166 @@
+// Benchmarks for the table renderer in table.hpp.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// The table benchmark writes a table of count rows to the null device.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string>
+
+#include "table.hpp"
+
+#define BENCH_DEFAULT_COUNT 1000000
+
+#ifdef _WIN32
+#define BENCH_NULL_DEVICE "NUL"
+#else
+#define BENCH_NULL_DEVICE "/dev/null"
+#endif
+
+typedef void (*BenchFn)(size_t);
+
+struct Bench
+{
+    const char *name;
+    BenchFn run;
+};
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double NowSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------------
+// A table of count rows, like the one in main.cpp
+
+static constexpr TableColumn benchColumns[] = {
+    {"type", 6, TableAlign::Left},
+    {"value", 5, TableAlign::Right},
+    {"size", 5, TableAlign::Left},
+};
+
+static const char *benchTypes[] = {"char", "short", "int", "long", "float", "double"};
+static const size_t benchSizes[] = {sizeof(char), sizeof(short), sizeof(int), sizeof(long), sizeof(float), sizeof(double)};
+
+template <typename Write>
+static void RunTable(const char *name, size_t count, Write write)
+{
+    std::ofstream out(BENCH_NULL_DEVICE);
+    if (!out)
+    {
+        fprintf(stderr, "can't open %s\n", BENCH_NULL_DEVICE);
+        return;
+    }
+
+    double start = NowSeconds();
+    unsigned long long check = write(out, count);
+    double seconds = NowSeconds() - start;
+    printf("  %-36s %10.2f ns/row  (check %llu)\n", name, seconds * 1e9 / (double)count, check);
+}
+
+static void BenchTable(size_t count)
+{
+    printf("table: %zu rows\n", count);
+
+    // The way main.cpp used to write its table.
+    RunTable("std::format and std::endl", count, [](std::ofstream &out, size_t rows) {
+        unsigned long long bytes = 0;
+        for (size_t i = 0; i < rows; i++)
+        {
+            std::string row = std::format("{:<6} | {:>5} | {:<5} |", benchTypes[i % 6], i % 100000, benchSizes[i % 6]);
+            bytes += row.size() + 1;
+            out << row << std::endl;
+        }
+        return bytes;
+    });
+
+    // The same without a flush on every row, to separate the cost of the
+    // flushes from the cost of the strings.
+    RunTable("std::format and '\\n'", count, [](std::ofstream &out, size_t rows) {
+        unsigned long long bytes = 0;
+        for (size_t i = 0; i < rows; i++)
+        {
+            std::string row = std::format("{:<6} | {:>5} | {:<5} |", benchTypes[i % 6], i % 100000, benchSizes[i % 6]);
+            bytes += row.size() + 1;
+            out << row << '\n';
+        }
+        out.flush();
+        return bytes;
+    });
+
+    RunTable("TableRenderer", count, [](std::ofstream &out, size_t rows) {
+        TableRenderer<benchColumns> table(out);
+        for (size_t i = 0; i < rows; i++)
+        {
+            table.Row(benchTypes[i % 6], i % 100000, benchSizes[i % 6]);
+        }
+        unsigned long long bytes = table.Pending().size();
+        table.Flush();
+        return bytes;
+    });
+
+    // A renderer that's flushed every 1000 rows, which keeps the buffer
+    // small for long tables.
+    RunTable("TableRenderer, flushed every 1000", count, [](std::ofstream &out, size_t rows) {
+        TableRenderer<benchColumns> table(out, 1000);
+        unsigned long long bytes = 0;
+        for (size_t i = 0; i < rows; i++)
+        {
+            table.Row(benchTypes[i % 6], i % 100000, benchSizes[i % 6]);
+            if (i % 1000 == 999)
+            {
+                bytes += table.Pending().size();
+                table.Flush();
+            }
+        }
+        bytes += table.Pending().size();
+        table.Flush();
+        return bytes;
+    });
+}
+
+//----------------------------------------------------------------------------
+
+static const Bench benches[] = {
+    {"table", BenchTable},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    bool found = false;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (const Bench &b : benches)
+    {
+        if (name == NULL || !strcmp(name, b.name))
+        {
+            b.run(count);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -3,4 +3,7 @@
 # according to the GNU docs at https://gcc.gnu.org/onlinedocs/gcc/C-Dialect-Options.html
 
 all:
-	g++ -Wall -Werror -std=c++20 main.cpp -o formatting.out
+	g++ -Wall -Werror -std=c++20 -I../common main.cpp -o formatting.out
+
+bench:
+	g++ -Wall -Werror -std=c++20 -O2 -I../common bench.cpp -o bench.out
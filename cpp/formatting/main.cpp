@@ -9,6 +9,15 @@
 // within the c_cpp_properties.json.
 #include <format>
 
+#include "convert.hpp"
+#include "table.hpp"
+
+static constexpr TableColumn typeColumns[] = {
+    {"type", 6, TableAlign::Left},
+    {"value", 5, TableAlign::Right},
+    {"size", 5, TableAlign::Left},
+};
+
 int main()
 {
     char c = 'a';
@@ -20,15 +29,28 @@ int main()
 
     std::cout << "C++ 20 formatting"                                     << std::endl;
     std::cout << std::format("CHAR_BIT: {}", CHAR_BIT)                   << std::endl;
-    std::cout << "type    value   size"                                  << std::endl;
-    std::cout << "-----------------------------"                         << std::endl;
-    std::cout << std::format("char   | {:>5} | {:<5} |", c,  sizeof(c))  << std::endl;
-    std::cout << std::format("short  | {:>5} | {:<5} |", ns, sizeof(ns)) << std::endl;
-    std::cout << std::format("int    | {:>5} | {:<5} |", ni, sizeof(ni)) << std::endl;
-    std::cout << std::format("long   | {:>5} | {:<5} |", nl, sizeof(nl)) << std::endl;
-    std::cout << std::format("float  | {:>5} | {:<5} |", sf, sizeof(sf)) << std::endl;
-    std::cout << std::format("double | {:>5} | {:<5} |", df, sizeof(df)) << std::endl;
+
+    // The columns of the table are fixed, so the renderer works out the
+    // format string for a row while compiling, formats every row into one
+    // buffer, and writes the whole table at once.
+    TableRenderer<typeColumns> table(std::cout);
+    table.Header();
+    table.Row("char", c, sizeof(c));
+    table.Row("short", ns, sizeof(ns));
+    table.Row("int", ni, sizeof(ni));
+    table.Row("long", nl, sizeof(nl));
+    table.Row("float", sf, sizeof(sf));
+    table.Row("double", df, sizeof(df));
+    table.Flush();
     std::cout << std::endl;
 
+    // std::format interprets its format string on every call. When a value
+    // only needs to become text, PrimitiveToStr converts it straight into a
+    // buffer, choosing the conversion for the type at compile time.
+    char buffer[PRIMITIVE_STR_SIZE];
+    PrimitiveToStr(df, buffer, sizeof(buffer));
+    std::cout << "double without a format string: " << buffer << std::endl;
+    std::cout << "short without a format string:  " << PrimitiveToString(ns) << std::endl;
+
     return 0;
 }
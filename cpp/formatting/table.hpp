@@ -0,0 +1,238 @@
+// Renders text tables whose columns are known at compile time.
+//
+// Formatting a table one std::format call at a time makes a new string for
+// every row, and ending each row with std::endl flushes the stream, which is
+// a system call per row when the stream is a file or a terminal.
+//
+// A TableRenderer is given its columns as a template argument, so their
+// layout is worked out by the compiler: the format string for a row, the
+// header and the rule under it are all constants, and std::format checks the
+// arguments of every row against the columns while compiling. Rows are
+// formatted into one buffer with std::format_to, which is written to the
+// stream by Flush. The buffer keeps its memory, so a renderer that's flushed
+// and reused stops allocating.
+//
+// The columns are declared as a constexpr array:
+//
+//   static constexpr TableColumn columns[] = {
+//       {"type", 6, TableAlign::Left},
+//       {"value", 5, TableAlign::Right},
+//   };
+//
+//   TableRenderer<columns> table(std::cout);
+//   table.Header();
+//   table.Row("int", 4);
+//   table.Flush();
+
+#ifndef TABLE_HPP
+#define TABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// The characters std::format uses for each alignment.
+enum class TableAlign : char
+{
+    Left = '<',
+    Right = '>',
+    Center = '^',
+};
+
+struct TableColumn
+{
+    const char *title;
+    size_t width;
+    TableAlign align;
+};
+
+// Cells are separated by " | " and each row ends with " |", the same as
+// "char   | {:>5} | {:<5} |".
+#define TABLE_SEPARATOR " | "
+#define TABLE_END " |"
+
+// The helpers below build the text of a table while compiling. Each one
+// counts the characters it would write when text is nullptr, so that the
+// text can be put in an array of the right size.
+
+// Calls a function with each column and the text that follows it.
+template <const auto &Columns, typename F>
+constexpr void TableForEachColumn(F &&f)
+{
+    for (size_t i = 0; i < std::size(Columns); i++)
+        f(Columns[i], i + 1 < std::size(Columns) ? std::string_view(TABLE_SEPARATOR) : std::string_view(TABLE_END));
+}
+
+constexpr size_t TableTitleLength(const TableColumn &column)
+{
+    size_t length = 0;
+    while (column.title[length] != '\0')
+        length++;
+    return length;
+}
+
+// Builds the format string of a row. Each column becomes "{:<width}".
+template <const auto &Columns>
+constexpr size_t TableMakeRowFormat(char *text)
+{
+    size_t length = 0;
+    auto put = [&](char c) {
+        if (text != nullptr)
+            text[length] = c;
+        length++;
+    };
+
+    TableForEachColumn<Columns>([&](const TableColumn &column, std::string_view end) {
+        char digits[20] = {};
+        size_t count = 0;
+        size_t width = column.width;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + width % 10);
+            width /= 10;
+        } while (width != 0);
+
+        put('{');
+        put(':');
+        put(static_cast<char>(column.align));
+        while (count > 0)
+            put(digits[--count]);
+        put('}');
+        for (char c : end)
+            put(c);
+    });
+    put('\n');
+    return length;
+}
+
+// Builds the header and the rule under it, which has a '+' under each '|'.
+// The titles are padded here rather than with std::format, which can't run
+// at compile time.
+template <const auto &Columns>
+constexpr size_t TableMakeHeader(char *text)
+{
+    size_t length = 0;
+    auto put = [&](char c) {
+        if (text != nullptr)
+            text[length] = c;
+        length++;
+    };
+
+    TableForEachColumn<Columns>([&](const TableColumn &column, std::string_view end) {
+        size_t title = TableTitleLength(column);
+        size_t pad = column.width > title ? column.width - title : 0;
+        size_t before = column.align == TableAlign::Right ? pad : column.align == TableAlign::Center ? pad / 2 : 0;
+
+        for (size_t i = 0; i < before; i++)
+            put(' ');
+        for (size_t i = 0; i < title; i++)
+            put(column.title[i]);
+        for (size_t i = before; i < pad; i++)
+            put(' ');
+        for (char c : end)
+            put(c);
+    });
+    put('\n');
+
+    TableForEachColumn<Columns>([&](const TableColumn &column, std::string_view end) {
+        size_t title = TableTitleLength(column);
+        for (size_t i = 0; i < (column.width > title ? column.width : title); i++)
+            put('-');
+        for (char c : end)
+            put(c == '|' ? '+' : '-');
+    });
+    put('\n');
+    return length;
+}
+
+template <size_t (*Make)(char *)>
+constexpr auto TableMakeText()
+{
+    std::array<char, Make(nullptr)> text{};
+    Make(text.data());
+    return text;
+}
+
+template <const auto &Columns>
+class TableRenderer
+{
+    static constexpr auto ROW_TEXT = TableMakeText<TableMakeRowFormat<Columns>>();
+    static constexpr auto HEADER_TEXT = TableMakeText<TableMakeHeader<Columns>>();
+
+public:
+    static constexpr size_t COLUMN_COUNT = std::size(Columns);
+
+    static_assert(COLUMN_COUNT > 0, "a table needs at least one column");
+
+    // The format string of a row, such as "{:<6} | {:>5} |\n".
+    static constexpr std::string_view ROW_FORMAT{ROW_TEXT.data(), ROW_TEXT.size()};
+
+    // The titles of the columns and the rule under them.
+    static constexpr std::string_view HEADER{HEADER_TEXT.data(), HEADER_TEXT.size()};
+
+    // The length of a row whose values all fit in their columns, including
+    // the newline.
+    static constexpr size_t ROW_WIDTH = [] {
+        size_t width = 0;
+        for (const TableColumn &column : Columns)
+            width += column.width + sizeof(TABLE_SEPARATOR) - 1;
+        return width - (sizeof(TABLE_SEPARATOR) - sizeof(TABLE_END)) + 1;
+    }();
+
+    explicit TableRenderer(std::ostream &out, size_t reserveRows = 0) : m_Out(out)
+    {
+        m_Buffer.reserve(reserveRows * ROW_WIDTH);
+    }
+
+    TableRenderer(const TableRenderer &) = delete;
+    TableRenderer &operator=(const TableRenderer &) = delete;
+
+    // Writes anything that wasn't flushed.
+    ~TableRenderer()
+    {
+        Flush();
+    }
+
+    // Adds the titles of the columns and a rule under them.
+    void Header()
+    {
+        m_Buffer.append(HEADER.data(), HEADER.size());
+    }
+
+    // Adds a row with one value for each column. Values longer than their
+    // column aren't cut, so they push the rest of the row over.
+    template <typename... Args>
+    void Row(const Args &...args)
+    {
+        static_assert(sizeof...(Args) == COLUMN_COUNT, "a row needs one value for each column");
+        std::format_to(std::back_inserter(m_Buffer), ROW_FORMAT, args...);
+    }
+
+    // Writes the rows added since the last flush to the stream, and flushes
+    // the stream.
+    void Flush()
+    {
+        if (!m_Buffer.empty())
+        {
+            m_Out.write(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+            m_Buffer.clear();
+        }
+        m_Out.flush();
+    }
+
+    // The text that hasn't been flushed yet.
+    std::string_view Pending() const
+    {
+        return m_Buffer;
+    }
+
+private:
+    std::ostream &m_Out;
+    std::string m_Buffer;
+};
+
+#endif
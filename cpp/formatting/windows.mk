@@ -3,4 +3,7 @@
 # std::format is only available when using /std:c++latest.
 
 all:
-	cl /W3 /WX /EHsc /std:c++latest main.cpp /Fe"formatting.exe"
+	cl /W3 /WX /EHsc /std:c++latest /I../common main.cpp /Fe"formatting.exe"
+
+bench:
+	cl /W3 /WX /EHsc /std:c++latest /O2 /I../common bench.cpp /Fe"bench.exe"
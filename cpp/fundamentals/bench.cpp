@@ -0,0 +1,217 @@
+// Benchmarks for the fundamentals examples.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// Each benchmark appends count elements.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "growable_buffer.hpp"
+
+#define EXAMPLE_BUFFER_SIZE 16
+
+// Resizing to the exact size on every append is quadratic, so the default
+// count is kept small enough for it to finish quickly.
+#define BENCH_DEFAULT_COUNT 50000
+
+typedef unsigned char my_byte;
+
+typedef void (*bench_fn)(size_t);
+
+typedef struct bench
+{
+    const char *name;
+    bench_fn run;
+} bench;
+
+// A naive implementation of array resizing.
+// This macro creates a new array, copies the contents of the old array into
+// the new array, then deletes the old array.
+//
+// Params:
+//   t - the type of each element
+//   src - the original array
+//   s0 - the size of the original array
+//   s1 - the size of the new array
+#define naive_realloc(t, src, s0, s1)                 \
+    {                                                 \
+        t *dest = new t[(s1)];                        \
+        for (size_t i = 0; i < (s0) && i < (s1); i++) \
+            dest[i] = src[i];                         \
+        delete[] src;                                 \
+        src = dest;                                   \
+    }
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char *name, size_t count, double seconds, unsigned long long check)
+{
+    printf("  %-28s %12.2f ns/append  (check %llX)\n", name, seconds * 1e9 / (double)count, check);
+}
+
+//----------------------------------------------------------------------------
+// append: one element at a time with naive_realloc, GrowableBuffer and
+// std::vector
+
+static void bench_append(size_t count)
+{
+    double start;
+
+    printf("append: %zu elements\n", count);
+
+    {
+        my_byte *data = new my_byte[1];
+        size_t size = 0;
+        unsigned long long check = 0;
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+        {
+            naive_realloc(my_byte, data, size, size + 1);
+            data[size++] = (my_byte)i;
+        }
+        for (size_t i = 0; i < size; i++)
+            check += data[i];
+        report("my_byte naive_realloc", count, now_seconds() - start, check);
+        delete[] data;
+    }
+
+    {
+        GrowableBuffer<my_byte, EXAMPLE_BUFFER_SIZE> data;
+        unsigned long long check = 0;
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            data.PushBack((my_byte)i);
+        for (my_byte v : data)
+            check += v;
+        report("my_byte GrowableBuffer", count, now_seconds() - start, check);
+    }
+
+    {
+        std::vector<my_byte> data;
+        unsigned long long check = 0;
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            data.push_back((my_byte)i);
+        for (my_byte v : data)
+            check += v;
+        report("my_byte std::vector", count, now_seconds() - start, check);
+    }
+
+    // Strings can't be copied as bytes, so GrowableBuffer moves them.
+    // Every naive resize copies every string, which is so slow that it only
+    // appends a tenth as many.
+    {
+        std::string *data = new std::string[1];
+        size_t size = 0;
+        size_t naive_count = count / 10;
+        unsigned long long check = 0;
+
+        start = now_seconds();
+        for (size_t i = 0; i < naive_count; i++)
+        {
+            naive_realloc(std::string, data, size, size + 1);
+            data[size++] = "a string too long to fit in place";
+        }
+        for (size_t i = 0; i < size; i++)
+            check += data[i].size();
+        report("std::string naive_realloc", naive_count, now_seconds() - start, check);
+        delete[] data;
+    }
+
+    {
+        GrowableBuffer<std::string, EXAMPLE_BUFFER_SIZE> data;
+        unsigned long long check = 0;
+
+        start = now_seconds();
+        for (size_t i = 0; i < count; i++)
+            data.PushBack("a string too long to fit in place");
+        for (const std::string &v : data)
+            check += v.size();
+        report("std::string GrowableBuffer", count, now_seconds() - start, check);
+    }
+}
+
+//----------------------------------------------------------------------------
+// small: many short-lived buffers that never leave the inline storage
+
+static void bench_small(size_t count)
+{
+    unsigned long long check = 0;
+    double start;
+
+    printf("small: %zu buffers of %d bytes\n", count, EXAMPLE_BUFFER_SIZE);
+
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+    {
+        GrowableBuffer<my_byte, EXAMPLE_BUFFER_SIZE> data;
+        for (int j = 0; j < EXAMPLE_BUFFER_SIZE; j++)
+            data.PushBack((my_byte)(i + j));
+        check += data[i % EXAMPLE_BUFFER_SIZE];
+    }
+    report("GrowableBuffer", count * EXAMPLE_BUFFER_SIZE, now_seconds() - start, check);
+
+    check = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < count; i++)
+    {
+        std::vector<my_byte> data;
+        for (int j = 0; j < EXAMPLE_BUFFER_SIZE; j++)
+            data.push_back((my_byte)(i + j));
+        check += data[i % EXAMPLE_BUFFER_SIZE];
+    }
+    report("std::vector", count * EXAMPLE_BUFFER_SIZE, now_seconds() - start, check);
+}
+
+//----------------------------------------------------------------------------
+
+static const bench benches[] = {
+    {"append", bench_append},
+    {"small", bench_small},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    int found = 0;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (name == NULL || !strcmp(name, benches[i].name))
+        {
+            benches[i].run(count);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#ifndef GROWABLE_BUFFER_HPP
+#define GROWABLE_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A growable array that keeps up to N elements inside the object itself and
+// moves to the heap once it needs more room.
+//
+// The capacity doubles every time it runs out, so appending n elements one
+// at a time only copies about 2n elements in total instead of the n * n / 2
+// of resizing to the exact size on every append.
+//
+// Elements of trivially copyable types, like my_byte, are grown with
+// realloc, which can often extend the allocation in place without copying
+// anything. Other types are moved into the new memory one at a time with
+// std::move.
+template <typename T, size_t N>
+class GrowableBuffer
+{
+    static constexpr bool IsTrivial = std::is_trivially_copyable<T>::value;
+
+    // malloc and operator new only promise the alignment of max_align_t.
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+public:
+    GrowableBuffer() : m_Data(InlineData()), m_Size(0), m_Cap(N)
+    {
+    }
+
+    ~GrowableBuffer()
+    {
+        Clear();
+        Release();
+    }
+
+    // A buffer that may own memory on the heap can't be copied implicitly.
+    GrowableBuffer(const GrowableBuffer &) = delete;
+    GrowableBuffer &operator=(const GrowableBuffer &) = delete;
+
+    // Moving only copies pointers, unless the elements are still inline and
+    // have to be moved one at a time, which can only throw if T's move
+    // constructor can.
+    GrowableBuffer(GrowableBuffer &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : m_Data(InlineData()), m_Size(0), m_Cap(N)
+    {
+        Take(other);
+    }
+
+    GrowableBuffer &operator=(GrowableBuffer &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other)
+        {
+            Clear();
+            Release();
+            m_Data = InlineData();
+            m_Cap = N;
+            Take(other);
+        }
+        return *this;
+    }
+
+    T *Data() { return m_Data; }
+    const T *Data() const { return m_Data; }
+    size_t Size() const { return m_Size; }
+    size_t Capacity() const { return m_Cap; }
+    bool Empty() const { return m_Size == 0; }
+
+    // Whether the elements are still stored inside the object.
+    bool IsSmall() const { return m_Data == InlineData(); }
+
+    T &operator[](size_t i) { return m_Data[i]; }
+    const T &operator[](size_t i) const { return m_Data[i]; }
+
+    T *begin() { return m_Data; }
+    T *end() { return m_Data + m_Size; }
+    const T *begin() const { return m_Data; }
+    const T *end() const { return m_Data + m_Size; }
+
+    // Ensures the buffer can hold at least n elements without growing again.
+    void Reserve(size_t n)
+    {
+        if (n > m_Cap)
+            Grow(n);
+    }
+
+    void PushBack(const T &value)
+    {
+        if (m_Size == m_Cap)
+        {
+            // value may be an element of this buffer, so it's copied before
+            // the elements move.
+            T copy(value);
+            Grow(m_Size + 1);
+            new (m_Data + m_Size) T(std::move(copy));
+        }
+        else
+        {
+            new (m_Data + m_Size) T(value);
+        }
+        m_Size++;
+    }
+
+    void PushBack(T &&value)
+    {
+        if (m_Size == m_Cap)
+        {
+            T moved(std::move(value));
+            Grow(m_Size + 1);
+            new (m_Data + m_Size) T(std::move(moved));
+        }
+        else
+        {
+            new (m_Data + m_Size) T(std::move(value));
+        }
+        m_Size++;
+    }
+
+    // Appends n elements copied from an array that is not part of this
+    // buffer.
+    void Append(const T *values, size_t n)
+    {
+        Reserve(m_Size + n);
+        if constexpr (IsTrivial)
+        {
+            if (n > 0)
+                memcpy(static_cast<void *>(m_Data + m_Size), values, n * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                new (m_Data + m_Size + i) T(values[i]);
+        }
+        m_Size += n;
+    }
+
+    // Changes the number of elements. New elements are value-initialized,
+    // so new bytes are 0.
+    void Resize(size_t n)
+    {
+        Reserve(n);
+        for (size_t i = m_Size; i < n; i++)
+            new (m_Data + i) T();
+        for (size_t i = n; i < m_Size; i++)
+            m_Data[i].~T();
+        m_Size = n;
+    }
+
+    // Destroys every element but keeps the memory.
+    void Clear()
+    {
+        if constexpr (!std::is_trivially_destructible<T>::value)
+        {
+            for (size_t i = 0; i < m_Size; i++)
+                m_Data[i].~T();
+        }
+        m_Size = 0;
+    }
+
+private:
+    T *m_Data;
+    size_t m_Size;
+    size_t m_Cap;
+
+    // Room for N elements. An array of size 0 isn't allowed, so there's
+    // always room for at least one byte.
+    alignas(T) unsigned char m_Inline[N > 0 ? N * sizeof(T) : 1];
+
+    T *InlineData() { return reinterpret_cast<T *>(m_Inline); }
+    const T *InlineData() const { return reinterpret_cast<const T *>(m_Inline); }
+
+    void Grow(size_t n)
+    {
+        size_t cap = m_Cap > 0 ? m_Cap : 1;
+        while (cap < n)
+        {
+            if (cap > static_cast<size_t>(-1) / 2 / sizeof(T))
+                throw std::bad_alloc();
+            cap *= 2;
+        }
+
+        if constexpr (IsTrivial)
+        {
+            // Trivially copyable elements can be moved by copying their
+            // bytes, so realloc is free to move or extend the allocation.
+            T *dest;
+            if (IsSmall())
+            {
+                dest = static_cast<T *>(malloc(cap * sizeof(T)));
+                if (dest != nullptr && m_Size > 0)
+                    memcpy(static_cast<void *>(dest), m_Data, m_Size * sizeof(T));
+            }
+            else
+            {
+                dest = static_cast<T *>(realloc(m_Data, cap * sizeof(T)));
+            }
+
+            if (dest == nullptr)
+                throw std::bad_alloc();
+            m_Data = dest;
+        }
+        else
+        {
+            T *dest = static_cast<T *>(::operator new(cap * sizeof(T)));
+            for (size_t i = 0; i < m_Size; i++)
+            {
+                new (dest + i) T(std::move(m_Data[i]));
+                m_Data[i].~T();
+            }
+            Release();
+            m_Data = dest;
+        }
+
+        m_Cap = cap;
+    }
+
+    // Frees the heap memory, if any, without destroying elements.
+    void Release()
+    {
+        if (IsSmall())
+            return;
+
+        if constexpr (IsTrivial)
+            free(m_Data);
+        else
+            ::operator delete(m_Data);
+    }
+
+    // Takes the elements of another buffer, leaving it empty.
+    // This buffer must be empty and small.
+    void Take(GrowableBuffer &other)
+    {
+        if (other.IsSmall())
+        {
+            for (size_t i = 0; i < other.m_Size; i++)
+                new (m_Data + i) T(std::move(other.m_Data[i]));
+            m_Size = other.m_Size;
+            other.Clear();
+        }
+        else
+        {
+            m_Data = other.m_Data;
+            m_Size = other.m_Size;
+            m_Cap = other.m_Cap;
+            other.m_Data = other.InlineData();
+            other.m_Size = 0;
+            other.m_Cap = N;
+        }
+    }
+};
+
+#endif
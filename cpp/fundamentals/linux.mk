@@ -1,2 +1,14 @@
+# growable_buffer.hpp uses if constexpr and ../common/memory.hpp uses
+# std::pmr, so we use the -std=c++17 flag.
+#
+# print_array and print_bits use the hex dump and bitset code from the C
+# fundamentals example. g++ compiles them as C++ even though their names end
+# in .c.
+
+C_FUNDAMENTALS = ../../c/fundamentals
+
 all:
-	g++ -Wall -Werror main.cpp -o fundamentals.out
+	g++ -Wall -Werror -std=c++17 -I../common -I$(C_FUNDAMENTALS) main.cpp $(C_FUNDAMENTALS)/bitset.c $(C_FUNDAMENTALS)/hexdump.c -o fundamentals.out
+
+bench:
+	g++ -Wall -Werror -std=c++17 -O2 -I../common bench.cpp -o bench.out
@@ -1,2 +1,15 @@
+# growable_buffer.hpp uses if constexpr and ../common/memory.hpp uses
+# std::pmr, so we use the -std=c++17 flag.
+#
+# print_array and print_bits use the hex dump and bitset code from the C
+# fundamentals example. clang++ also compiles them as C++, but warns that
+# doing so for .c files is deprecated, which -Werror makes an error. The
+# -x c++ flag says that C++ is what we want.
+
+C_FUNDAMENTALS = ../../c/fundamentals
+
 all:
-	clang++ -Wall -Werror main.cpp -o fundamentals.out
+	clang++ -Wall -Werror -std=c++17 -I../common -I$(C_FUNDAMENTALS) main.cpp -x c++ $(C_FUNDAMENTALS)/bitset.c $(C_FUNDAMENTALS)/hexdump.c -o fundamentals.out
+
+bench:
+	clang++ -Wall -Werror -std=c++17 -O2 -I../common bench.cpp -o bench.out
@@ -6,6 +6,18 @@
 #include <cstdio>
 #include <climits>
 
+// Headers from the C fundamentals example. They wrap their declarations in
+// extern "C", which windows.mk needs because cl compiles bitset.c and
+// hexdump.c as C. The other makefiles compile them as C++, where the
+// functions get C linkage from the same headers, so both ways link.
+#include "bitset.h"
+#include "hexdump.h"
+
+#include <vector>
+
+#include "growable_buffer.hpp"
+#include "memory.hpp"
+
 #define EXAMPLE_BUFFER_SIZE 16
 
 // custom types
@@ -22,11 +34,20 @@ typedef struct my_object
     my_callback callback; // function with typedef
 } my_object;
 
+// The number of bytes print_array converts before each write.
+#define PRINT_ARRAY_CHUNK 256
+
 void print_array(const my_byte *a, size_t s)
 {
-    for (size_t i = 0; i < s; i++)
+    // Calling printf("%X ", a[i]) for every byte is slow for large arrays,
+    // so the bytes are converted to text in chunks by hex_bytes and each
+    // chunk is written at once. hex_bytes always writes two digits, so a
+    // byte that "%X" printed as "F" is printed as "0F".
+    char text[HEX_BYTES_SIZE(PRINT_ARRAY_CHUNK)];
+    for (size_t i = 0; i < s; i += PRINT_ARRAY_CHUNK)
     {
-        printf("%X ", a[i]);
+        size_t n = s - i < PRINT_ARRAY_CHUNK ? s - i : PRINT_ARRAY_CHUNK;
+        fwrite(text, 1, hex_bytes(a + i, n, HEX_UPPERCASE, HEX_KERNEL_AUTO, text), stdout);
     }
     printf("\n");
 }
@@ -53,11 +74,9 @@ void greet()
 
 void print_bits(my_byte b)
 {
-    for (int i = 0; i < CHAR_BIT; i++)
-    {
-        putc((b & (1 << (CHAR_BIT - i - 1))) ? '1' : '0', stdout);
-    }
-    putc('\n', stdout);
+    char text[BITS_RENDER_SIZE(1) + 1];
+    text[bits_render(&b, 1, BIT_KERNEL_AUTO, text)] = '\n';
+    fwrite(text, 1, sizeof(text), stdout);
 }
 
 void multiply_by_reference(int &a, int b)
@@ -65,24 +84,6 @@ void multiply_by_reference(int &a, int b)
     a *= b;
 }
 
-// A naive implementation of array resizing.
-// This macro creates a new array, copies the contents of the old array into
-// the new array, then deletes the old array.
-//
-// Params:
-//   t - the type of each element
-//   src - the original array
-//   s0 - the size of the original array
-//   s1 - the size of the new array
-#define naive_realloc(t, src, s0, s1)                 \
-    {                                                 \
-        t *dest = new t[(s1)];                        \
-        for (size_t i = 0; i < (s0) && i < (s1); i++) \
-            dest[i] = src[i];                         \
-        delete[] src;                                 \
-        src = dest;                                   \
-    }
-
 int main()
 {
     //------------------------------------------------------------------------
@@ -145,21 +146,48 @@ int main()
 
     // There is currently no C++ version of realloc for plain arrays.
     // For such functionality, either allocate an array the C way, or use
-    // something like std::vector.
-
-    dy_size += 8;
-    naive_realloc(my_byte, dy_data, dy_size, dy_size - 8);
-    for (size_t i = dy_size - 8; i < dy_size; i++)
+    // something like std::vector or GrowableBuffer.
+    //
+    // GrowableBuffer keeps up to EXAMPLE_BUFFER_SIZE bytes inside itself,
+    // then moves to the heap and doubles its capacity whenever it fills up,
+    // using realloc since bytes can be copied as-is.
+    GrowableBuffer<my_byte, EXAMPLE_BUFFER_SIZE> grow_data;
+    grow_data.Append(dy_data, dy_size);
+    std::cout << "growable buffer stored inline: " << (grow_data.IsSmall() ? "yes" : "no") << std::endl;
+
+    for (size_t i = dy_size; i < dy_size + 8; i++)
     {
-        dy_data[i] = b + (my_byte)i;
+        grow_data.PushBack(b + (my_byte)i);
     }
-    print_array(dy_data, dy_size);
+    std::cout << "growable buffer stored inline: " << (grow_data.IsSmall() ? "yes" : "no")
+              << ", capacity: " << grow_data.Capacity() << std::endl;
+    print_array(grow_data.Data(), grow_data.Size());
 
     // Free any memory allocated with new.
     // If an array was allocated with new, then the delete keyword should have
     // the [] suffix.
     delete[] dy_data;
 
+    // Buffers that only live for a short time, like the ones used while
+    // handling a single request, can come from an arena instead. Allocating
+    // only moves a pointer forward, and Reset takes everything back at once.
+    ArenaResource arena;
+    my_byte *arena_data = static_cast<my_byte *>(arena.allocate(dy_size, alignof(my_byte)));
+    for (size_t i = 0; i < dy_size; i++)
+    {
+        arena_data[i] = b + (my_byte)i;
+    }
+    print_array(arena_data, dy_size);
+
+    // Standard containers can use the arena through std::pmr. Anything using
+    // the arena must be gone before Reset, so the vector gets its own scope.
+    {
+        std::pmr::vector<my_byte> arena_vector(&arena);
+        arena_vector.assign(arena_data, arena_data + dy_size);
+        std::cout << "bytes taken from the arena: " << arena.BytesAllocated() << std::endl;
+    }
+    arena.Reset();
+
     //------------------------------------------------------------------------
     // passing functions as arguments
     do_callback_without_typedef(example_add);
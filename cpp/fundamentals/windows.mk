@@ -1,2 +1,13 @@
+# growable_buffer.hpp uses if constexpr and ../common/memory.hpp uses
+# std::pmr, so we use the /std:c++17 flag.
+#
+# print_array and print_bits use the hex dump and bitset code from the C
+# fundamentals example, which cl compiles as C because of their names.
+
+C_FUNDAMENTALS = ../../c/fundamentals
+
 all:
-	cl /W3 /WX /EHsc main.cpp /Fe"fundamentals.exe"
+	cl /W3 /WX /EHsc /std:c++17 /I../common /I$(C_FUNDAMENTALS) main.cpp $(C_FUNDAMENTALS)/bitset.c $(C_FUNDAMENTALS)/hexdump.c /Fe"fundamentals.exe"
+
+bench:
+	cl /W3 /WX /EHsc /std:c++17 /O2 /I../common bench.cpp /Fe"bench.exe"
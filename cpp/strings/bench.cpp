@@ -0,0 +1,547 @@
+// Benchmarks for the string conversions in ../common/convert.hpp and the
+// searches in search.hpp.
+//
+// Usage:
+//   bench.out [name] [count]
+//
+// If no name is given, every benchmark is run.
+// The convert benchmark converts count values of each type, the search
+// benchmarks search count lines of a generated log, and the build benchmark
+// builds count messages.
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "convert.hpp"
+#include "search.hpp"
+#include "string_builder.hpp"
+
+#define BENCH_DEFAULT_COUNT 1000000
+
+// The longest string generated for a value, including the terminator.
+#define BENCH_STR_SIZE 32
+
+//----------------------------------------------------------------------------
+// The C way, from c/strings/convert.c: a type enumeration, a void pointer,
+// and a switch on every call.
+
+enum MyType
+{
+    MY_TYPE_CHAR = 0,
+    MY_TYPE_UNSIGNED_CHAR,
+    MY_TYPE_SHORT,
+    MY_TYPE_UNSIGNED_SHORT,
+    MY_TYPE_INT,
+    MY_TYPE_UNSIGNED_INT,
+    MY_TYPE_LONG,
+    MY_TYPE_UNSIGNED_LONG,
+    MY_TYPE_LONG_LONG,
+    MY_TYPE_UNSIGNED_LONG_LONG,
+    MY_TYPE_FLOAT,
+    MY_TYPE_DOUBLE,
+    MY_TYPE_LONG_DOUBLE,
+    MY_TYPE_MAX,
+};
+
+// Assigns a value, v, to a destination pointed to by pointer p.
+// The value is cast as type t.
+#define as_value(t, v, p) *((t *)p) = (t)v
+
+static int RuntimeStrToPrimitive(const char *str, MyType type, void *dest)
+{
+    long l_res = 0;
+    unsigned long ul_res = 0;
+    long long ll_res = 0;
+    unsigned long long ull_res = 0;
+    float f_res = 0;
+    double d_res = 0;
+    long double ld_res = 0;
+
+    errno = 0;
+
+    if      (type <= MY_TYPE_LONG)               l_res   = strtol   (str, NULL, 10);
+    else if (type == MY_TYPE_UNSIGNED_LONG)      ul_res  = strtoul  (str, NULL, 10);
+    else if (type == MY_TYPE_LONG_LONG)          ll_res  = strtoll  (str, NULL, 10);
+    else if (type == MY_TYPE_UNSIGNED_LONG_LONG) ull_res = strtoull (str, NULL, 10);
+    else if (type == MY_TYPE_FLOAT)              f_res   = strtof   (str, NULL);
+    else if (type == MY_TYPE_DOUBLE)             d_res   = strtod   (str, NULL);
+    else if (type == MY_TYPE_LONG_DOUBLE)        ld_res  = strtold  (str, NULL);
+
+    if (errno == ERANGE)
+        return 1;
+
+    switch (type)
+    {
+    case MY_TYPE_CHAR:               as_value(char,               l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_CHAR:      as_value(unsigned char,      l_res,   dest);  return 0;
+    case MY_TYPE_SHORT:              as_value(short,              l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_SHORT:     as_value(unsigned short,     l_res,   dest);  return 0;
+    case MY_TYPE_INT:                as_value(int,                l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_INT:       as_value(unsigned int,       l_res,   dest);  return 0;
+    case MY_TYPE_LONG:               as_value(long,               l_res,   dest);  return 0;
+    case MY_TYPE_UNSIGNED_LONG:      as_value(unsigned long,      ul_res,  dest);  return 0;
+    case MY_TYPE_LONG_LONG:          as_value(long long,          ll_res,  dest);  return 0;
+    case MY_TYPE_UNSIGNED_LONG_LONG: as_value(unsigned long long, ull_res, dest);  return 0;
+    case MY_TYPE_FLOAT:              as_value(float,              f_res,   dest);  return 0;
+    case MY_TYPE_DOUBLE:             as_value(double,             d_res,   dest);  return 0;
+    case MY_TYPE_LONG_DOUBLE:        as_value(long double,        ld_res,  dest);  return 0;
+    default: return 1;
+    }
+}
+
+static int RuntimePrimitiveToStr(const void *value, MyType type, char *buffer, size_t s)
+{
+    switch (type)
+    {
+    case MY_TYPE_CHAR:               return snprintf(buffer, s, "%c",    *(const char *)value);
+    case MY_TYPE_UNSIGNED_CHAR:      return snprintf(buffer, s, "%c",    *(const unsigned char *)value);
+    case MY_TYPE_SHORT:              return snprintf(buffer, s, "%hd",   *(const short *)value);
+    case MY_TYPE_UNSIGNED_SHORT:     return snprintf(buffer, s, "%hu",   *(const unsigned short *)value);
+    case MY_TYPE_INT:                return snprintf(buffer, s, "%d",    *(const int *)value);
+    case MY_TYPE_UNSIGNED_INT:       return snprintf(buffer, s, "%u",    *(const unsigned int *)value);
+    case MY_TYPE_LONG:               return snprintf(buffer, s, "%ld",   *(const long *)value);
+    case MY_TYPE_UNSIGNED_LONG:      return snprintf(buffer, s, "%lu",   *(const unsigned long *)value);
+    case MY_TYPE_LONG_LONG:          return snprintf(buffer, s, "%lld",  *(const long long *)value);
+    case MY_TYPE_UNSIGNED_LONG_LONG: return snprintf(buffer, s, "%llu",  *(const unsigned long long *)value);
+    case MY_TYPE_FLOAT:              return snprintf(buffer, s, "%.9g",  *(const float *)value);
+    case MY_TYPE_DOUBLE:             return snprintf(buffer, s, "%.17g", *(const double *)value);
+    case MY_TYPE_LONG_DOUBLE:        return snprintf(buffer, s, "%.21Lg", *(const long double *)value);
+    default:                         return -1;
+    }
+}
+
+//----------------------------------------------------------------------------
+
+typedef void (*BenchFn)(size_t);
+
+struct Bench
+{
+    const char *name;
+    BenchFn run;
+};
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * Returns:
+ *   double - the time in seconds
+ */
+static double NowSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Fills a pool with one string per value that fits in the given type.
+ *
+ * Params:
+ *   std::vector<char>& - a pool with room for every string
+ *   std::vector<const char*>& - receives a pointer to each string
+ */
+template <Primitive T>
+static void MakeStrings(std::vector<char> &pool, std::vector<const char *> &strs)
+{
+    unsigned long long limit = std::is_floating_point_v<T> ? 100000ULL
+                               : sizeof(T) >= 8           ? 1000000000000000000ULL
+                               : sizeof(T) >= 4           ? 1000000000ULL
+                                                          : static_cast<unsigned long long>(std::numeric_limits<T>::max());
+    unsigned long long seed = 24601;
+
+    for (size_t i = 0; i < strs.size(); i++)
+    {
+        char *str = pool.data() + i * BENCH_STR_SIZE;
+        long long v;
+
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        v = static_cast<long long>((seed >> 11) % limit);
+        if (std::is_signed_v<T> && (seed & 0x400))
+            v = -v;
+
+        if constexpr (std::is_floating_point_v<T>)
+            snprintf(str, BENCH_STR_SIZE, "%lld.%03d", v, static_cast<int>((seed >> 40) % 1000));
+        else
+            snprintf(str, BENCH_STR_SIZE, "%lld", v);
+
+        strs[i] = str;
+    }
+}
+
+//----------------------------------------------------------------------------
+// convert: the runtime switch versus templates, in both directions
+
+template <Primitive T>
+static void BenchType(const char *name, MyType type, size_t count)
+{
+    std::vector<char> pool(count * BENCH_STR_SIZE);
+    std::vector<const char *> strs(count);
+    std::vector<T> runtime(count);
+    std::vector<T> compiled(count);
+    char buffer[PRIMITIVE_STR_SIZE];
+    unsigned long long runtime_len = 0;
+    unsigned long long compiled_len = 0;
+    double parse_runtime;
+    double parse_compiled;
+    double format_runtime;
+    double format_compiled;
+    double start;
+
+    MakeStrings<T>(pool, strs);
+
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i++)
+        RuntimeStrToPrimitive(strs[i], type, &runtime[i]);
+    parse_runtime = NowSeconds() - start;
+
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i++)
+        StrToPrimitive(strs[i], compiled[i]);
+    parse_compiled = NowSeconds() - start;
+
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i++)
+        runtime_len += RuntimePrimitiveToStr(&runtime[i], type, buffer, sizeof(buffer));
+    format_runtime = NowSeconds() - start;
+
+    start = NowSeconds();
+    for (size_t i = 0; i < count; i++)
+        compiled_len += PrimitiveToStr(compiled[i], buffer, sizeof(buffer));
+    format_compiled = NowSeconds() - start;
+
+    printf("  %-20s %10.2f %10.2f %10.2f %10.2f%s\n",
+           name,
+           parse_runtime * 1e9 / static_cast<double>(count),
+           parse_compiled * 1e9 / static_cast<double>(count),
+           format_runtime * 1e9 / static_cast<double>(count),
+           format_compiled * 1e9 / static_cast<double>(count),
+           runtime != compiled ? "  (results differ)" : "");
+
+    // Keep the formatting loops from being optimized away.
+    if (runtime_len == 0 || compiled_len == 0)
+        printf("  nothing was formatted\n");
+}
+
+static void BenchConvert(size_t count)
+{
+    printf("convert: %zu values per type, in ns per value\n", count);
+    printf("  %-20s %10s %10s %10s %10s\n", "", "parse", "parse", "format", "format");
+    printf("  %-20s %10s %10s %10s %10s\n", "type", "switch", "template", "switch", "template");
+
+    BenchType<char>              ("char",               MY_TYPE_CHAR,               count);
+    BenchType<unsigned char>     ("unsigned char",      MY_TYPE_UNSIGNED_CHAR,      count);
+    BenchType<short>             ("short",              MY_TYPE_SHORT,              count);
+    BenchType<unsigned short>    ("unsigned short",     MY_TYPE_UNSIGNED_SHORT,     count);
+    BenchType<int>               ("int",                MY_TYPE_INT,                count);
+    BenchType<unsigned int>      ("unsigned int",       MY_TYPE_UNSIGNED_INT,       count);
+    BenchType<long>              ("long",               MY_TYPE_LONG,               count);
+    BenchType<unsigned long>     ("unsigned long",      MY_TYPE_UNSIGNED_LONG,      count);
+    BenchType<long long>         ("long long",          MY_TYPE_LONG_LONG,          count);
+    BenchType<unsigned long long>("unsigned long long", MY_TYPE_UNSIGNED_LONG_LONG, count);
+    BenchType<float>             ("float",              MY_TYPE_FLOAT,              count);
+    BenchType<double>            ("double",             MY_TYPE_DOUBLE,             count);
+    BenchType<long double>       ("long double",        MY_TYPE_LONG_DOUBLE,        count);
+}
+
+//----------------------------------------------------------------------------
+// Generated log lines for the search benchmarks
+
+// Words that make up most of every line.
+static const char *logWords[] = {
+    "request", "served", "from", "cache", "in", "ms", "connection", "opened", "closed", "by", "peer",
+    "worker", "started", "job", "queued", "retrying", "bytes", "sent", "received", "session", "path=/index",
+    "status=200", "status=404", "method=GET", "method=POST", "region=us-east", "region=eu-west", "ok",
+};
+
+// The markers searched for. Most of them are rare, as they would be in a
+// real log.
+static const std::string_view logMarkers[] = {
+    "ERROR", "FATAL", "WARN", "timeout", "refused", "panic", "segfault", "out of memory",
+    "user=admin", "user=root", "status=500", "status=503", "deadlock", "OOMKilled", "retry budget",
+    "corrupt", "checksum", "denied", "unauthorized", "forbidden", "overflow", "underflow", "NaN",
+    "stack trace", "core dumped", "leak", "throttled", "evicted", "rollback", "failover", "split brain",
+    "disk full",
+};
+
+#define LOG_MARKER_COUNT (sizeof(logMarkers) / sizeof(logMarkers[0]))
+
+// Makes lines like "12:34:56 INFO worker started job ..." where about 1 in
+// 50 lines also has a marker.
+static void MakeLog(size_t lines, std::string &log, std::vector<std::string_view> &views)
+{
+    static const char *levels[] = {"INFO", "INFO", "INFO", "DEBUG"};
+    std::vector<size_t> starts;
+    unsigned long long seed = 24601;
+    char stamp[16];
+
+    for (size_t i = 0; i < lines; i++)
+    {
+        starts.push_back(log.size());
+        snprintf(stamp, sizeof(stamp), "%02zu:%02zu:%02zu ", i / 3600 % 24, i / 60 % 60, i % 60);
+        log += stamp;
+
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        log += levels[(seed >> 40) % 4];
+
+        int words = 6 + (int)((seed >> 20) % 8);
+        for (int w = 0; w < words; w++)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            log += ' ';
+            if ((seed >> 33) % 400 == 0)
+                log += logMarkers[(seed >> 10) % LOG_MARKER_COUNT];
+            else
+                log += logWords[(seed >> 40) % (sizeof(logWords) / sizeof(logWords[0]))];
+        }
+        log += '\n';
+    }
+
+    // The views are made after the log stops growing.
+    for (size_t i = 0; i < lines; i++)
+    {
+        size_t end = i + 1 < lines ? starts[i + 1] : log.size();
+        views.emplace_back(log.data() + starts[i], end - starts[i] - 1);
+    }
+}
+
+static void ReportSearch(const char *name, size_t bytes, double seconds, size_t matches)
+{
+    printf("  %-40s %8.3f GB/s  (%zu matches)\n", name, (double)bytes / 1e9 / seconds, matches);
+}
+
+//----------------------------------------------------------------------------
+// search: every place one pattern appears in the whole log
+
+template <typename Find>
+static void RunSearch(const char *name, std::string_view log, std::string_view pattern, Find find)
+{
+    size_t matches = 0;
+    double start = NowSeconds();
+
+    for (size_t pos = find(log, 0); pos != std::string_view::npos; pos = find(log, pos + pattern.size()))
+        matches++;
+
+    ReportSearch(name, log.size(), NowSeconds() - start, matches);
+}
+
+static void BenchSearch(size_t count)
+{
+    std::string log;
+    std::vector<std::string_view> lines;
+    MakeLog(count, log, lines);
+
+    printf("search: %zu lines, %zu bytes\n", count, log.size());
+
+    for (std::string_view pattern : {std::string_view("user=admin"), std::string_view("status=404")})
+    {
+        Pattern compiled(pattern);
+        std::boyer_moore_horspool_searcher horspool(pattern.begin(), pattern.end());
+
+        printf(" \"%.*s\"\n", (int)pattern.size(), pattern.data());
+
+        RunSearch("std::string_view::find", log, pattern, [&](std::string_view text, size_t from) {
+            return text.find(pattern, from);
+        });
+
+        RunSearch("std::boyer_moore_horspool_searcher", log, pattern, [&](std::string_view text, size_t from) {
+            auto found = std::search(text.begin() + from, text.end(), horspool);
+            return found == text.end() ? std::string_view::npos : (size_t)(found - text.begin());
+        });
+
+        RunSearch("Pattern::Find", log, pattern, [&](std::string_view text, size_t from) {
+            return compiled.Find(text, from);
+        });
+    }
+}
+
+//----------------------------------------------------------------------------
+// markers: which of 32 markers each line of the log has
+
+static void BenchMarkers(size_t count)
+{
+    std::string log;
+    std::vector<std::string_view> lines;
+    std::vector<Pattern> patterns;
+    MultiPattern markers(std::vector<std::string_view>(std::begin(logMarkers), std::end(logMarkers)));
+    size_t matches;
+    double start;
+
+    MakeLog(count, log, lines);
+    for (std::string_view marker : logMarkers)
+        patterns.emplace_back(marker);
+
+    printf("markers: %zu lines, %zu bytes, %zu markers, %zu states\n", count, log.size(), LOG_MARKER_COUNT,
+           markers.States());
+
+    matches = 0;
+    start = NowSeconds();
+    for (std::string_view line : lines)
+    {
+        for (std::string_view marker : logMarkers)
+            matches += line.find(marker) != std::string_view::npos;
+    }
+    ReportSearch("std::string_view::find for each marker", log.size(), NowSeconds() - start, matches);
+
+    matches = 0;
+    start = NowSeconds();
+    for (std::string_view line : lines)
+    {
+        for (const Pattern &pattern : patterns)
+            matches += pattern.Contains(line);
+    }
+    ReportSearch("Pattern::Contains for each marker", log.size(), NowSeconds() - start, matches);
+
+    matches = 0;
+    start = NowSeconds();
+    for (std::string_view line : lines)
+        matches += (size_t)std::popcount(markers.MatchMask(line));
+    ReportSearch("MultiPattern::MatchMask", log.size(), NowSeconds() - start, matches);
+
+    // Only whether a line has any marker, which stops at the first one.
+    // This counts lines rather than markers.
+    matches = 0;
+    start = NowSeconds();
+    for (std::string_view line : lines)
+        matches += markers.ContainsAny(line);
+    ReportSearch("MultiPattern::ContainsAny", log.size(), NowSeconds() - start, matches);
+}
+
+//----------------------------------------------------------------------------
+// build: log messages from about a dozen pieces with operator+,
+// std::ostringstream and StringBuilder
+
+static const char *buildPaths[] = {"/index.html", "/api/v1/bagels", "/static/app.js", "/login"};
+static const char *buildUsers[] = {"admin", "guest", "potato", "salad"};
+
+template <typename Build>
+static void RunBuild(const char *name, size_t count, Build build)
+{
+    unsigned long long check = 0;
+    double start = NowSeconds();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        check += build(i);
+    }
+
+    double seconds = NowSeconds() - start;
+    printf("  %-36s %10.2f ns/message  (check %llu)\n", name, seconds * 1e9 / (double)count, check);
+}
+
+static void BenchBuild(size_t count)
+{
+    std::string host = "client-0042.example.com";
+
+    printf("build: %zu messages\n", count);
+
+    // The way the strings example joins strings.
+    RunBuild("operator+", count, [&](size_t i) {
+        std::string message = std::string("GET ") + buildPaths[i % 4] + " from " + host + " status " +
+                              std::to_string(200 + i % 5) + " in " + std::to_string(i % 1000) + " ms user=" +
+                              buildUsers[i % 4] + "\n";
+        return message.size();
+    });
+
+    RunBuild("std::ostringstream", count, [&](size_t i) {
+        std::ostringstream stream;
+        stream << "GET " << buildPaths[i % 4] << " from " << host << " status " << 200 + i % 5 << " in "
+               << i % 1000 << " ms user=" << buildUsers[i % 4] << "\n";
+        return stream.str().size();
+    });
+
+    RunBuild("StringBuilder::Build", count, [&](size_t i) {
+        StringBuilder builder;
+        builder.AppendView("GET ").AppendView(buildPaths[i % 4]).AppendView(" from ").AppendView(host);
+        builder.AppendView(" status ").AppendValue(200 + i % 5).AppendView(" in ").AppendValue(i % 1000);
+        builder.AppendView(" ms user=").AppendView(buildUsers[i % 4]).Append('\n');
+        return builder.Build().size();
+    });
+
+    // One builder and one string for every message, like a server that
+    // keeps them for each connection.
+    {
+        StringBuilder builder(0, 16);
+        std::string message;
+        RunBuild("StringBuilder reused", count, [&](size_t i) {
+            builder.Reset();
+            builder.AppendView("GET ").AppendView(buildPaths[i % 4]).AppendView(" from ").AppendView(host);
+            builder.AppendView(" status ").AppendValue(200 + i % 5).AppendView(" in ").AppendValue(i % 1000);
+            builder.AppendView(" ms user=").AppendView(buildUsers[i % 4]).Append('\n');
+            message.clear();
+            builder.BuildInto(message);
+            return message.size();
+        });
+    }
+
+#ifndef _WIN32
+    // Sending each message to /dev/null, so the time includes a system call.
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0)
+        return;
+
+    RunBuild("operator+ and write", count, [&](size_t i) {
+        std::string message = std::string("GET ") + buildPaths[i % 4] + " from " + host + " status " +
+                              std::to_string(200 + i % 5) + " in " + std::to_string(i % 1000) + " ms user=" +
+                              buildUsers[i % 4] + "\n";
+        return (size_t)write(fd, message.data(), message.size());
+    });
+
+    {
+        StringBuilder builder(0, 16);
+        RunBuild("StringBuilder::WriteTo (writev)", count, [&](size_t i) {
+            builder.Reset();
+            builder.AppendView("GET ").AppendView(buildPaths[i % 4]).AppendView(" from ").AppendView(host);
+            builder.AppendView(" status ").AppendValue(200 + i % 5).AppendView(" in ").AppendValue(i % 1000);
+            builder.AppendView(" ms user=").AppendView(buildUsers[i % 4]).Append('\n');
+            return builder.WriteTo(fd) ? builder.Size() : 0;
+        });
+    }
+
+    close(fd);
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+static const Bench benches[] = {
+    {"convert", BenchConvert},
+    {"search", BenchSearch},
+    {"markers", BenchMarkers},
+    {"build", BenchBuild},
+};
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : NULL;
+    size_t count = BENCH_DEFAULT_COUNT;
+    bool found = false;
+
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 10);
+
+    for (const Bench &b : benches)
+    {
+        if (name == NULL || !strcmp(name, b.name))
+        {
+            b.run(count);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "unknown benchmark: %s\n", name);
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,2 +1,8 @@
+# The conversions in ../common/convert.hpp are constrained with concepts,
+# so we use the -std=c++20 flag.
+
 all:
-	g++ -Wall -Werror main.cpp -o strings.out
+	g++ -Wall -Werror -std=c++20 -I../common main.cpp -o strings.out
+
+bench:
+	g++ -Wall -Werror -std=c++20 -O2 -I../common bench.cpp -o bench.out
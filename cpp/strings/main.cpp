@@ -1,11 +1,18 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 
-// It's best to pass strings as references so we don't make a copy of them
-// when calling a function.
-// In this case, we use const to indicate the original string will not be
-// modified.
-void ReadOnlyStringOperation(const std::string &str)
+#include "convert.hpp"
+#include "search.hpp"
+#include "string_builder.hpp"
+
+// It's best not to copy strings when calling a function.
+// A const std::string& avoids copying a std::string, but a string literal
+// would still have to be copied into a temporary std::string first.
+// std::string_view is just a pointer and a length, so it's passed by value
+// and can refer to a std::string, a literal or part of either without
+// copying.
+void ReadOnlyStringOperation(std::string_view str)
 {
     std::cout << str << std::endl;
 }
@@ -15,6 +22,14 @@ int main()
     std::string name = std::string("Potato") + " Salad";
     std::cout << "Example string: " << name << std::endl;
 
+    // Joining many pieces with + copies the string again at every step.
+    // A builder keeps a list of the pieces and copies each one only once,
+    // when the whole string is made.
+    StringBuilder builder;
+    builder.AppendView("Order: ").Append(name).AppendView(", quantity ").AppendValue(3).Append('\n');
+    std::cout << "Built string of " << builder.Size() << " chars from " << builder.Pieces()
+              << " pieces: " << builder.Build();
+
     // Check the length of the string.
     std::cout << "Example string length: " << name.length() << std::endl;
 
@@ -23,10 +38,49 @@ int main()
     std::cout << "Example string contains \"do\": " << (name.find("do") != std::string::npos ? "yes" : "no") << std::endl;
 
     ReadOnlyStringOperation(name);
+    ReadOnlyStringOperation("a literal doesn't need a std::string");
+
+    // Search many lines for many markers at once. The markers are compiled
+    // once, and searching doesn't allocate.
+    MultiPattern markers = {"ERROR", "timeout", "user=admin"};
+    std::string_view lines[] = {"12:00:01 INFO request from user=admin",
+                                "12:00:02 ERROR database timeout",
+                                "12:00:03 INFO all good"};
+    for (std::string_view line : lines)
+    {
+        std::cout << "Markers in \"" << line << "\":";
+        markers.ForEachMatch(line, [&](size_t pattern, size_t position) {
+            std::cout << " " << pattern << "@" << position;
+            return true;
+        });
+        std::cout << std::endl;
+    }
+
+    Pattern salad("Salad");
+    std::cout << "\"Salad\" is at: " << salad.Find(name) << std::endl;
 
     // If a C style string is declared, it must be const.
     // char* incorrect = "c string";
     // const char* correct = "c string";
 
+    // Convert strings to numbers and back without naming the type at runtime.
+    // The destination's type picks the conversion when the program is
+    // compiled, so there is no enumeration to switch on and no void pointer.
+    int count = 0;
+    double weight = 0;
+    unsigned char letter = 0;
+
+    bool ok = StrToPrimitive("  42", count) &&
+              StrToPrimitive("0.1", weight) &&
+              StrToPrimitive("97", letter);
+
+    std::cout << "Converted strings: " << (ok ? "yes" : "no") << std::endl;
+    std::cout << "Back to strings: " << PrimitiveToString(count) << " "
+              << PrimitiveToString(weight) << " " << PrimitiveToString(letter) << std::endl;
+
+    // A value that doesn't fit in its destination fails instead of wrapping.
+    short small = 0;
+    std::cout << "\"99999\" fits in a short: " << (StrToPrimitive("99999", small) ? "yes" : "no") << std::endl;
+
     return 0;
 }
\ No newline at end of file
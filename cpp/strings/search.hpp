@@ -0,0 +1,339 @@
+// Substring search on std::string_view, which never allocates while
+// searching.
+//
+// FindSubstring and Pattern look for one string. With AVX2, they compare
+// the first and last characters of the pattern against 32 positions of the
+// text at once, and only check the rest of the pattern where both match.
+// This skips most of the text without looking at it twice.
+//
+// MultiPattern looks for many strings at once with the Aho-Corasick
+// algorithm. The patterns are compiled into a state machine that reads the
+// text one character at a time. Each step is one table lookup, however many
+// patterns there are, so scanning a line for dozens of markers costs about
+// the same as scanning it for one.
+//
+// A Pattern or MultiPattern is built once and can then be used any number of
+// times, from any number of threads.
+
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The AVX2 search uses GCC/Clang target attributes so that it can be
+// compiled without -mavx2 and selected at runtime.
+// Other compilers and architectures use std::string_view::find.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEARCH_HAVE_AVX2
+#include <immintrin.h>
+#define SEARCH_TARGET_AVX2 __attribute__((target("avx2,bmi")))
+#endif
+
+#ifdef SEARCH_HAVE_AVX2
+inline bool SearchHaveAVX2()
+{
+    static const bool have = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+    return have;
+}
+
+// Searches with the first and last characters of a pattern at least 2
+// characters long, and returns the position to continue from with a scalar
+// search if the end of the text is reached first.
+SEARCH_TARGET_AVX2 inline size_t FindSubstringAVX2(std::string_view text, std::string_view pattern, size_t from,
+                                                   bool &found)
+{
+    const char *t = text.data();
+    const size_t last = pattern.size() - 1;
+    const __m256i first = _mm256_set1_epi8(pattern[0]);
+    const __m256i final = _mm256_set1_epi8(pattern[last]);
+    size_t i = from;
+
+    found = false;
+    for (; i + last + 32 <= text.size(); i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(t + i + last));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, final))));
+
+        while (mask != 0)
+        {
+            size_t pos = i + _tzcnt_u32(mask);
+            if (memcmp(t + pos + 1, pattern.data() + 1, last - 1) == 0)
+            {
+                found = true;
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+#endif
+
+/**
+ * Finds the first place a pattern appears in some text.
+ *
+ * Params:
+ *   std::string_view - the text to search
+ *   std::string_view - the pattern to find
+ *   size_t - the position to start searching from
+ *
+ * Returns:
+ *   size_t - the position of the pattern, or std::string_view::npos if it
+ *            isn't found
+ */
+inline size_t FindSubstring(std::string_view text, std::string_view pattern, size_t from = 0)
+{
+    if (from > text.size() || pattern.size() > text.size() - from)
+        return std::string_view::npos;
+    if (pattern.empty())
+        return from;
+
+    if (pattern.size() == 1)
+    {
+        const void *p = memchr(text.data() + from, pattern[0], text.size() - from);
+        return p == nullptr ? std::string_view::npos : static_cast<const char *>(p) - text.data();
+    }
+
+#ifdef SEARCH_HAVE_AVX2
+    if (SearchHaveAVX2())
+    {
+        bool found;
+        from = FindSubstringAVX2(text, pattern, from, found);
+        if (found)
+            return from;
+    }
+#endif
+
+    return text.find(pattern, from);
+}
+
+inline bool ContainsSubstring(std::string_view text, std::string_view pattern)
+{
+    return FindSubstring(text, pattern) != std::string_view::npos;
+}
+
+// A single pattern, copied so that it doesn't depend on the lifetime of the
+// string it was made from.
+class Pattern
+{
+public:
+    explicit Pattern(std::string_view pattern) : m_Pattern(pattern)
+    {
+    }
+
+    size_t Find(std::string_view text, size_t from = 0) const
+    {
+        return FindSubstring(text, m_Pattern, from);
+    }
+
+    bool Contains(std::string_view text) const
+    {
+        return Find(text) != std::string_view::npos;
+    }
+
+    std::string_view View() const
+    {
+        return m_Pattern;
+    }
+
+private:
+    std::string m_Pattern;
+};
+
+// Many patterns, found together in one pass over the text.
+//
+// Characters that aren't in any pattern all behave the same, so the table of
+// transitions only has a column for each character that is in a pattern,
+// plus one for everything else. That keeps it small enough to stay in the
+// cache.
+//
+// Empty patterns never match.
+class MultiPattern
+{
+public:
+    MultiPattern(std::initializer_list<std::string_view> patterns)
+    {
+        Build(patterns.begin(), patterns.end());
+    }
+
+    explicit MultiPattern(const std::vector<std::string_view> &patterns)
+    {
+        Build(patterns.begin(), patterns.end());
+    }
+
+    // Calls a function for every match, in the order the matches end. The
+    // function is called with the index of the pattern and the position where
+    // the match starts, and returns false to stop searching.
+    //
+    // Returns:
+    //   bool - false if the function stopped the search
+    template <typename F>
+    bool ForEachMatch(std::string_view text, F &&f) const
+    {
+        const unsigned char *t = reinterpret_cast<const unsigned char *>(text.data());
+        uint32_t row = 0;
+
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            uint32_t next = m_Next[row + m_Class[t[i]]];
+            row = next & ~MATCH_FLAG;
+            if (next & MATCH_FLAG)
+            {
+                uint32_t state = row / m_Columns;
+                for (uint32_t k = m_OutputStart[state]; k < m_OutputStart[state + 1]; k++)
+                {
+                    uint32_t pattern = m_Outputs[k];
+                    if (!f(static_cast<size_t>(pattern), i + 1 - m_Lengths[pattern]))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ContainsAny(std::string_view text) const
+    {
+        return !ForEachMatch(text, [](size_t, size_t) { return false; });
+    }
+
+    // Gets a bit for each of the first 64 patterns that appear in the text.
+    uint64_t MatchMask(std::string_view text) const
+    {
+        uint64_t mask = 0;
+        ForEachMatch(text, [&](size_t pattern, size_t) {
+            if (pattern < 64)
+                mask |= 1ULL << pattern;
+            return true;
+        });
+        return mask;
+    }
+
+    size_t Size() const
+    {
+        return m_Lengths.size();
+    }
+
+    // The number of states in the compiled machine.
+    size_t States() const
+    {
+        return m_OutputStart.size() - 1;
+    }
+
+private:
+    // Set in a transition when the state it leads to ends a pattern.
+    static constexpr uint32_t MATCH_FLAG = 0x80000000u;
+
+    // The column of each character in the table of transitions.
+    uint16_t m_Class[256];
+    uint32_t m_Columns;
+
+    // For each state, a row of m_Columns transitions. Each transition is the
+    // offset of the next state's row, so the loop doesn't have to multiply.
+    std::vector<uint32_t> m_Next;
+
+    // The patterns that end at each state are
+    // m_Outputs[m_OutputStart[s]] up to m_Outputs[m_OutputStart[s + 1]].
+    std::vector<uint32_t> m_OutputStart;
+    std::vector<uint32_t> m_Outputs;
+    std::vector<size_t> m_Lengths;
+
+    template <typename It>
+    void Build(It begin, It end)
+    {
+        // Give each character that appears in a pattern its own column.
+        memset(m_Class, 0, sizeof(m_Class));
+        m_Columns = 1;
+        for (It p = begin; p != end; ++p)
+        {
+            for (unsigned char c : *p)
+            {
+                if (m_Class[c] == 0)
+                    m_Class[c] = static_cast<uint16_t>(m_Columns++);
+            }
+        }
+
+        // Build a trie of the patterns. Missing transitions are 0 for now,
+        // which is safe because no transition leads back to the root in a
+        // trie.
+        std::vector<uint32_t> next(m_Columns, 0);
+        std::vector<std::vector<uint32_t>> outputs(1);
+        for (It p = begin; p != end; ++p)
+        {
+            uint32_t state = 0;
+            m_Lengths.push_back(p->size());
+            if (p->empty())
+                continue;
+
+            for (unsigned char c : *p)
+            {
+                uint32_t &to = next[state * m_Columns + m_Class[c]];
+                if (to == 0)
+                {
+                    to = static_cast<uint32_t>(outputs.size());
+                    outputs.emplace_back();
+                    next.resize(next.size() + m_Columns, 0);
+                }
+                state = next[state * m_Columns + m_Class[c]];
+            }
+            outputs[state].push_back(static_cast<uint32_t>(m_Lengths.size() - 1));
+        }
+
+        // Fill in the missing transitions breadth first. A missing transition
+        // from a state goes where its failure state goes, which is the state
+        // for the longest proper suffix of its text that is in the trie. A
+        // state also ends every pattern its failure state ends.
+        size_t states = outputs.size();
+        std::vector<uint32_t> fail(states, 0);
+        std::deque<uint32_t> queue;
+
+        for (uint32_t c = 0; c < m_Columns; c++)
+        {
+            if (next[c] != 0)
+                queue.push_back(next[c]);
+        }
+
+        while (!queue.empty())
+        {
+            uint32_t state = queue.front();
+            queue.pop_front();
+            outputs[state].insert(outputs[state].end(), outputs[fail[state]].begin(), outputs[fail[state]].end());
+
+            for (uint32_t c = 0; c < m_Columns; c++)
+            {
+                uint32_t &to = next[state * m_Columns + c];
+                if (to != 0)
+                {
+                    fail[to] = next[fail[state] * m_Columns + c];
+                    queue.push_back(to);
+                }
+                else
+                {
+                    to = next[fail[state] * m_Columns + c];
+                }
+            }
+        }
+
+        m_OutputStart.assign(1, 0);
+        for (size_t s = 0; s < states; s++)
+        {
+            m_Outputs.insert(m_Outputs.end(), outputs[s].begin(), outputs[s].end());
+            m_OutputStart.push_back(static_cast<uint32_t>(m_Outputs.size()));
+        }
+
+        m_Next.resize(next.size());
+        for (size_t i = 0; i < next.size(); i++)
+        {
+            m_Next[i] = next[i] * m_Columns | (outputs[next[i]].empty() ? 0 : MATCH_FLAG);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,236 @@
+// Builds a string from many pieces without copying it more than once.
+//
+// Joining strings with operator+ makes a new string, or grows one, at every
+// step, so a long message is reallocated and copied several times while it's
+// built. A StringBuilder only keeps a list of the pieces:
+//
+// - AppendView keeps a pointer to the caller's characters, which must stay
+//   valid until the builder is done with them. Long pieces aren't copied.
+// - Append copies the characters into an arena owned by the builder, for
+//   pieces that won't outlive the call, like a temporary std::string.
+// - AppendValue converts a number straight into the arena.
+//
+// When every piece is in, Build makes the string with one allocation and one
+// copy of each piece, CopyTo writes it into a buffer, and WriteTo sends the
+// pieces to a file descriptor with writev, without joining them at all.
+//
+// Reset empties the builder but keeps its memory, so a builder that is
+// reused for each request stops allocating after the first few.
+
+#ifndef STRING_BUILDER_HPP
+#define STRING_BUILDER_HPP
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "convert.hpp"
+#include "memory.hpp"
+
+// The size of the arena blocks that hold copied pieces.
+#define STRING_BUILDER_BLOCK_SIZE 4096
+
+// The size of the space taken from the arena at a time for copies.
+#define STRING_BUILDER_CHUNK_SIZE 512
+
+// Pieces shorter than this are always copied.
+#define STRING_BUILDER_COPY_SIZE 32
+
+#if !defined(_WIN32) && !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
+
+class StringBuilder
+{
+public:
+    // Creates a builder. The hints make room ahead of time for the number of
+    // bytes that will be copied into the builder and the number of pieces.
+    explicit StringBuilder(size_t reserveBytes = 0, size_t reservePieces = 0)
+        : m_Arena(reserveBytes > STRING_BUILDER_BLOCK_SIZE ? reserveBytes : STRING_BUILDER_BLOCK_SIZE),
+          m_Next(nullptr), m_End(nullptr), m_Size(0)
+    {
+        m_Pieces.reserve(reservePieces);
+    }
+
+    StringBuilder(const StringBuilder &) = delete;
+    StringBuilder &operator=(const StringBuilder &) = delete;
+
+    // Adds a piece without copying it. Pieces shorter than
+    // STRING_BUILDER_COPY_SIZE are copied anyway, since copying a few bytes
+    // next to the last copy is cheaper than keeping track of another piece.
+    StringBuilder &AppendView(std::string_view piece)
+    {
+        if (piece.size() < STRING_BUILDER_COPY_SIZE)
+            return Append(piece);
+
+        m_Pieces.push_back(piece);
+        m_Size += piece.size();
+        return *this;
+    }
+
+    // Adds a copy of a piece.
+    StringBuilder &Append(std::string_view piece)
+    {
+        if (!piece.empty())
+        {
+            char *copy = Allocate(piece.size());
+            memcpy(copy, piece.data(), piece.size());
+        }
+        return *this;
+    }
+
+    StringBuilder &Append(char c)
+    {
+        *Allocate(1) = c;
+        return *this;
+    }
+
+    // Adds a number, or a character type as a character, the same way as
+    // PrimitiveToStr.
+    template <Primitive T>
+    StringBuilder &AppendValue(T value)
+    {
+        char text[PRIMITIVE_STR_SIZE];
+        return Append(std::string_view(text, PrimitiveToStr(value, text, sizeof(text))));
+    }
+
+    // Empties the builder, keeping its memory for the next string.
+    void Reset()
+    {
+        m_Pieces.clear();
+        m_Arena.Reset();
+        m_Next = nullptr;
+        m_End = nullptr;
+        m_Size = 0;
+    }
+
+    // Makes room for more pieces.
+    void Reserve(size_t pieces)
+    {
+        m_Pieces.reserve(pieces);
+    }
+
+    // The length of the whole string.
+    size_t Size() const
+    {
+        return m_Size;
+    }
+
+    // The number of separate pieces. Copies that were made one after another
+    // are joined into a single piece.
+    size_t Pieces() const
+    {
+        return m_Pieces.size();
+    }
+
+    // Copies the whole string into a buffer of at least Size() chars.
+    // No NUL terminator is written.
+    size_t CopyTo(char *dest) const
+    {
+        char *p = dest;
+        for (std::string_view piece : m_Pieces)
+        {
+            memcpy(p, piece.data(), piece.size());
+            p += piece.size();
+        }
+        return m_Size;
+    }
+
+    std::string Build() const
+    {
+        std::string result(m_Size, '\0');
+        CopyTo(result.data());
+        return result;
+    }
+
+    // Appends the whole string to another string, growing it at most once.
+    void BuildInto(std::string &dest) const
+    {
+        size_t at = dest.size();
+        dest.resize(at + m_Size);
+        CopyTo(dest.data() + at);
+    }
+
+#ifndef _WIN32
+    // Writes every piece to a file descriptor with as few system calls as
+    // possible, picking up where it left off after a partial write.
+    //
+    // Returns:
+    //   bool - false if a write failed
+    bool WriteTo(int fd) const
+    {
+        struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+        size_t next = 0;   // the next piece to write
+        size_t offset = 0; // how much of that piece was already written
+
+        while (next < m_Pieces.size())
+        {
+            int count = 0;
+            for (size_t i = next; i < m_Pieces.size() && count < (int)(sizeof(iov) / sizeof(iov[0])); i++, count++)
+            {
+                size_t skip = i == next ? offset : 0;
+                iov[count].iov_base = const_cast<char *>(m_Pieces[i].data() + skip);
+                iov[count].iov_len = m_Pieces[i].size() - skip;
+            }
+
+            ssize_t written = writev(fd, iov, count);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+
+            size_t left = static_cast<size_t>(written);
+            while (next < m_Pieces.size() && left >= m_Pieces[next].size() - offset)
+            {
+                left -= m_Pieces[next].size() - offset;
+                offset = 0;
+                next++;
+            }
+            offset += left;
+        }
+        return true;
+    }
+#endif
+
+private:
+    ArenaResource m_Arena;
+    std::vector<std::string_view> m_Pieces;
+    char *m_Next; // the free space in the current chunk for copies
+    char *m_End;
+    size_t m_Size;
+
+    // Gets space for a copy, and adds it to the last piece if the two are
+    // next to each other. Space is taken from the arena a chunk at a time so
+    // that most copies only move a pointer.
+    char *Allocate(size_t size)
+    {
+        if (size > static_cast<size_t>(m_End - m_Next))
+        {
+            size_t chunk = size > STRING_BUILDER_CHUNK_SIZE ? size : STRING_BUILDER_CHUNK_SIZE;
+            m_Next = static_cast<char *>(m_Arena.allocate(chunk, 1));
+            m_End = m_Next + chunk;
+        }
+
+        char *p = m_Next;
+        m_Next += size;
+
+        if (!m_Pieces.empty() && m_Pieces.back().data() + m_Pieces.back().size() == p)
+            m_Pieces.back() = std::string_view(m_Pieces.back().data(), m_Pieces.back().size() + size);
+        else
+            m_Pieces.emplace_back(p, size);
+        m_Size += size;
+        return p;
+    }
+};
+
+#endif
@@ -1,2 +1,8 @@
+# The conversions in ../common/convert.hpp are constrained with concepts,
+# so we use the /std:c++20 flag.
+
 all:
-	cl /W3 /WX /EHsc main.cpp /Fe"strings.exe"
+	cl /W3 /WX /EHsc /std:c++20 /I../common main.cpp /Fe"strings.exe"
+
+bench:
+	cl /W3 /WX /EHsc /std:c++20 /O2 /I../common bench.cpp /Fe"bench.exe"